@@ -0,0 +1,377 @@
+#include <lvk/LVK.h>
+#include <lvk/vulkan/VulkanClasses.h>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "bench/bench_report.h"
+#include "core/async_log.h"
+#include "core/profiler.h"
+#include "render/device/device_features.h"
+#include "render/scene_renderer.h"
+#include "render/shader/compiler/compiler.h"
+
+// Headless frame-time benchmark: renders scripted scenes offscreen for a
+// fixed number of frames and writes CPU and GPU frame time percentiles as JSON.
+//
+//   kholst-bench [--frames N] [--warmup N] [--width W] [--height H]
+//                [--scene cubes:N]... [--output path|-]
+//
+// Run from the repository root, shaders are loaded from src/shaders.
+
+static const char* LOG_FILE_PATH = ".log.bench.txt";
+
+static const char* SHADER_CACHE_PATH = ".shader_cache";
+
+static constexpr lvk::Format COLOR_FORMAT = lvk::Format_RGBA_UN8;
+
+// Same as the interactive app, so both measure the same frame
+static constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+
+// Animation advances by a fixed step so every run renders identical frames
+static constexpr double FRAME_TIME_STEP = 1.0 / 60.0;
+
+static const uint32_t DEFAULT_CUBE_COUNTS[] = { 1, 1000, 100000 };
+
+struct BenchOptions
+{
+    uint32_t frames = 500;
+    uint32_t warmupFrames = 50;
+    uint32_t width = 1680;
+    uint32_t height = 720;
+    std::vector<uint32_t> cubeCounts;
+    std::string outputPath = "kholst-bench.json";
+    bool meshShading = false; // Meshlets through task and mesh shaders, where the device supports them
+};
+
+static void printUsage()
+{
+    std::fprintf(stderr,
+        "Usage: kholst-bench [--frames N] [--warmup N] [--width W] [--height H]\n"
+        "                    [--scene cubes:N]... [--geometry vertex|mesh] [--output path|-]\n");
+}
+
+static bool parseUint(const char* text, uint32_t& outValue)
+{
+    char* end = nullptr;
+    const unsigned long value = std::strtoul(text, &end, 10);
+    if (!*text || *end || value > UINT32_MAX)
+        return false;
+
+    outValue = (uint32_t)value;
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& outOptions)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        bool ok = value != nullptr;
+        if (!std::strcmp(arg, "--frames"))
+            ok = ok && parseUint(value, outOptions.frames) && outOptions.frames;
+        else if (!std::strcmp(arg, "--warmup"))
+            ok = ok && parseUint(value, outOptions.warmupFrames);
+        else if (!std::strcmp(arg, "--width"))
+            ok = ok && parseUint(value, outOptions.width) && outOptions.width;
+        else if (!std::strcmp(arg, "--height"))
+            ok = ok && parseUint(value, outOptions.height) && outOptions.height;
+        else if (!std::strcmp(arg, "--output"))
+            ok = ok && (outOptions.outputPath = value, true);
+        else if (!std::strcmp(arg, "--geometry"))
+            ok = ok && (!std::strcmp(value, "vertex") || !std::strcmp(value, "mesh")) &&
+                (outOptions.meshShading = !std::strcmp(value, "mesh"), true);
+        else if (!std::strcmp(arg, "--scene"))
+        {
+            uint32_t cubeCount = 0;
+            ok = ok && !std::strncmp(value, "cubes:", 6) && parseUint(value + 6, cubeCount) && cubeCount;
+            if (ok)
+                outOptions.cubeCounts.push_back(cubeCount);
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            std::fprintf(stderr, "Invalid argument: %s%s%s\n", arg, value ? " " : "", value ? value : "");
+            return false;
+        }
+        i++;
+    }
+
+    if (outOptions.cubeCounts.empty())
+        outOptions.cubeCounts.assign(std::begin(DEFAULT_CUBE_COUNTS), std::end(DEFAULT_CUBE_COUNTS));
+    return true;
+}
+
+// Same device selection as lvk::createVulkanContextWithSwapchain(), but
+// without a window, surface or swapchain
+static std::unique_ptr<lvk::IContext> createHeadlessContext(const lvk::ContextConfig& config)
+{
+    std::unique_ptr<lvk::VulkanContext> ctx = std::make_unique<lvk::VulkanContext>(config, nullptr);
+
+    std::vector<lvk::HWDeviceDesc> devices;
+    const lvk::HWDeviceType deviceTypes[] = {
+        lvk::HWDeviceType_Discrete, lvk::HWDeviceType_External, lvk::HWDeviceType_Integrated, lvk::HWDeviceType_Software,
+    };
+    for (lvk::HWDeviceType type : deviceTypes)
+    {
+        if (ctx->queryDevices(type, devices).isOk() && !devices.empty())
+            break;
+    }
+
+    if (devices.empty())
+    {
+        KHOLST_LOGW("No Vulkan device found\n");
+        return nullptr;
+    }
+
+    const lvk::Result res = ctx->initContext(devices[0]);
+    if (!res.isOk())
+    {
+        KHOLST_LOGW("Failed to create Vulkan device: %s\n", res.message ? res.message : "");
+        return nullptr;
+    }
+
+    KHOLST_LOGL("Benchmarking on %s\n", devices[0].name);
+    return ctx;
+}
+
+class SceneBenchmark
+{
+public:
+    SceneBenchmark(
+        lvk::IContext* ctx,
+        kholst::render::shader::SlangCompiler& compiler,
+        const BenchOptions& options,
+        bool barycentricWireframe,
+        bool meshShading
+    )
+    : ctx(ctx)
+    , compiler(compiler)
+    , options(options)
+    , barycentricWireframe(barycentricWireframe)
+    , meshShading(meshShading)
+    {
+    }
+
+    bool initialize(std::string& outErrorMsg)
+    {
+        lvk::Result res;
+        colorTarget = ctx->createTexture({
+            .format = COLOR_FORMAT,
+            .dimensions = { options.width, options.height },
+            .usage = lvk::TextureUsageBits_Attachment,
+            .debugName = "Benchmark color target",
+        }, nullptr, &res);
+        if (!res.isOk())
+        {
+            outErrorMsg = std::string("Failed to create color target: ") + (res.message ? res.message : "");
+            return false;
+        }
+
+        // A begin and an end timestamp per frame in flight
+        queryPool = ctx->createQueryPool(2 * FRAMES_IN_FLIGHT, "Benchmark timestamps", &res);
+        if (!res.isOk())
+            KHOLST_LOGW("Timestamp queries unavailable, GPU times are not recorded: %s\n", res.message ? res.message : "");
+
+        return true;
+    }
+
+    bool runCubes(uint32_t cubeCount, kholst::bench::BenchReport& report, std::string& outErrorMsg)
+    {
+        kholst::render::SceneRenderer renderer;
+        if (!renderer.initialize(ctx, compiler, {
+            .cubeCount = cubeCount,
+            .colorFormat = COLOR_FORMAT,
+            .barycentricWireframe = barycentricWireframe,
+            .meshShading = meshShading,
+            .framesInFlight = FRAMES_IN_FLIGHT,
+        }, outErrorMsg))
+            return false;
+
+        std::vector<double> cpuMs;
+        std::vector<double> gpuMs;
+        cpuMs.reserve(options.frames);
+        gpuMs.reserve(options.frames);
+
+        const uint32_t totalFrames = options.warmupFrames + options.frames;
+        lvk::SubmitHandle submits[FRAMES_IN_FLIGHT] = {};
+
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point frameStart = Clock::now();
+
+        for (uint32_t frame = 0; frame < totalFrames; frame++)
+        {
+            const uint32_t slot = frame % FRAMES_IN_FLIGHT;
+
+            // The frame that last used this slot's queries is done once its submit is
+            if (frame >= FRAMES_IN_FLIGHT)
+                collectGpuTime(submits[slot], slot, frame - FRAMES_IN_FLIGHT, gpuMs);
+
+            const double time = frame * FRAME_TIME_STEP;
+            const glm::mat4 v =
+                glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -renderer.getCameraDistance())) *
+                glm::rotate(glm::mat4(1.0f), (float)(time * 0.25), glm::vec3(0.0f, 1.0f, 0.0f));
+            const glm::mat4 p = glm::perspective(45.0f, options.width / (float)options.height, 0.1f, 1000.0f);
+
+            lvk::ICommandBuffer& buf = ctx->acquireCommandBuffer();
+            if (!queryPool.empty())
+            {
+                buf.cmdResetQueryPool(queryPool, 2 * slot, 2);
+                buf.cmdWriteTimestamp(queryPool, 2 * slot);
+            }
+            renderer.render(buf, colorTarget, {
+                .viewProj = p * v,
+                .cameraPosition = glm::vec3(glm::inverse(v)[3]),
+                .time = (float)time,
+            });
+            if (!queryPool.empty())
+                buf.cmdWriteTimestamp(queryPool, 2 * slot + 1);
+
+            submits[slot] = ctx->submit(buf);
+            renderer.endFrame(submits[slot]);
+
+            const Clock::time_point frameEnd = Clock::now();
+            if (frame >= options.warmupFrames)
+                cpuMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+            frameStart = frameEnd;
+
+            KHOLST_PROFILER_FRAME("Benchmark frame");
+        }
+
+        for (uint32_t frame = totalFrames > FRAMES_IN_FLIGHT ? totalFrames - FRAMES_IN_FLIGHT : 0; frame < totalFrames; frame++)
+            collectGpuTime(submits[frame % FRAMES_IN_FLIGHT], frame % FRAMES_IN_FLIGHT, frame, gpuMs);
+
+        ctx->wait({});
+        const bool drewMeshlets = renderer.isMeshShading();
+        renderer.clear();
+
+        kholst::bench::BenchReport::Result result = {
+            .name = "cubes-" + std::to_string(cubeCount),
+            .parameters = {
+                { "cubeCount", (double)cubeCount },
+                { "frames", (double)options.frames },
+                { "meshShading", drewMeshlets ? 1.0 : 0.0 },
+            },
+            .metrics = { { "cpuFrameMs", kholst::bench::computeSampleStats(std::move(cpuMs)) } },
+        };
+        if (!gpuMs.empty())
+            result.metrics.push_back({ "gpuFrameMs", kholst::bench::computeSampleStats(std::move(gpuMs)) });
+        report.addResult(std::move(result));
+        return true;
+    }
+
+    void clear()
+    {
+        queryPool = {};
+        colorTarget = {};
+    }
+
+private:
+    lvk::IContext* ctx = nullptr;
+    kholst::render::shader::SlangCompiler& compiler;
+    const BenchOptions& options;
+    bool barycentricWireframe = false;
+    bool meshShading = false;
+
+    lvk::Holder<lvk::TextureHandle> colorTarget;
+    lvk::Holder<lvk::QueryPoolHandle> queryPool;
+
+    void collectGpuTime(lvk::SubmitHandle submit, uint32_t slot, uint32_t frame, std::vector<double>& outGpuMs)
+    {
+        if (queryPool.empty() || frame < options.warmupFrames)
+            return;
+
+        ctx->wait(submit);
+
+        uint64_t timestamps[2] = {};
+        if (ctx->getQueryPoolResults(queryPool, 2 * slot, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0])))
+            outGpuMs.push_back((double)(timestamps[1] - timestamps[0]) * ctx->getTimestampPeriodToMs());
+    }
+};
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    minilog::initialize(LOG_FILE_PATH, { .threadNames = false });
+
+    lvk::ContextConfig config;
+    const kholst::render::DeviceFeatures features = kholst::render::requestOptionalDeviceFeatures(config, {
+        .fragmentShaderBarycentric = true,
+        .meshShader = options.meshShading,
+    });
+
+    std::unique_ptr<lvk::IContext> ctx = createHeadlessContext(config);
+    if (!ctx)
+        return EXIT_FAILURE;
+
+    kholst::render::shader::SlangCompiler compiler;
+    if (!compiler.initialize(SLANG_SPIRV))
+    {
+        KHOLST_LOGW("Failed to initialize Slang compiler: %s\n", compiler.getLastDiagnostics().c_str());
+        return EXIT_FAILURE;
+    }
+    compiler.enableCache(SHADER_CACHE_PATH);
+
+    kholst::bench::BenchReport report("kholst-bench");
+    report.setContext("resolution", std::to_string(options.width) + "x" + std::to_string(options.height));
+    report.setContext("warmupFrames", std::to_string(options.warmupFrames));
+    report.setContext("barycentricWireframe", features.fragmentShaderBarycentric ? "true" : "false");
+    report.setContext("geometry", features.meshShader ? "mesh" : "vertex");
+#if defined(NDEBUG)
+    report.setContext("build", "release");
+#else
+    report.setContext("build", "debug");
+#endif
+
+    int exitCode = EXIT_SUCCESS;
+    {
+        SceneBenchmark benchmark(ctx.get(), compiler, options, features.fragmentShaderBarycentric, features.meshShader);
+
+        std::string errorMsg;
+        if (!benchmark.initialize(errorMsg))
+        {
+            KHOLST_LOGW("%s\n", errorMsg.c_str());
+            return EXIT_FAILURE;
+        }
+
+        for (uint32_t cubeCount : options.cubeCounts)
+        {
+            if (!benchmark.runCubes(cubeCount, report, errorMsg))
+            {
+                KHOLST_LOGW("Scene cubes:%u failed: %s\n", cubeCount, errorMsg.c_str());
+                exitCode = EXIT_FAILURE;
+            }
+        }
+        benchmark.clear();
+    }
+
+    KHOLST_LOGL("%s", report.toText().c_str());
+
+    std::string errorMsg;
+    if (!report.write(options.outputPath, errorMsg))
+    {
+        KHOLST_LOGW("%s\n", errorMsg.c_str());
+        exitCode = EXIT_FAILURE;
+    }
+
+    ctx.reset();
+    return exitCode;
+}
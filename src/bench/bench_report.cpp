@@ -0,0 +1,206 @@
+#include "bench_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace kholst
+{
+namespace bench
+{
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    const size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+SampleStats computeSampleStats(std::vector<double> samples)
+{
+    if (samples.empty())
+        return {};
+
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0.0;
+    for (double sample : samples)
+        total += sample;
+
+    return {
+        .count = samples.size(),
+        .mean = total / samples.size(),
+        .min = samples.front(),
+        .p50 = percentile(samples, 50.0),
+        .p95 = percentile(samples, 95.0),
+        .p99 = percentile(samples, 99.0),
+        .max = samples.back(),
+    };
+}
+
+static void appendEscaped(std::string& out, const std::string& text)
+{
+    out += '"';
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+                out += escaped;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+static void appendNumber(std::string& out, double value)
+{
+    // JSON has no representation for these
+    if (!std::isfinite(value))
+    {
+        out += "null";
+        return;
+    }
+
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.6g", value);
+    out += text;
+}
+
+BenchReport::BenchReport(std::string benchmarkName)
+: name(std::move(benchmarkName))
+{
+}
+
+void BenchReport::setContext(const std::string& key, const std::string& value)
+{
+    for (std::pair<std::string, std::string>& entry : context)
+    {
+        if (entry.first == key)
+        {
+            entry.second = value;
+            return;
+        }
+    }
+    context.emplace_back(key, value);
+}
+
+void BenchReport::addResult(Result result)
+{
+    results.push_back(std::move(result));
+}
+
+std::string BenchReport::toJson() const
+{
+    std::string out = "{\n  \"benchmark\": ";
+    appendEscaped(out, name);
+
+    out += ",\n  \"context\": {";
+    for (size_t i = 0; i < context.size(); i++)
+    {
+        out += i ? ",\n    " : "\n    ";
+        appendEscaped(out, context[i].first);
+        out += ": ";
+        appendEscaped(out, context[i].second);
+    }
+    out += context.empty() ? "}" : "\n  }";
+
+    out += ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        out += i ? ",\n    {\n      \"name\": " : "\n    {\n      \"name\": ";
+        appendEscaped(out, result.name);
+
+        out += ",\n      \"parameters\": {";
+        for (size_t j = 0; j < result.parameters.size(); j++)
+        {
+            out += j ? ", " : " ";
+            appendEscaped(out, result.parameters[j].first);
+            out += ": ";
+            appendNumber(out, result.parameters[j].second);
+        }
+        out += result.parameters.empty() ? "}" : " }";
+
+        out += ",\n      \"metrics\": {";
+        for (size_t j = 0; j < result.metrics.size(); j++)
+        {
+            const SampleStats& stats = result.metrics[j].second;
+            out += j ? ",\n        " : "\n        ";
+            appendEscaped(out, result.metrics[j].first);
+            out += ": { \"count\": " + std::to_string(stats.count);
+            const std::pair<const char*, double> fields[] = {
+                { "mean", stats.mean }, { "min", stats.min }, { "p50", stats.p50 },
+                { "p95", stats.p95 }, { "p99", stats.p99 }, { "max", stats.max },
+            };
+            for (const std::pair<const char*, double>& field : fields)
+            {
+                out += std::string(", \"") + field.first + "\": ";
+                appendNumber(out, field.second);
+            }
+            out += " }";
+        }
+        out += result.metrics.empty() ? "}\n    }" : "\n      }\n    }";
+    }
+    out += results.empty() ? "]\n}\n" : "\n  ]\n}\n";
+    return out;
+}
+
+bool BenchReport::write(const std::string& path, std::string& outErrorMsg) const
+{
+    const std::string json = toJson();
+    if (path == "-")
+    {
+        std::fwrite(json.data(), 1, json.size(), stdout);
+        return true;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        outErrorMsg = "Failed to open " + path + " for writing";
+        return false;
+    }
+
+    file.write(json.data(), (std::streamsize)json.size());
+    if (!file)
+    {
+        outErrorMsg = "Failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::string BenchReport::toText() const
+{
+    std::string out;
+    char line[256];
+    for (const Result& result : results)
+    {
+        for (const std::pair<std::string, SampleStats>& metric : result.metrics)
+        {
+            const SampleStats& stats = metric.second;
+            std::snprintf(line, sizeof(line), "%-32s %-10s p50 %9.4f  p95 %9.4f  p99 %9.4f  max %9.4f  (%zu samples)\n",
+                result.name.c_str(), metric.first.c_str(), stats.p50, stats.p95, stats.p99, stats.max, stats.count);
+            out += line;
+        }
+    }
+    return out;
+}
+
+} // namespace bench
+} // namespace kholst
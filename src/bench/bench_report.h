@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace kholst
+{
+namespace bench
+{
+
+// Summary of a set of timing samples, all in the samples' unit
+struct SampleStats
+{
+    size_t count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+SampleStats computeSampleStats(std::vector<double> samples);
+
+/**
+ * @brief Benchmark results written as JSON for regression tracking
+ *
+ * The layout is stable so CI can diff runs of two builds:
+ * { "benchmark": name, "context": { key: value, ... },
+ *   "results": [ { "name": ..., "parameters": { key: number, ... },
+ *                  "metrics": { key: { "count", "mean", "min", "p50", "p95", "p99", "max" }, ... } } ] }
+ */
+class BenchReport
+{
+public:
+    struct Result
+    {
+        std::string name;
+        std::vector<std::pair<std::string, double>> parameters;
+        std::vector<std::pair<std::string, SampleStats>> metrics;
+    };
+
+    explicit BenchReport(std::string benchmarkName);
+
+    // Describes the whole run, e.g. device name or resolution
+    void setContext(const std::string& key, const std::string& value);
+
+    void addResult(Result result);
+
+    const std::vector<Result>& getResults() const { return results; }
+
+    std::string toJson() const;
+
+    /**
+     * @brief Write toJson() to a file
+     *
+     * @param path Output path, "-" writes to stdout
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool write(const std::string& path, std::string& outErrorMsg) const;
+
+    // One line per result and metric, for the log
+    std::string toText() const;
+
+private:
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> context;
+    std::vector<Result> results;
+};
+
+} // namespace bench
+} // namespace kholst
@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <taskflow/taskflow.hpp>
+
+#include "bench/bench_report.h"
+#include "scene/transform_hierarchy.h"
+
+// Transform hierarchy micro-benchmarks: times TransformHierarchy::update()
+// on a synthetic scene of about a million nodes, when everything moved,
+// when a small part moved and when nothing did, serial and on a worker
+// pool. Results are written as JSON like kholst-bench.
+//
+//   kholst-scene-bench [--iterations N] [--filter text] [--output path|-]
+
+using kholst::bench::BenchReport;
+using kholst::bench::SampleStats;
+using kholst::scene::TransformHierarchy;
+
+// Roots with BRANCHING children per node below them, LEVEL_COUNT levels deep
+static constexpr uint32_t ROOT_COUNT = 1000;
+static constexpr uint32_t BRANCHING = 10;
+static constexpr uint32_t LEVEL_COUNT = 4;
+
+// Roots moved by the partial update cases, with their subtrees about 1% of the nodes
+static constexpr uint32_t PARTIAL_ROOT_COUNT = ROOT_COUNT / 100;
+
+struct BenchOptions
+{
+    uint32_t iterations = 20;
+    std::string filter;
+    std::string outputPath = "kholst-scene-bench.json";
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& outOptions)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const char* arg = argv[i];
+        const char* value = argv[i + 1];
+        if (!std::strcmp(arg, "--iterations"))
+        {
+            outOptions.iterations = (uint32_t)std::strtoul(value, nullptr, 10);
+            if (!outOptions.iterations)
+                return false;
+        }
+        else if (!std::strcmp(arg, "--filter"))
+            outOptions.filter = value;
+        else if (!std::strcmp(arg, "--output"))
+            outOptions.outputPath = value;
+        else
+            return false;
+    }
+    return argc % 2 == 1;
+}
+
+static TransformHierarchy::Transform nodeTransform(uint32_t index)
+{
+    const float angle = (float)(index % 360) * 0.0174533f;
+    return {
+        .position = glm::vec3((float)(index % 17), (float)(index % 7), (float)(index % 13)) * 0.25f,
+        .rotation = glm::angleAxis(angle, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f))),
+        .scale = glm::vec3(0.9f),
+    };
+}
+
+// Breadth-first per root, so nodes come out of order and the first update() sorts them
+static std::vector<TransformHierarchy::NodeId> buildScene(TransformHierarchy& hierarchy)
+{
+    const TransformHierarchy::Bounds bounds = { .extents = glm::vec3(0.5f) };
+    std::vector<TransformHierarchy::NodeId> roots;
+
+    uint32_t index = 0;
+    for (uint32_t r = 0; r < ROOT_COUNT; r++)
+    {
+        std::vector<TransformHierarchy::NodeId> level = { hierarchy.addNode(TransformHierarchy::INVALID_NODE, nodeTransform(index++), bounds) };
+        roots.push_back(level.front());
+
+        for (uint32_t depth = 1; depth < LEVEL_COUNT; depth++)
+        {
+            std::vector<TransformHierarchy::NodeId> children;
+            for (TransformHierarchy::NodeId parent : level)
+            {
+                for (uint32_t c = 0; c < BRANCHING; c++)
+                    children.push_back(hierarchy.addNode(parent, nodeTransform(index++), bounds));
+            }
+            level = std::move(children);
+        }
+    }
+    return roots;
+}
+
+class SceneBenchmarks
+{
+public:
+    SceneBenchmarks(const BenchOptions& options, BenchReport& report)
+    : options(options)
+    , report(report)
+    {
+    }
+
+    void run()
+    {
+        roots = buildScene(hierarchy);
+
+        const Clock::time_point start = Clock::now();
+        hierarchy.update(&executor);
+        addResult("build/first-update", {}, { { "totalMs", kholst::bench::computeSampleStats({ millisecondsSince(start) }) } });
+
+        benchUpdate("update/all/serial", ROOT_COUNT, false);
+        benchUpdate("update/all/parallel", ROOT_COUNT, true);
+        benchUpdate("update/partial/serial", PARTIAL_ROOT_COUNT, false);
+        benchUpdate("update/partial/parallel", PARTIAL_ROOT_COUNT, true);
+        benchUpdate("update/clean", 0, false);
+    }
+
+private:
+    const BenchOptions& options;
+    BenchReport& report;
+    tf::Executor executor;
+    TransformHierarchy hierarchy;
+    std::vector<TransformHierarchy::NodeId> roots;
+
+    bool wanted(const std::string& name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    void addResult(const std::string& name, std::vector<std::pair<std::string, double>> parameters, std::vector<std::pair<std::string, SampleStats>> metrics)
+    {
+        parameters.push_back({ "nodes", (double)hierarchy.size() });
+        parameters.push_back({ "iterations", (double)options.iterations });
+        report.addResult({ .name = name, .parameters = std::move(parameters), .metrics = std::move(metrics) });
+    }
+
+    // Moves the first movedRoots roots, spread over the scene, then times the update
+    void benchUpdate(const std::string& name, uint32_t movedRoots, bool parallel)
+    {
+        if (!wanted(name))
+            return;
+
+        const uint32_t stride = movedRoots ? ROOT_COUNT / movedRoots : 1;
+        std::vector<double> samples;
+        for (uint32_t i = 0; i < options.iterations; i++)
+        {
+            for (uint32_t r = 0; r < movedRoots; r++)
+            {
+                TransformHierarchy::Transform transform = hierarchy.getLocalTransform(roots[r * stride]);
+                transform.position.y += 0.01f;
+                hierarchy.setLocalTransform(roots[r * stride], transform);
+            }
+
+            const Clock::time_point start = Clock::now();
+            hierarchy.update(parallel ? &executor : nullptr);
+            samples.push_back(millisecondsSince(start));
+        }
+
+        std::vector<std::pair<std::string, double>> parameters = {
+            { "updatedNodes", (double)hierarchy.getStats().updatedNodes },
+            { "workers", parallel ? (double)executor.num_workers() : 1.0 },
+        };
+        addResult(name, std::move(parameters), { { "totalMs", kholst::bench::computeSampleStats(samples) } });
+    }
+};
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: kholst-scene-bench [--iterations N] [--filter text] [--output path|-]\n");
+        return EXIT_FAILURE;
+    }
+
+    BenchReport report("kholst-scene-bench");
+#if defined(NDEBUG)
+    report.setContext("build", "release");
+#else
+    report.setContext("build", "debug");
+#endif
+
+    SceneBenchmarks(options, report).run();
+
+    // stderr keeps stdout clean for --output -
+    std::fprintf(stderr, "%s", report.toText().c_str());
+
+    std::string errorMsg;
+    if (!report.write(options.outputPath, errorMsg))
+    {
+        std::fprintf(stderr, "%s\n", errorMsg.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
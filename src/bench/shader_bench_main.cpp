@@ -0,0 +1,536 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "bench/bench_report.h"
+#include "render/shader/compiler/batch_compiler.h"
+#include "render/shader/compiler/compiler.h"
+
+// Shader compilation micro-benchmarks: times every stage of a module build
+// (load, compose, link, codegen) cold and warm, for the cube shader and for
+// generated modules of growing size and import depth, and compares serial,
+// parallel and cached builds. Results are written as JSON like kholst-bench.
+//
+//   kholst-shader-bench [--iterations N] [--filter text] [--output path|-]
+//
+// Run from the repository root, the cube shader is loaded from src/shaders.
+
+using kholst::bench::BenchReport;
+using kholst::bench::SampleStats;
+using kholst::render::shader::BatchCompiler;
+using kholst::render::shader::CompiledShader;
+using kholst::render::shader::ShaderCompileJob;
+using kholst::render::shader::ShaderCompileResult;
+using kholst::render::shader::ShaderCompileTimings;
+using kholst::render::shader::SlangCompiler;
+
+static const char* CUBE_SHADER_PATH = "src/shaders/cube.slang";
+
+static const uint32_t SYNTHETIC_FUNCTION_COUNTS[] = { 10, 100, 1000 };
+static const uint32_t SYNTHETIC_IMPORT_DEPTHS[] = { 1, 4, 16 };
+
+// Independent modules per batch for the serial and parallel comparison
+static constexpr uint32_t BATCH_MODULE_COUNT = 16;
+static constexpr uint32_t BATCH_MODULE_FUNCTIONS = 100;
+
+struct BenchOptions
+{
+    uint32_t iterations = 10;
+    std::string filter;
+    std::string outputPath = "kholst-shader-bench.json";
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& outOptions)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const char* arg = argv[i];
+        const char* value = argv[i + 1];
+        if (!std::strcmp(arg, "--iterations"))
+        {
+            char* end = nullptr;
+            outOptions.iterations = (uint32_t)std::strtoul(value, &end, 10);
+            if (end == value || *end != '\0' || !outOptions.iterations)
+                return false;
+        }
+        else if (!std::strcmp(arg, "--filter"))
+            outOptions.filter = value;
+        else if (!std::strcmp(arg, "--output"))
+            outOptions.outputPath = value;
+        else
+            return false;
+    }
+    return argc % 2 == 1;
+}
+
+// Stage timings collected over the iterations of one case
+struct StageSamples
+{
+    std::vector<double> cacheLookupMs;
+    std::vector<double> loadMs;
+    std::vector<double> composeMs;
+    std::vector<double> linkMs;
+    std::vector<double> codegenMs;
+    std::vector<double> totalMs;
+
+    void add(const ShaderCompileTimings& timings)
+    {
+        cacheLookupMs.push_back(timings.cacheLookupMs);
+        loadMs.push_back(timings.loadMs);
+        composeMs.push_back(timings.composeMs);
+        linkMs.push_back(timings.linkMs);
+        codegenMs.push_back(timings.codegenMs);
+        totalMs.push_back(timings.totalMs);
+    }
+
+    std::vector<std::pair<std::string, SampleStats>> toMetrics() const
+    {
+        return {
+            { "cacheLookupMs", kholst::bench::computeSampleStats(cacheLookupMs) },
+            { "loadMs", kholst::bench::computeSampleStats(loadMs) },
+            { "composeMs", kholst::bench::computeSampleStats(composeMs) },
+            { "linkMs", kholst::bench::computeSampleStats(linkMs) },
+            { "codegenMs", kholst::bench::computeSampleStats(codegenMs) },
+            { "totalMs", kholst::bench::computeSampleStats(totalMs) },
+        };
+    }
+};
+
+static bool writeFile(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(text.data(), (std::streamsize)text.size());
+    return (bool)file;
+}
+
+static std::string vertexFragmentEntryPoints(const std::string& colorExpression)
+{
+    return
+        "struct VertexOutput\n"
+        "{\n"
+        "    float4 position : SV_Position;\n"
+        "    float3 color;\n"
+        "};\n"
+        "\n"
+        "[shader(\"vertex\")]\n"
+        "VertexOutput vertexMain(uint vertexID : SV_VertexID)\n"
+        "{\n"
+        "    float2 uv = float2((vertexID << 1) & 2, vertexID & 2);\n"
+        "    VertexOutput output;\n"
+        "    output.position = float4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+        "    output.color = float3(uv, 0.5);\n"
+        "    return output;\n"
+        "}\n"
+        "\n"
+        "[shader(\"fragment\")]\n"
+        "float4 fragmentMain(VertexOutput input) : SV_Target\n"
+        "{\n"
+        "    float3 color = input.color;\n"
+        "    return float4(" + colorExpression + ", 1.0);\n"
+        "}\n";
+}
+
+// A module with functionCount functions, every one of them reachable from the fragment shader
+static std::string generateFunctionsModule(uint32_t functionCount)
+{
+    std::string source;
+    std::string sum = "color";
+    for (uint32_t i = 0; i < functionCount; i++)
+    {
+        const std::string name = "shade" + std::to_string(i);
+        source += "float3 " + name + "(float3 x)\n{\n";
+        source += "    return sin(x * " + std::to_string(i + 1) + ".0) * 0.5 + cos(x.yzx) * " + std::to_string(1.0 / (i + 1)) + ";\n}\n\n";
+        sum += " + " + name + "(color)";
+    }
+    return source + vertexFragmentEntryPoints("saturate(" + sum + ")");
+}
+
+// A chain of depth modules, each importing the next one
+static bool generateImportChain(const std::filesystem::path& directory, const std::string& prefix, uint32_t depth, std::filesystem::path& outRootPath)
+{
+    for (uint32_t level = 1; level <= depth; level++)
+    {
+        std::string source;
+        if (level < depth)
+            source += "import " + prefix + std::to_string(level + 1) + ";\n\n";
+        source += "float3 level" + std::to_string(level) + "(float3 x)\n{\n";
+        source += level < depth ?
+            "    return level" + std::to_string(level + 1) + "(x.yzx) * 0.9 + 0.1;\n}\n" :
+            std::string("    return x;\n}\n");
+        if (!writeFile(directory / (prefix + std::to_string(level) + ".slang"), source))
+            return false;
+    }
+
+    outRootPath = directory / (prefix + "0.slang");
+    return writeFile(outRootPath, "import " + prefix + "1;\n\n" + vertexFragmentEntryPoints("level1(color)"));
+}
+
+static ShaderCompileJob vertexFragmentJob(const std::string& path, const char* vertexEntry, const char* fragmentEntry)
+{
+    return {
+        .shaderPath = path,
+        .entryPoints = {
+            { .name = vertexEntry, .stage = SLANG_STAGE_VERTEX },
+            { .name = fragmentEntry, .stage = SLANG_STAGE_FRAGMENT },
+        },
+    };
+}
+
+class ShaderBenchmarks
+{
+public:
+    ShaderBenchmarks(const BenchOptions& options, BenchReport& report, std::filesystem::path workDirectory)
+    : options(options)
+    , report(report)
+    , workDirectory(std::move(workDirectory))
+    {
+    }
+
+    bool run()
+    {
+        if (!prototype.initialize(SLANG_SPIRV))
+        {
+            std::fprintf(stderr, "Failed to initialize Slang: %s\n", prototype.getLastDiagnostics().c_str());
+            return false;
+        }
+
+        benchInitialize();
+
+        const ShaderCompileJob cube = vertexFragmentJob(CUBE_SHADER_PATH, "cubeVertex", "cubeFragment");
+        benchCompile("cube/cold", cube, true);
+        benchCompile("cube/warm", cube, false);
+        benchCached("cube/cached", cube);
+        benchStartup(cube);
+
+        for (uint32_t functionCount : SYNTHETIC_FUNCTION_COUNTS)
+        {
+            const std::string name = "functions" + std::to_string(functionCount);
+            const std::filesystem::path path = workDirectory / (name + ".slang");
+            if (!writeFile(path, generateFunctionsModule(functionCount)))
+                return fail("Failed to write " + path.string());
+
+            const ShaderCompileJob job = vertexFragmentJob(path.string(), "vertexMain", "fragmentMain");
+            benchCompile("synthetic/" + name + "/cold", job, true, { { "functions", (double)functionCount } });
+            benchCompile("synthetic/" + name + "/warm", job, false, { { "functions", (double)functionCount } });
+        }
+
+        for (uint32_t depth : SYNTHETIC_IMPORT_DEPTHS)
+        {
+            const std::string prefix = "imports" + std::to_string(depth) + "_";
+            std::filesystem::path rootPath;
+            if (!generateImportChain(workDirectory, prefix, depth, rootPath))
+                return fail("Failed to write the import chain of depth " + std::to_string(depth));
+
+            const ShaderCompileJob job = vertexFragmentJob(rootPath.string(), "vertexMain", "fragmentMain");
+            benchCompile("synthetic/imports" + std::to_string(depth) + "/cold", job, true, { { "importDepth", (double)depth } });
+        }
+
+        benchBatch();
+        return !failed;
+    }
+
+private:
+    const BenchOptions& options;
+    BenchReport& report;
+    std::filesystem::path workDirectory;
+    SlangCompiler prototype;
+    uint32_t batchGeneration = 0;
+    bool failed = false; // A case failed, the others still run
+
+    bool wanted(const std::string& name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    bool fail(const std::string& message)
+    {
+        failed = true;
+        std::fprintf(stderr, "%s\n", message.c_str());
+        return false;
+    }
+
+    void addResult(const std::string& name, std::vector<std::pair<std::string, double>> parameters, std::vector<std::pair<std::string, SampleStats>> metrics)
+    {
+        parameters.push_back({ "iterations", (double)options.iterations });
+        report.addResult({ .name = name, .parameters = std::move(parameters), .metrics = std::move(metrics) });
+    }
+
+    // Creating the global session loads the core module and dominates startup;
+    // a session on a shared global session is what every extra compiler costs
+    void benchInitialize()
+    {
+        if (wanted("initialize/global-session"))
+        {
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                const Clock::time_point start = Clock::now();
+                SlangCompiler compiler;
+                compiler.initialize(SLANG_SPIRV);
+                samples.push_back(millisecondsSince(start));
+            }
+            addResult("initialize/global-session", {}, { { "totalMs", kholst::bench::computeSampleStats(samples) } });
+        }
+
+        if (wanted("initialize/session"))
+        {
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                const Clock::time_point start = Clock::now();
+                SlangCompiler compiler;
+                compiler.initialize(prototype.getGlobalSession(), SLANG_SPIRV);
+                samples.push_back(millisecondsSince(start));
+            }
+            addResult("initialize/session", {}, { { "totalMs", kholst::bench::computeSampleStats(samples) } });
+        }
+    }
+
+    // Cold starts every iteration from a fresh session, warm reuses the one
+    // that already loaded the module
+    void benchCompile(const std::string& name, const ShaderCompileJob& job, bool cold, std::vector<std::pair<std::string, double>> parameters = {})
+    {
+        if (!wanted(name))
+            return;
+
+        SlangCompiler compiler;
+        compiler.initialize(prototype.getGlobalSession(), SLANG_SPIRV);
+
+        std::vector<CompiledShader> shaders;
+        std::string errorMsg;
+        if (!cold && !compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+        {
+            fail(name + ": " + errorMsg);
+            return;
+        }
+
+        StageSamples samples;
+        for (uint32_t i = 0; i < options.iterations; i++)
+        {
+            if (cold)
+                compiler.resetSession();
+
+            if (!compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+            {
+                fail(name + ": " + errorMsg);
+                return;
+            }
+            samples.add(compiler.getLastTimings());
+        }
+        addResult(name, std::move(parameters), samples.toMetrics());
+    }
+
+    // Every iteration a fresh session, served from a SPIR-V cache populated up front
+    void benchCached(const std::string& name, const ShaderCompileJob& job)
+    {
+        if (!wanted(name))
+            return;
+
+        SlangCompiler compiler;
+        compiler.initialize(prototype.getGlobalSession(), SLANG_SPIRV);
+        compiler.enableCache((workDirectory / "cache").string());
+
+        std::vector<CompiledShader> shaders;
+        std::string errorMsg;
+        if (!compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+        {
+            fail(name + ": " + errorMsg);
+            return;
+        }
+
+        StageSamples samples;
+        for (uint32_t i = 0; i < options.iterations; i++)
+        {
+            compiler.resetSession();
+            if (!compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+            {
+                fail(name + ": " + errorMsg);
+                return;
+            }
+            samples.add(compiler.getLastTimings());
+        }
+        addResult(name, {}, samples.toMetrics());
+    }
+
+    // Time from a new compiler to the first shaders served from a warm cache,
+    // with the global session created up front or in the background
+    void benchStartup(const ShaderCompileJob& job)
+    {
+        if (!wanted("startup/sync-cached") && !wanted("startup/async-cached"))
+            return;
+
+        const std::string cacheDirectory = (workDirectory / "cache").string();
+        std::vector<CompiledShader> shaders;
+        std::string errorMsg;
+        {
+            SlangCompiler compiler;
+            compiler.initialize(prototype.getGlobalSession(), SLANG_SPIRV);
+            compiler.enableCache(cacheDirectory);
+            if (!compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+            {
+                fail("startup: " + errorMsg);
+                return;
+            }
+        }
+
+        for (bool async : { false, true })
+        {
+            const std::string name = async ? "startup/async-cached" : "startup/sync-cached";
+            if (!wanted(name))
+                continue;
+
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                // The destructor joins the background global session, outside the sample
+                SlangCompiler compiler;
+                const Clock::time_point start = Clock::now();
+                if (async)
+                    compiler.initializeAsync(SLANG_SPIRV);
+                else
+                    compiler.initialize(SLANG_SPIRV);
+                compiler.enableCache(cacheDirectory);
+
+                if (!compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+                {
+                    fail(name + ": " + errorMsg);
+                    return;
+                }
+                samples.push_back(millisecondsSince(start));
+            }
+            addResult(name, {}, { { "totalMs", kholst::bench::computeSampleStats(samples) } });
+        }
+    }
+
+    // Fresh module names per batch, so no session has seen them before
+    std::vector<ShaderCompileJob> generateBatch()
+    {
+        std::vector<ShaderCompileJob> jobs;
+        const std::string source = generateFunctionsModule(BATCH_MODULE_FUNCTIONS);
+        for (uint32_t i = 0; i < BATCH_MODULE_COUNT; i++)
+        {
+            const std::filesystem::path path = workDirectory /
+                ("batch" + std::to_string(batchGeneration) + "_" + std::to_string(i) + ".slang");
+            writeFile(path, source);
+            jobs.push_back(vertexFragmentJob(path.string(), "vertexMain", "fragmentMain"));
+        }
+        batchGeneration++;
+        return jobs;
+    }
+
+    void benchBatch()
+    {
+        const std::vector<std::pair<std::string, double>> parameters = {
+            { "modules", (double)BATCH_MODULE_COUNT },
+            { "functions", (double)BATCH_MODULE_FUNCTIONS },
+        };
+
+        if (wanted("batch/serial"))
+        {
+            SlangCompiler compiler;
+            compiler.initialize(prototype.getGlobalSession(), SLANG_SPIRV);
+
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                const std::vector<ShaderCompileJob> jobs = generateBatch();
+                const Clock::time_point start = Clock::now();
+                for (const ShaderCompileJob& job : jobs)
+                {
+                    std::vector<CompiledShader> shaders;
+                    std::string errorMsg;
+                    if (!compiler.compileEntryPoints(job.shaderPath, job.entryPoints, shaders, errorMsg))
+                        fail("batch/serial: " + errorMsg);
+                }
+                samples.push_back(millisecondsSince(start));
+            }
+            addResult("batch/serial", parameters, { { "totalMs", kholst::bench::computeSampleStats(samples) } });
+        }
+
+        if (wanted("batch/parallel"))
+        {
+            BatchCompiler batch;
+            std::string errorMsg;
+            if (!batch.initialize(prototype, 0, errorMsg))
+            {
+                fail("batch/parallel: " + errorMsg);
+                return;
+            }
+
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                const std::vector<ShaderCompileJob> jobs = generateBatch();
+                const Clock::time_point start = Clock::now();
+                for (std::future<ShaderCompileResult>& future : batch.submit(jobs))
+                {
+                    const ShaderCompileResult result = future.get();
+                    if (!result.success)
+                        fail("batch/parallel: " + result.errorMsg);
+                }
+                samples.push_back(millisecondsSince(start));
+            }
+
+            std::vector<std::pair<std::string, double>> parallelParameters = parameters;
+            parallelParameters.push_back({ "workers", (double)batch.getWorkerCount() });
+            addResult("batch/parallel", std::move(parallelParameters), { { "totalMs", kholst::bench::computeSampleStats(samples) } });
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: kholst-shader-bench [--iterations N] [--filter text] [--output path|-]\n");
+        return EXIT_FAILURE;
+    }
+
+    std::error_code error;
+    const std::filesystem::path workDirectory = std::filesystem::temp_directory_path(error) / "kholst-shader-bench";
+    std::filesystem::remove_all(workDirectory, error);
+    if (!std::filesystem::create_directories(workDirectory, error))
+    {
+        std::fprintf(stderr, "Failed to create %s: %s\n", workDirectory.string().c_str(), error.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    BenchReport report("kholst-shader-bench");
+    report.setContext("slang", spGetBuildTagString());
+#if defined(NDEBUG)
+    report.setContext("build", "release");
+#else
+    report.setContext("build", "debug");
+#endif
+
+    const bool success = ShaderBenchmarks(options, report, workDirectory).run();
+    std::filesystem::remove_all(workDirectory, error);
+
+    // stderr keeps stdout clean for --output -
+    std::fprintf(stderr, "%s", report.toText().c_str());
+
+    std::string errorMsg;
+    if (!report.write(options.outputPath, errorMsg))
+    {
+        std::fprintf(stderr, "%s\n", errorMsg.c_str());
+        return EXIT_FAILURE;
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
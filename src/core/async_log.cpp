@@ -0,0 +1,262 @@
+#include "async_log.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include <minilog/minilog.h>
+
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace core
+{
+
+// Messages up to this length are formatted without allocating
+static constexpr size_t FORMAT_BUFFER_SIZE = 1024;
+
+static minilog::eLogLevel toMinilogLevel(AsyncLog::Level level)
+{
+    switch (level)
+    {
+    case AsyncLog::Level::Debug:
+        return minilog::Debug;
+    case AsyncLog::Level::Info:
+        return minilog::Log;
+    case AsyncLog::Level::Warning:
+        return minilog::Warning;
+    }
+    return minilog::Log;
+}
+
+AsyncLog::~AsyncLog()
+{
+    stop();
+}
+
+bool AsyncLog::start(const Config& config, std::string& outErrorMsg)
+{
+    stop();
+
+    const size_t slotCount = std::bit_ceil(std::max<size_t>(config.capacityBytes / SLOT_SIZE, 16));
+    if (slotCount / 4 > UINT16_MAX)
+    {
+        outErrorMsg = "Log ring of " + std::to_string(config.capacityBytes) + " bytes is too large";
+        return false;
+    }
+
+    slots = std::make_unique<Slot[]>(slotCount);
+    for (size_t i = 0; i < slotCount; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    slotMask = slotCount - 1;
+    maxRecordSlots = (uint32_t)(slotCount / 4);
+    dropBelow = config.dropBelow;
+
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos = 0;
+    stopping.store(false, std::memory_order_relaxed);
+    written = 0;
+    dropped = 0;
+    truncated = 0;
+    waits = 0;
+
+    flusher = std::thread(&AsyncLog::flushLoop, this);
+    running.store(true, std::memory_order_release);
+    return true;
+}
+
+void AsyncLog::stop()
+{
+    if (!flusher.joinable())
+        return;
+
+    running.store(false, std::memory_order_release);
+    stopping.store(true, std::memory_order_release);
+    wakeFlusher();
+    flusher.join();
+
+    slots.reset();
+}
+
+void AsyncLog::write(Level level, const char* format, ...)
+{
+    char buffer[FORMAT_BUFFER_SIZE];
+
+    va_list args;
+    va_start(args, format);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    const int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length < 0)
+    {
+        va_end(argsCopy);
+        return;
+    }
+
+    if ((size_t)length < sizeof(buffer))
+    {
+        va_end(argsCopy);
+        writeText(level, std::string_view(buffer, (size_t)length));
+        return;
+    }
+
+    // Long diagnostics and dumps, rare enough to allocate for
+    std::string text((size_t)length, '\0');
+    std::vsnprintf(text.data(), text.size() + 1, format, argsCopy);
+    va_end(argsCopy);
+    writeText(level, text);
+}
+
+void AsyncLog::writeText(Level level, std::string_view text)
+{
+    if (!running.load(std::memory_order_acquire))
+    {
+        minilog::log(toMinilogLevel(level), "%.*s", (int)text.size(), text.data());
+        return;
+    }
+
+    uint32_t slotCount = std::max<uint32_t>(1, (uint32_t)((text.size() + SLOT_TEXT_SIZE - 1) / SLOT_TEXT_SIZE));
+    if (slotCount > maxRecordSlots)
+    {
+        slotCount = maxRecordSlots;
+        text = text.substr(0, slotCount * SLOT_TEXT_SIZE);
+        truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The flusher frees slots in order, so when the record's last slot is
+    // free for this lap, the ones before it are too
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        const uint64_t last = pos + slotCount - 1;
+        const uint64_t sequence = slots[last & slotMask].sequence.load(std::memory_order_acquire);
+        const int64_t diff = (int64_t)(sequence - last);
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + slotCount, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // Full
+            if (level < dropBelow)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            waits.fetch_add(1, std::memory_order_relaxed);
+            wakeFlusher();
+            std::this_thread::yield();
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            // Another producer took the slots first
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    for (uint32_t i = 0; i < slotCount; i++)
+    {
+        const size_t offset = i * SLOT_TEXT_SIZE;
+        const size_t size = std::min(SLOT_TEXT_SIZE, text.size() - offset);
+        std::memcpy(slots[(pos + i) & slotMask].text, text.data() + offset, size);
+    }
+
+    Slot& head = slots[pos & slotMask];
+    head.length = (uint32_t)text.size();
+    head.slotCount = (uint16_t)slotCount;
+    head.level = level;
+    head.sequence.store(pos + 1, std::memory_order_release);
+
+    written.fetch_add(1, std::memory_order_relaxed);
+    wakeFlusher();
+}
+
+AsyncLog::Stats AsyncLog::getStats() const
+{
+    return {
+        .written = written.load(std::memory_order_relaxed),
+        .dropped = dropped.load(std::memory_order_relaxed),
+        .truncated = truncated.load(std::memory_order_relaxed),
+        .waits = waits.load(std::memory_order_relaxed),
+    };
+}
+
+void AsyncLog::wakeFlusher()
+{
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+}
+
+void AsyncLog::drain()
+{
+    const uint64_t capacity = slotMask + 1;
+    std::string text;
+
+    for (;;)
+    {
+        Slot& head = slots[dequeuePos & slotMask];
+        if (head.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+            break;
+
+        const uint32_t slotCount = head.slotCount;
+        const Level level = head.level;
+        text.resize(head.length);
+        for (uint32_t i = 0; i < slotCount; i++)
+        {
+            const size_t offset = i * SLOT_TEXT_SIZE;
+            const size_t size = std::min(SLOT_TEXT_SIZE, text.size() - offset);
+            std::memcpy(text.data() + offset, slots[(dequeuePos + i) & slotMask].text, size);
+        }
+
+        for (uint32_t i = 0; i < slotCount; i++)
+            slots[(dequeuePos + i) & slotMask].sequence.store(dequeuePos + i + capacity, std::memory_order_release);
+        dequeuePos += slotCount;
+
+        minilog::log(toMinilogLevel(level), "%s", text.c_str());
+    }
+}
+
+void AsyncLog::flushLoop()
+{
+    KHOLST_PROFILER_THREAD("Log flusher");
+
+    uint64_t droppedReported = 0;
+    for (;;)
+    {
+        // Read before draining, a message published after the drain changes it and wait() returns
+        const uint32_t seen = wakeups.load(std::memory_order_acquire);
+        const bool stopRequested = stopping.load(std::memory_order_acquire);
+
+        drain();
+
+        const uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+        if (droppedNow != droppedReported)
+        {
+            minilog::log(minilog::Warning, "Log ring full, %llu messages dropped\n",
+                (unsigned long long)(droppedNow - droppedReported));
+            droppedReported = droppedNow;
+        }
+
+        if (stopRequested)
+            break;
+
+        wakeups.wait(seen, std::memory_order_acquire);
+    }
+}
+
+AsyncLog& getLog()
+{
+    static AsyncLog log;
+    return log;
+}
+
+} // namespace core
+} // namespace kholst
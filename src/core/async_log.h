@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Lock-free log front end, a background thread does the I/O
+ *
+ * Producers format a message and copy it into a bounded ring of fixed-size
+ * slots; a message spanning several slots reserves them with a single CAS,
+ * so records from different threads never interleave. The flusher thread
+ * drains the ring in order and hands every message to minilog, which keeps
+ * writing the console and the log file, just no longer on the caller's
+ * thread.
+ *
+ * When the ring is full, messages below Config::dropBelow are dropped and
+ * counted, the flusher reports the count; the rest wait for space. Messages
+ * longer than a quarter of the ring are truncated.
+ *
+ * Before start() and after stop(), write() logs synchronously through
+ * minilog, so the KHOLST_LOG* macros are safe at any time.
+ *
+ * Thread-safety: write() from any thread, start() and stop() while no
+ * other thread logs.
+ */
+class AsyncLog
+{
+public:
+    enum class Level : uint8_t
+    {
+        Debug,
+        Info,
+        Warning,
+    };
+
+    struct Config
+    {
+        size_t capacityBytes = 1 << 20; // Rounded up to a power of two of slots
+        Level dropBelow = Level::Warning; // Lower levels are dropped when the ring is full
+    };
+
+    struct Stats
+    {
+        uint64_t written = 0; // Messages that went into the ring
+        uint64_t dropped = 0;
+        uint64_t truncated = 0;
+        uint64_t waits = 0; // Times a producer waited for space
+    };
+
+    AsyncLog() = default;
+    ~AsyncLog();
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+    /**
+     * @brief Allocate the ring and start the flusher thread
+     *
+     * @param config Ring size and overflow policy
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool start(const Config& config, std::string& outErrorMsg);
+
+    // Write out everything queued and stop the flusher thread
+    void stop();
+
+    // Format and queue a message, printf-style like LLOGW
+    void write(Level level, const char* format, ...);
+
+    // Queue a formatted message
+    void writeText(Level level, std::string_view text);
+
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    Stats getStats() const;
+
+private:
+    static constexpr size_t SLOT_SIZE = 128;
+    static constexpr size_t SLOT_HEADER_SIZE = 16;
+    static constexpr size_t SLOT_TEXT_SIZE = SLOT_SIZE - SLOT_HEADER_SIZE;
+
+    // The first slot of a record carries its header, the others only text
+    struct alignas(64) Slot
+    {
+        // Position + 1 once a record starting here is published, position + capacity once drained
+        std::atomic<uint64_t> sequence;
+        uint32_t length;
+        uint16_t slotCount;
+        Level level;
+        char text[SLOT_TEXT_SIZE];
+    };
+    static_assert(sizeof(Slot) == SLOT_SIZE);
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t slotMask = 0;
+    uint32_t maxRecordSlots = 0;
+    Level dropBelow = Level::Warning;
+
+    alignas(64) std::atomic<uint64_t> enqueuePos = 0;
+    alignas(64) uint64_t dequeuePos = 0; // Flusher thread only
+    std::atomic<uint32_t> wakeups = 0;
+
+    std::atomic<bool> running = false;
+    std::atomic<bool> stopping = false;
+    std::thread flusher;
+
+    std::atomic<uint64_t> written = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<uint64_t> truncated = 0;
+    std::atomic<uint64_t> waits = 0;
+
+    void flushLoop();
+    void drain();
+    void wakeFlusher();
+};
+
+// Log of the app, started by main()
+AsyncLog& getLog();
+
+} // namespace core
+} // namespace kholst
+
+#define KHOLST_LOGD(...) kholst::core::getLog().write(kholst::core::AsyncLog::Level::Debug, __VA_ARGS__)
+#define KHOLST_LOGL(...) kholst::core::getLog().write(kholst::core::AsyncLog::Level::Info, __VA_ARGS__)
+#define KHOLST_LOGW(...) kholst::core::getLog().write(kholst::core::AsyncLog::Level::Warning, __VA_ARGS__)
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Appends trivially copyable values and strings to a byte buffer
+ *
+ * Values are written in host byte order; the resulting blobs are caches and
+ * archives produced and consumed on the same machine or platform.
+ */
+class BinaryWriter
+{
+public:
+    template<typename ValueType>
+        requires std::is_trivially_copyable_v<ValueType>
+    void write(const ValueType& value)
+    {
+        writeBytes(&value, sizeof(value));
+    }
+
+    void writeBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    // Length-prefixed with a uint32_t
+    void writeString(const std::string& str)
+    {
+        write((uint32_t)str.size());
+        writeBytes(str.data(), str.size());
+    }
+
+    const std::vector<uint8_t>& getBuffer() const { return buffer; }
+    std::vector<uint8_t>&& takeBuffer() { return std::move(buffer); }
+
+private:
+    std::vector<uint8_t> buffer;
+};
+
+/**
+ * @brief Reads values written by BinaryWriter from a non-owned byte range
+ *
+ * Every read past the end fails and latches the reader into a failed state,
+ * so callers can issue a sequence of reads and check ok() once.
+ */
+class BinaryReader
+{
+public:
+    BinaryReader(const void* data, size_t size)
+        : cursor(static_cast<const uint8_t*>(data))
+        , end(cursor + size)
+    {
+    }
+
+    template<typename ValueType>
+        requires std::is_trivially_copyable_v<ValueType>
+    bool read(ValueType& value)
+    {
+        return readBytes(&value, sizeof(value));
+    }
+
+    bool readBytes(void* data, size_t size)
+    {
+        if (failed || (size_t)(end - cursor) < size)
+        {
+            failed = true;
+            return false;
+        }
+
+        std::memcpy(data, cursor, size);
+        cursor += size;
+        return true;
+    }
+
+    bool readString(std::string& str)
+    {
+        uint32_t length = 0;
+        if (!read(length) || (size_t)(end - cursor) < length)
+        {
+            failed = true;
+            return false;
+        }
+
+        str.assign(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+        return true;
+    }
+
+    bool ok() const { return !failed; }
+    size_t remaining() const { return (size_t)(end - cursor); }
+
+private:
+    const uint8_t* cursor = nullptr;
+    const uint8_t* end = nullptr;
+    bool failed = false;
+};
+
+} // namespace core
+} // namespace kholst
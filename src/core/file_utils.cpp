@@ -0,0 +1,49 @@
+#include "file_utils.h"
+
+#include <fstream>
+
+namespace kholst
+{
+namespace core
+{
+
+bool writeFileAtomic(const std::filesystem::path& path, const std::vector<uint8_t>& bytes, std::string& outErrorMsg)
+{
+    std::error_code ec;
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            outErrorMsg = "Failed to open " + tempPath.string();
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!file.good())
+        {
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            outErrorMsg = "Failed to write " + tempPath.string();
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        outErrorMsg = "Failed to replace " + path.string();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace core
+} // namespace kholst
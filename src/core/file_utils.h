@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Replace a file with new contents
+ *
+ * Writes to path + ".tmp" and renames it over path, so a crash mid-write
+ * never leaves a truncated file behind. Creates missing parent directories.
+ *
+ * @param path File to write
+ * @param bytes New contents
+ * @param outErrorMsg Error description on failure
+ * @return true on success
+ */
+bool writeFileAtomic(const std::filesystem::path& path, const std::vector<uint8_t>& bytes, std::string& outErrorMsg);
+
+} // namespace core
+} // namespace kholst
@@ -0,0 +1,128 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace core
+{
+
+FrameArena::FrameArena(size_t initialCapacity)
+{
+    addBlock(std::max(initialCapacity, BLOCK_ALIGNMENT));
+}
+
+FrameArena::~FrameArena()
+{
+    for (Block& block : blocks)
+        freeBlock(block);
+}
+
+FrameArena::Block FrameArena::allocateBlock(size_t size)
+{
+    return { .data = static_cast<std::byte*>(::operator new(size, std::align_val_t(BLOCK_ALIGNMENT))), .size = size };
+}
+
+void FrameArena::freeBlock(Block& block)
+{
+    ::operator delete(block.data, std::align_val_t(BLOCK_ALIGNMENT));
+    block = {};
+}
+
+void FrameArena::addBlock(size_t minSize)
+{
+    // Double each time, so a frame that outgrows the arena adds few blocks
+    const size_t size = std::max(minSize, blocks.empty() ? minSize : blocks.back().size * 2);
+    blocks.push_back(allocateBlock(size));
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+    bytes = std::max<size_t>(bytes, 1);
+
+    for (;;)
+    {
+        Block& block = blocks[currentBlock];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+        const size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + bytes <= block.size)
+        {
+            offset = aligned + bytes;
+            return block.data + aligned;
+        }
+
+        usedInPreviousBlocks += offset;
+        offset = 0;
+        if (++currentBlock == blocks.size())
+            addBlock(bytes + alignment);
+    }
+}
+
+void FrameArena::reset()
+{
+    const size_t used = usedInPreviousBlocks + offset;
+    peak = std::max(peak, used);
+
+    // Fold the overflow blocks into one big enough for the whole frame
+    if (blocks.size() > 1)
+    {
+        KHOLST_PROFILER_ZONE("Grow frame arena");
+
+        size_t capacity = 0;
+        for (Block& block : blocks)
+        {
+            capacity += block.size;
+            freeBlock(block);
+        }
+        blocks.clear();
+        blocks.push_back(allocateBlock(capacity));
+    }
+
+    currentBlock = 0;
+    offset = 0;
+    usedInPreviousBlocks = 0;
+}
+
+FrameArena::Stats FrameArena::getStats() const
+{
+    Stats stats = {
+        .used = usedInPreviousBlocks + offset,
+        .blockCount = blocks.size(),
+    };
+    for (const Block& block : blocks)
+        stats.capacity += block.size;
+    stats.peak = std::max(peak, stats.used);
+    return stats;
+}
+
+void FrameArenas::initialize(uint32_t framesInFlight, size_t bytesPerFrame)
+{
+    arenas.clear();
+    for (uint32_t i = 0; i < std::max(framesInFlight, 1u); i++)
+        arenas.push_back(std::make_unique<FrameArena>(bytesPerFrame));
+    // The first beginFrame() moves to arena 0
+    currentFrame = (uint32_t)arenas.size() - 1;
+}
+
+FrameArena& FrameArenas::beginFrame()
+{
+    // Used before initialize() or after a failed one, a single default arena stands in
+    if (arenas.empty())
+        arenas.push_back(std::make_unique<FrameArena>());
+
+    currentFrame = (currentFrame + 1) % (uint32_t)arenas.size();
+    FrameArena& arena = *arenas[currentFrame];
+    arena.reset();
+    return arena;
+}
+
+void FrameArenas::clear()
+{
+    arenas.clear();
+    currentFrame = 0;
+}
+
+} // namespace core
+} // namespace kholst
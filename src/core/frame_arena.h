@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Linear allocator for CPU data that lives for one frame
+ *
+ * Allocation bumps an offset into the current block; nothing is freed
+ * individually, reset() rewinds everything at once. When a frame needs more
+ * than the arena holds, extra blocks are chained on. The next reset() folds
+ * them into a single block of the combined size, so once the arena has seen
+ * its largest frame it never touches the global heap again.
+ *
+ * Also a std::pmr::memory_resource, so std::pmr containers can live in it.
+ * Their deallocations are no-ops and destructors are never run by the
+ * arena: the objects it holds have to be trivially destructible or cleaned
+ * up by their owner before reset().
+ *
+ * Thread-safety: not thread-safe.
+ */
+class FrameArena final : public std::pmr::memory_resource
+{
+public:
+    struct Stats
+    {
+        size_t used = 0; // Since the last reset(), including alignment padding
+        size_t capacity = 0;
+        size_t peak = 0; // Largest frame seen
+        size_t blockCount = 0;
+    };
+
+    explicit FrameArena(size_t initialCapacity = 64 * 1024);
+    ~FrameArena() override;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Construct a trivially destructible object in the arena
+    template<typename ValueType, typename... Args>
+        requires std::is_trivially_destructible_v<ValueType>
+    ValueType* create(Args&&... args)
+    {
+        return new (allocate(sizeof(ValueType), alignof(ValueType))) ValueType(std::forward<Args>(args)...);
+    }
+
+    // Default-initialized array, elements are not zeroed
+    template<typename ValueType>
+        requires std::is_trivially_default_constructible_v<ValueType> && std::is_trivially_destructible_v<ValueType>
+    std::span<ValueType> allocateArray(size_t count)
+    {
+        if (!count)
+            return {};
+        return { new (allocate(sizeof(ValueType) * count, alignof(ValueType))) ValueType[count], count };
+    }
+
+    // Release every allocation, memory from earlier allocations must not be used afterwards
+    void reset();
+
+    Stats getStats() const;
+
+private:
+    struct Block
+    {
+        std::byte* data = nullptr;
+        size_t size = 0;
+    };
+
+    static constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+    std::vector<Block> blocks;
+    size_t currentBlock = 0;
+    size_t offset = 0; // Into blocks[currentBlock]
+    size_t usedInPreviousBlocks = 0;
+    size_t peak = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void addBlock(size_t minSize);
+    static Block allocateBlock(size_t size);
+    static void freeBlock(Block& block);
+};
+
+/**
+ * @brief One FrameArena per frame in flight
+ *
+ * Mirrors FrameRing on the CPU side: beginFrame() moves on to the next
+ * arena and resets it, so data allocated during a frame stays valid until
+ * the same slot comes around again, framesInFlight frames later. That is
+ * long enough to hand it to work that completes with the frame, such as
+ * deferred destruction or background jobs waited on before the slot is
+ * reused.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class FrameArenas
+{
+public:
+    void initialize(uint32_t framesInFlight, size_t bytesPerFrame);
+
+    // Advance to and reset the next frame's arena, creates one default arena if there are none
+    FrameArena& beginFrame();
+
+    // Arena of the last beginFrame(), which must have been called
+    FrameArena& current() { return *arenas[currentFrame]; }
+
+    bool empty() const { return arenas.empty(); }
+
+    void clear();
+
+private:
+    std::vector<std::unique_ptr<FrameArena>> arenas;
+    uint32_t currentFrame = 0;
+};
+
+} // namespace core
+} // namespace kholst
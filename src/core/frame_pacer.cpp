@@ -0,0 +1,82 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace core
+{
+
+// Remaining time below which the limiter spins instead of sleeping
+static constexpr std::chrono::microseconds SPIN_THRESHOLD{ 2000 };
+
+void FramePacer::waitForNextFrame(double targetFps)
+{
+    KHOLST_PROFILER_ZONE_COLOR("Frame pacing", KHOLST_PROFILER_COLOR_WAIT);
+
+    if (targetFps > 0.0 && hasPreviousFrame)
+    {
+        const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+        Clock::time_point now = Clock::now();
+
+        // Deadlines advance by whole periods so the average rate stays on
+        // target, but a frame that ran long is not caught up on afterwards
+        nextDeadline += period;
+        if (nextDeadline < now)
+            nextDeadline = now;
+
+        if (nextDeadline - now > SPIN_THRESHOLD)
+            std::this_thread::sleep_for(nextDeadline - now - SPIN_THRESHOLD);
+
+        while (Clock::now() < nextDeadline)
+            std::this_thread::yield();
+    }
+
+    const Clock::time_point frameStart = Clock::now();
+    if (targetFps <= 0.0 || !hasPreviousFrame)
+        nextDeadline = frameStart;
+
+    if (hasPreviousFrame)
+    {
+        frameTimesMs[nextFrame] = std::chrono::duration<float, std::milli>(frameStart - previousFrameStart).count();
+        nextFrame = (nextFrame + 1) % FRAME_WINDOW;
+        frameCount = std::min(frameCount + 1, FRAME_WINDOW);
+    }
+
+    previousFrameStart = frameStart;
+    hasPreviousFrame = true;
+}
+
+void FramePacer::reset()
+{
+    hasPreviousFrame = false;
+}
+
+FramePacer::Stats FramePacer::getStats() const
+{
+    if (!frameCount)
+        return {};
+
+    std::array<float, FRAME_WINDOW> sorted = frameTimesMs;
+    std::sort(sorted.begin(), sorted.begin() + frameCount);
+
+    double total = 0.0;
+    for (size_t i = 0; i < frameCount; i++)
+        total += sorted[i];
+
+    const double averageMs = total / frameCount;
+    return {
+        .frameCount = frameCount,
+        .averageMs = averageMs,
+        .minMs = sorted[0],
+        .maxMs = sorted[frameCount - 1],
+        .p99Ms = sorted[std::min(frameCount - 1, frameCount * 99 / 100)],
+        .fps = averageMs > 0.0 ? 1000.0 / averageMs : 0.0,
+    };
+}
+
+} // namespace core
+} // namespace kholst
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Frame rate limiter and frame time statistics
+ *
+ * waitForNextFrame() sleeps for most of the remaining frame budget and spins
+ * for the last part, since OS sleeps routinely overshoot by a millisecond or
+ * more. Frame times are kept in a fixed window of recent frames.
+ *
+ * Thread-safety: not thread-safe, use from the thread driving the frame loop.
+ */
+class FramePacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        size_t frameCount = 0; // Frames in the statistics window
+        double averageMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        double p99Ms = 0.0;
+        double fps = 0.0;
+    };
+
+    /**
+     * @brief Block until the next frame should start and record its frame time
+     *
+     * Call once per frame, before recording it.
+     *
+     * @param targetFps Frame rate to limit to, 0 or less renders unthrottled
+     */
+    void waitForNextFrame(double targetFps);
+
+    // Forget the previous frame, call after the loop was paused so the pause
+    // is neither counted as a frame nor caught up on
+    void reset();
+
+    Stats getStats() const;
+
+private:
+    static constexpr size_t FRAME_WINDOW = 240;
+
+    std::array<float, FRAME_WINDOW> frameTimesMs = {};
+    size_t frameCount = 0;
+    size_t nextFrame = 0;
+
+    bool hasPreviousFrame = false;
+    Clock::time_point previousFrameStart;
+    Clock::time_point nextDeadline;
+};
+
+} // namespace core
+} // namespace kholst
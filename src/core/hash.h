@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Incremental 64-bit FNV-1a hasher
+ *
+ * Used for content-addressed keys (shader cache entries, pipeline variants).
+ * Not a cryptographic hash: collisions are unlikely but possible, so callers
+ * that persist data keyed by it should also validate what they load.
+ */
+class Hasher
+{
+public:
+    static constexpr uint64_t kOffsetBasis = 0xcbf29ce484222325ull;
+    static constexpr uint64_t kPrime = 0x100000001b3ull;
+
+    Hasher& add(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            state ^= bytes[i];
+            state *= kPrime;
+        }
+        return *this;
+    }
+
+    // Strings are length-prefixed so that ("ab", "c") and ("a", "bc") differ
+    Hasher& add(std::string_view str)
+    {
+        const uint64_t length = str.size();
+        add(&length, sizeof(length));
+        return add(str.data(), str.size());
+    }
+
+    Hasher& add(const std::string& str) { return add(std::string_view(str)); }
+    Hasher& add(const char* str) { return add(std::string_view(str ? str : "")); }
+
+    template<typename ValueType>
+        requires std::is_arithmetic_v<ValueType> || std::is_enum_v<ValueType>
+    Hasher& add(ValueType value)
+    {
+        return add(&value, sizeof(value));
+    }
+
+    uint64_t finish() const { return state; }
+
+private:
+    uint64_t state = kOffsetBasis;
+};
+
+inline uint64_t hashBytes(const void* data, size_t size)
+{
+    return Hasher().add(data, size).finish();
+}
+
+} // namespace core
+} // namespace kholst
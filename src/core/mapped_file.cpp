@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kholst
+{
+namespace core
+{
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::filesystem::path& path, std::string& outErrorMsg)
+{
+    close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        outErrorMsg = "Failed to open " + path.string();
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        outErrorMsg = "Failed to map empty or unreadable file " + path.string();
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        outErrorMsg = "Failed to map " + path.string();
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = static_cast<const uint8_t*>(view);
+    byteCount = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+
+    bytes = nullptr;
+    byteCount = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path, std::string& outErrorMsg)
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        outErrorMsg = "Failed to open " + path.string();
+        return false;
+    }
+
+    struct stat status = {};
+    if (fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        ::close(fd);
+        outErrorMsg = "Failed to map empty or unreadable file " + path.string();
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file
+    void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        outErrorMsg = "Failed to map " + path.string();
+        return false;
+    }
+
+    bytes = static_cast<const uint8_t*>(view);
+    byteCount = (size_t)status.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap(const_cast<uint8_t*>(bytes), byteCount);
+
+    bytes = nullptr;
+    byteCount = 0;
+}
+
+#endif
+
+} // namespace core
+} // namespace kholst
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ *
+ * Pages are faulted in on first access, so opening a large file costs a
+ * couple of system calls and only the bytes actually read are loaded.
+ * The file must not be truncated while it is mapped.
+ *
+ * Thread-safety: data() may be read from any thread once open() returned.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Map a file, unmapping the previous one
+     *
+     * @param path File to map, must not be empty
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool open(const std::filesystem::path& path, std::string& outErrorMsg);
+
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return byteCount; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t byteCount = 0;
+#if defined(_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+} // namespace core
+} // namespace kholst
@@ -0,0 +1,36 @@
+#pragma once
+
+// Tracy instrumentation for kholst code. KHOLST_WITH_TRACY is set by CMake
+// together with LVK_WITH_TRACY; without it every macro expands to nothing.
+//
+// Zone names must be string literals. Zones end with the enclosing scope, so
+// give each phase its own block when several of them share a function.
+
+#if defined(KHOLST_WITH_TRACY)
+
+#include <tracy/Tracy.hpp>
+
+#define KHOLST_PROFILER_COLOR_WAIT    0xff0000
+#define KHOLST_PROFILER_COLOR_RECORD  0x0000ff
+#define KHOLST_PROFILER_COLOR_SUBMIT  0x00ff00
+#define KHOLST_PROFILER_COLOR_SHADER  0xff8800
+
+#define KHOLST_PROFILER_FUNCTION() ZoneScoped
+#define KHOLST_PROFILER_ZONE(name) ZoneScopedN(name)
+#define KHOLST_PROFILER_ZONE_COLOR(name, color) ZoneScopedNC(name, color)
+#define KHOLST_PROFILER_ZONE_TEXT(text, size) ZoneText(text, size)
+#define KHOLST_PROFILER_FRAME(name) FrameMarkNamed(name)
+#define KHOLST_PROFILER_PLOT(name, value) TracyPlot(name, value)
+#define KHOLST_PROFILER_THREAD(name) tracy::SetThreadName(name)
+
+#else
+
+#define KHOLST_PROFILER_FUNCTION()
+#define KHOLST_PROFILER_ZONE(name)
+#define KHOLST_PROFILER_ZONE_COLOR(name, color)
+#define KHOLST_PROFILER_ZONE_TEXT(text, size)
+#define KHOLST_PROFILER_FRAME(name)
+#define KHOLST_PROFILER_PLOT(name, value) ((void)sizeof(value)) // Keeps plotted locals used, evaluates nothing
+#define KHOLST_PROFILER_THREAD(name)
+
+#endif
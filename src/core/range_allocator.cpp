@@ -0,0 +1,125 @@
+#include "range_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace kholst
+{
+namespace core
+{
+
+RangeAllocator::RangeAllocator(uint64_t capacity)
+{
+    reset(capacity);
+}
+
+void RangeAllocator::reset(uint64_t newCapacity)
+{
+    capacity = newCapacity;
+    used = 0;
+    freeBlocks.clear();
+    allocations.clear();
+    if (capacity)
+        freeBlocks[0] = capacity;
+}
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+    if (!size)
+        return INVALID_OFFSET;
+
+    // Best fit keeps large blocks intact for large meshes; the free list is
+    // short in practice so a linear scan is fine
+    auto best = freeBlocks.end();
+    uint64_t bestWaste = ~0ull;
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+    {
+        const uint64_t aligned = (it->first + alignment - 1) & ~(alignment - 1);
+        const uint64_t padding = aligned - it->first;
+        if (it->second < padding + size)
+            continue;
+
+        const uint64_t waste = it->second - size;
+        if (waste < bestWaste)
+        {
+            best = it;
+            bestWaste = waste;
+            if (!waste)
+                break;
+        }
+    }
+
+    if (best == freeBlocks.end())
+        return INVALID_OFFSET;
+
+    const uint64_t blockStart = best->first;
+    const uint64_t blockSize = best->second;
+    const uint64_t aligned = (blockStart + alignment - 1) & ~(alignment - 1);
+    const uint64_t consumed = aligned - blockStart + size;
+    freeBlocks.erase(best);
+
+    // The alignment padding stays with the allocation so freeing restores the
+    // whole block, only the tail goes back to the free list
+    if (blockSize > consumed)
+        freeBlocks[blockStart + consumed] = blockSize - consumed;
+
+    allocations[aligned] = { .size = size, .blockStart = blockStart, .blockSize = consumed };
+    used += consumed;
+    return aligned;
+}
+
+void RangeAllocator::free(uint64_t offset)
+{
+    auto allocation = allocations.find(offset);
+    if (allocation == allocations.end())
+    {
+        assert(false && "Freeing an offset that was not allocated");
+        return;
+    }
+
+    uint64_t start = allocation->second.blockStart;
+    uint64_t size = allocation->second.blockSize;
+    used -= size;
+    allocations.erase(allocation);
+
+    // Merge with the following block
+    auto next = freeBlocks.lower_bound(start);
+    if (next != freeBlocks.end() && next->first == start + size)
+    {
+        size += next->second;
+        next = freeBlocks.erase(next);
+    }
+
+    // Merge with the preceding block
+    if (next != freeBlocks.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start)
+        {
+            prev->second += size;
+            return;
+        }
+    }
+
+    freeBlocks[start] = size;
+}
+
+RangeAllocator::Stats RangeAllocator::getStats() const
+{
+    uint64_t largestFreeBlock = 0;
+    for (const auto& [offset, size] : freeBlocks)
+        largestFreeBlock = std::max(largestFreeBlock, size);
+
+    return {
+        .capacity = capacity,
+        .used = used,
+        .largestFreeBlock = largestFreeBlock,
+        .allocationCount = allocations.size(),
+        .freeBlockCount = freeBlocks.size(),
+    };
+}
+
+} // namespace core
+} // namespace kholst
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+namespace kholst
+{
+namespace core
+{
+
+/**
+ * @brief Offset-based suballocator for a fixed-size range
+ *
+ * Hands out aligned sub-ranges of [0, capacity) and never touches memory
+ * itself, so it can manage GPU buffers, descriptor arrays or anything else
+ * addressed by offset. Free blocks are kept sorted by offset and coalesced
+ * with their neighbours on free; allocation is best-fit.
+ *
+ * Thread-safety: not thread-safe.
+ */
+class RangeAllocator
+{
+public:
+    static constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+    struct Stats
+    {
+        uint64_t capacity = 0;
+        uint64_t used = 0; // Including alignment padding
+        uint64_t largestFreeBlock = 0;
+        size_t allocationCount = 0;
+        size_t freeBlockCount = 0;
+    };
+
+    RangeAllocator() = default;
+    explicit RangeAllocator(uint64_t capacity);
+
+    // Drop every allocation and manage [0, capacity) from scratch
+    void reset(uint64_t capacity);
+
+    /**
+     * @brief Allocate a sub-range
+     *
+     * @param size Size of the range, must be non-zero
+     * @param alignment Required alignment of the returned offset, must be a power of two
+     * @return Offset of the range, or INVALID_OFFSET if no free block fits
+     */
+    uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+
+    // Return a range obtained from allocate()
+    void free(uint64_t offset);
+
+    Stats getStats() const;
+
+private:
+    struct Allocation
+    {
+        uint64_t size = 0; // Size handed out
+        uint64_t blockStart = 0; // Start of the consumed block, before alignment padding
+        uint64_t blockSize = 0;
+    };
+
+    uint64_t capacity = 0;
+    uint64_t used = 0;
+    std::map<uint64_t, uint64_t> freeBlocks; // offset -> size
+    std::unordered_map<uint64_t, Allocation> allocations; // aligned offset -> allocation
+};
+
+} // namespace core
+} // namespace kholst
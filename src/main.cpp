@@ -1,158 +1,417 @@
 #include <lvk/LVK.h>
+#include <lvk/HelpersImGui.h>
 #include <GLFW/glfw3.h>
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "utils.h"
+#include "core/async_log.h"
+#include "core/frame_pacer.h"
+#include "core/profiler.h"
+#include "render/shader/archive/shader_archive.h"
 #include "render/shader/compiler/compiler.h"
+#include "render/shader/hot_reload/shader_watcher.h"
+#include "render/pipeline/pipeline_cache.h"
+#include "render/device/device_features.h"
+#include "render/debug/gpu_profiler.h"
+#include "render/debug/perf_overlay.h"
+#include "render/scene_renderer.h"
+#include "render/texture/texture_streamer.h"
 
 static constexpr uint32_t WIDTH = 1680;
 static constexpr uint32_t HEIGHT = 720;
 
-static constexpr uint32_t CUBE_TRIANGLES = 36;
+// Cubes are laid out on a grid and drawn with one indirect draw per pass;
+// raise to 100k+ to stress the instanced path
+static constexpr uint32_t CUBE_INSTANCE_COUNT = 1;
+static constexpr float CUBE_SPACING = 3.0f;
+
+// Frustum culling always runs, occlusion against last frame's Hi-Z on top
+static constexpr bool GPU_OCCLUSION_CULLING = true;
+
+// Draw the wireframe overlay in the same pass as the solid cube from
+// fragment barycentrics when the GPU supports them, otherwise fall back to
+// a second PolygonMode_Line pass
+static constexpr bool BARYCENTRIC_WIREFRAME = true;
+
+// Draw meshlets through task and mesh shaders when the GPU supports them,
+// otherwise fall back to instanced indexed draws
+static constexpr bool MESH_SHADING = true;
+
+static constexpr lvk::Format DEPTH_FORMAT = lvk::Format_Z_F32;
 
 static const char* LOG_FILE_PATH = ".log.last.txt"; 
 
-static const char* SLANG_CUBE_PATH = "src/shaders/cube.slang";
+static const char* SHADER_CACHE_PATH = ".shader_cache";
+
+// Release builds map the shaders baked by kholst-shaderc and never initialize
+// Slang; debug builds compile from source so hot reload sees every edit
+#if defined(NDEBUG) && defined(KHOLST_SHADER_ARCHIVE_PATH)
+static const char* SHADER_ARCHIVE_PATH = KHOLST_SHADER_ARCHIVE_PATH;
+#else
+static const char* SHADER_ARCHIVE_PATH = nullptr;
+#endif
+
+static const char* PIPELINE_CACHE_PATH = ".shader_cache/pipelines.bin";
+
+static constexpr size_t MAX_PIPELINE_VARIANTS = 64;
+
+// The CPU records one frame while the GPU renders the previous one
+static constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+static constexpr size_t PER_FRAME_BUFFER_SIZE = 64 * 1024;
+
+// Frame rate limit while the window has focus, 0 renders as fast as the swapchain allows
+static constexpr double TARGET_FPS = 0.0;
+// Keep animating at a low rate in the background instead of stopping, so
+// hot-reloaded shaders still show up while editing them in another window
+static constexpr double UNFOCUSED_FPS = 10.0;
+
+static constexpr double FRAME_STATS_INTERVAL = 1.0; // seconds
+
+// GPU time per pass, CPU frame phases and their graphs in an ImGui overlay;
+// the window of recent frames is written to PERF_CSV_PATH on exit
+static constexpr bool PERF_OVERLAY = true;
+
+static const char* PERF_CSV_PATH = ".perf.last.csv";
+
+// Recompile edited shaders in the background and swap pipelines between frames
+#if defined(NDEBUG)
+static constexpr bool SHADER_HOT_RELOAD = false;
+#else
+static constexpr bool SHADER_HOT_RELOAD = true;
+#endif
 
 class WindowApp final
 {
 public:
     WindowApp(const char *name, int width, int height)
-    : window(lvk::initWindow(name, width, height), glfwDestroyWindow)
+    : title(name)
+    , window(lvk::initWindow(name, width, height), glfwDestroyWindow)
     {
-        ctx = lvk::createVulkanContextWithSwapchain(window.get(), width, height, {});
+        lvk::ContextConfig config;
+        const kholst::render::DeviceFeatures features = kholst::render::requestOptionalDeviceFeatures(config, {
+            .fragmentShaderBarycentric = BARYCENTRIC_WIREFRAME,
+            .meshShader = MESH_SHADING,
+        });
+        useBarycentricWireframe = features.fragmentShaderBarycentric;
+        useMeshShading = features.meshShader;
+
+        ctx = lvk::createVulkanContextWithSwapchain(window.get(), width, height, config);
+
+        // Seed driver pipelines from the previous run before anything is created
+        std::string pipelineCacheError;
+        if (!pipelineCache.load(ctx.get(), pipelineCacheError))
+            KHOLST_LOGL("Pipeline cache not used: %s\n", pipelineCacheError.c_str());
         
-        // Initialize Slang compiler
-        if (!compiler.initialize(SLANG_SPIRV))
-        {
-            LLOGW("Failed to initialize Slang compiler: %s\n", compiler.getLastDiagnostics().c_str());
+        if (!initShaderCompiler())
             return;
-        }
         
         initRender();
+
+        if (SHADER_HOT_RELOAD)
+        {
+            shaderWatcher.start(compiler);
+            for (const kholst::render::SceneRenderer::Program& program : renderer.getPrograms())
+                programIds.push_back(shaderWatcher.watch(*program.job, *program.dependencies));
+        }
     }
     
+    bool initShaderCompiler()
+    {
+        KHOLST_PROFILER_FUNCTION();
+
+        if (SHADER_ARCHIVE_PATH)
+        {
+            std::shared_ptr<kholst::render::shader::ShaderArchive> archive = std::make_shared<kholst::render::shader::ShaderArchive>();
+            std::string archiveError;
+            if (archive->open(SHADER_ARCHIVE_PATH, archiveError) && compiler.initialize(archive, SLANG_SPIRV))
+            {
+                KHOLST_LOGL("Shader archive: %zu entry points, %zu KB\n", archive->getEntryCount(), archive->getSizeBytes() / 1024);
+                return true;
+            }
+            KHOLST_LOGW("Shader archive not used, compiling with Slang: %s\n", archiveError.c_str());
+        }
+
+        // Slang loads its core module in the background, cached SPIR-V does
+        // not wait for it
+        if (!compiler.initializeAsync(SLANG_SPIRV))
+        {
+            KHOLST_LOGW("Failed to initialize Slang compiler: %s\n", compiler.getLastDiagnostics().c_str());
+            return false;
+        }
+        compiler.enableCache(SHADER_CACHE_PATH);
+        return true;
+    }
+
     void initRender()
     {
-        // Compile vertex and fragment shaders from Slang
-        std::vector<uint32_t> vertSpirv, fragSpirv;
+        KHOLST_PROFILER_FUNCTION();
+
         std::string errorMsg;
-        
-        if (!compiler.compileVertexFragment(
-            SLANG_CUBE_PATH,
-            "cubeVertex",
-            "cubeFragment",
-            vertSpirv,
-            fragSpirv,
-            errorMsg))
+        if (!renderer.initialize(ctx.get(), compiler, {
+            .cubeCount = CUBE_INSTANCE_COUNT,
+            .cubeSpacing = CUBE_SPACING,
+            .colorFormat = ctx->getSwapchainFormat(),
+            .depthFormat = DEPTH_FORMAT,
+            .occlusionCulling = GPU_OCCLUSION_CULLING,
+            .barycentricWireframe = useBarycentricWireframe,
+            .meshShading = useMeshShading,
+            .framesInFlight = FRAMES_IN_FLIGHT,
+            .perFrameBufferSize = PER_FRAME_BUFFER_SIZE,
+            .maxPipelineVariants = MAX_PIPELINE_VARIANTS,
+        }, errorMsg))
+            KHOLST_LOGW("Failed to set up the scene renderer: %s\n", errorMsg.c_str());
+
+        if (PERF_OVERLAY)
         {
-            LLOGW("Failed to compile shaders: %s\n", errorMsg.c_str());
-            LLOGW("Diagnostics: %s\n", compiler.getLastDiagnostics().c_str());
-            return;
+            if (gpuProfiler.initialize(ctx.get(), { .framesInFlight = FRAMES_IN_FLIGHT }, errorMsg))
+                renderer.setGpuProfiler(&gpuProfiler);
+            else
+                KHOLST_LOGW("GPU timings unavailable: %s\n", errorMsg.c_str());
+
+            imgui = std::make_unique<lvk::ImGuiRenderer>(*ctx, nullptr, 15.0f);
+        }
+
+        if (!textureStreamer.initialize(ctx.get(), {}, errorMsg))
+            KHOLST_LOGW("Failed to start texture streaming: %s\n", errorMsg.c_str());
+
+        const kholst::render::shader::SpirvCache::Stats cacheStats = compiler.getCacheStats();
+        KHOLST_LOGL("Shader cache: %llu hits, %llu misses\n",
+            (unsigned long long)cacheStats.hits, (unsigned long long)cacheStats.misses);
+    }
+
+    // Called between frames, so no command buffer references the swapped objects
+    void applyShaderReloads()
+    {
+        KHOLST_PROFILER_FUNCTION();
+
+        const std::vector<kholst::render::SceneRenderer::Program> programs = renderer.getPrograms();
+        for (kholst::render::shader::ShaderReload& reload : shaderWatcher.consumeReloads())
+        {
+            if (!reload.result.success)
+            {
+                KHOLST_LOGW("Shader reload failed, keeping previous pipelines: %s\n", reload.result.errorMsg.c_str());
+                continue;
+            }
+
+            for (size_t i = 0; i < programIds.size() && i < programs.size(); i++)
+            {
+                if (reload.programId != programIds[i])
+                    continue;
+
+                std::string errorMsg;
+                if (renderer.applyReload(i, reload.result.shaders, errorMsg))
+                    KHOLST_LOGL("Reloaded %s\n", programs[i].job->shaderPath.c_str());
+                else
+                    KHOLST_LOGW("Failed to recreate pipelines for %s, keeping previous ones: %s\n",
+                        programs[i].job->shaderPath.c_str(), errorMsg.c_str());
+            }
         }
-        
-        // Create shader modules from compiled SPIRV
-        vert = ctx->createShaderModule({
-            vertSpirv.data(),
-            vertSpirv.size() * sizeof(uint32_t),
-            lvk::Stage_Vert,
-            "Shader Module: cube.slang (vert)"
-        });
-        
-        frag = ctx->createShaderModule({
-            fragSpirv.data(),
-            fragSpirv.size() * sizeof(uint32_t),
-            lvk::Stage_Frag,
-            "Shader Module: cube.slang (frag)"
-        });
-        
-        pipeline = ctx->createRenderPipeline({
-            .smVert = vert,
-            .smFrag = frag,
-            .color  = { { .format = ctx->getSwapchainFormat() } },
-            .cullMode = lvk::CullMode_Back,
-        });
-        
-        wireframePipeline = ctx->createRenderPipeline({
-            .smVert = vert,
-            .smFrag = frag,
-            .specInfo = { .entries = { { .constantId = 0, .size = sizeof(isWireframe) } }, .data = &isWireframe, .dataSize = sizeof(isWireframe) },
-            .color  = { { .format = ctx->getSwapchainFormat() } },
-            .cullMode = lvk::CullMode_Back,
-            .polygonMode = lvk::PolygonMode_Line,
-        });
     }
 
     void run()
     {
+        using Clock = std::chrono::steady_clock;
+        double lastStatsTime = glfwGetTime();
+        Clock::time_point frameStart = Clock::now();
+
         while (!glfwWindowShouldClose(window.get()))
         {
-            glfwPollEvents();
+            {
+                KHOLST_PROFILER_ZONE("Poll events");
+                glfwPollEvents();
+            }
 
             int width = 0;
             int height = 0;
             glfwGetFramebufferSize(window.get(), &width, &height);
 
+            // Minimized, sleep until something happens to the window
             if (!width || !height)
+            {
+                glfwWaitEvents();
+                framePacer.reset();
                 continue;
+            }
+
+            const bool focused = glfwGetWindowAttrib(window.get(), GLFW_FOCUSED) == GLFW_TRUE;
+            const Clock::time_point waitStart = Clock::now();
+            framePacer.waitForNextFrame(focused ? TARGET_FPS : UNFOCUSED_FPS);
+            const double waitMs = millisecondsSince(waitStart);
+
+            if (SHADER_HOT_RELOAD)
+                applyShaderReloads();
+
+            if (glfwGetTime() - lastStatsTime >= FRAME_STATS_INTERVAL)
+            {
+                lastStatsTime = glfwGetTime();
+                updateFrameStats();
+            }
+
+            glm::mat4 viewProj;
+            glm::vec3 cameraPosition;
+            {
+                KHOLST_PROFILER_ZONE("Update matrices");
+                const float ratio = width / (float)height;
 
-            const float ratio = width / (float)height;
+                const glm::mat4 v = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -renderer.getCameraDistance()));
+                const glm::mat4 p = glm::perspective(45.0f, ratio, 0.1f, 1000.0f);
+                viewProj = p * v;
+                cameraPosition = glm::vec3(glm::inverse(v)[3]);
+            }
 
-            const glm::mat4 m = glm::rotate(
-                glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.5f)),
-                (float)glfwGetTime(),
-                glm::vec3(1.0f, 1.0f, 1.0f));
-            const glm::mat4 p = glm::perspective(45.0f, ratio, 0.1f, 1000.0f);
+            // Decoded textures and the next mips go up before this frame samples them
+            textureStreamer.update();
 
             lvk::ICommandBuffer& buf = ctx->acquireCommandBuffer();
+            gpuProfiler.beginFrame(buf);
 
-            buf.cmdBeginRendering(
-                { .color = { { .loadOp = lvk::LoadOp_Clear, .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f } } } },
-                { .color = { { .texture = ctx->getCurrentSwapchainTexture() } } }
-            );
+            const Clock::time_point recordStart = Clock::now();
+            renderer.render(buf, ctx->getCurrentSwapchainTexture(), {
+                .viewProj = viewProj,
+                .cameraPosition = cameraPosition,
+                .time = (float)glfwGetTime(),
+            });
+            const double recordMs = millisecondsSince(recordStart);
 
+            if (imgui)
+                drawPerfOverlay(buf, ctx->getCurrentSwapchainTexture());
+            gpuProfiler.recordFrameEnd(buf);
+
+            if (!renderGraphLogged)
             {
-                buf.cmdPushDebugGroupLabel("Render cube", 0xff0000ff);
-                buf.cmdBindRenderPipeline(pipeline);
-                buf.cmdPushConstants(p * m);
-                buf.cmdDraw(CUBE_TRIANGLES);
-                buf.cmdPopDebugGroupLabel();
+                KHOLST_LOGL("%s", renderer.getRenderGraph().dump().c_str());
+                renderGraphLogged = true;
             }
 
+            const Clock::time_point submitStart = Clock::now();
             {
-                buf.cmdPushDebugGroupLabel("Render wireframe cube", 0xff0000ff);
-                buf.cmdBindRenderPipeline(wireframePipeline);
-                buf.cmdPushConstants(p * m);
-                buf.cmdDraw(CUBE_TRIANGLES);
-                buf.cmdPopDebugGroupLabel();
+                KHOLST_PROFILER_ZONE_COLOR("Submit", KHOLST_PROFILER_COLOR_SUBMIT);
+                const lvk::SubmitHandle submit = ctx->submit(buf, ctx->getCurrentSwapchainTexture());
+                renderer.endFrame(submit);
+                gpuProfiler.endFrame(submit);
             }
+            const double submitMs = millisecondsSince(submitStart);
 
-            buf.cmdEndRendering();
+            const Clock::time_point frameEnd = Clock::now();
+            if (PERF_OVERLAY)
+                updatePerfOverlay(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count(), waitMs, recordMs, submitMs);
+            frameStart = frameEnd;
 
-            ctx->submit(buf, ctx->getCurrentSwapchainTexture());
+            KHOLST_PROFILER_FRAME("Kholst frame");
         }
     }
 
+    static double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void updatePerfOverlay(double frameMs, double waitMs, double recordMs, double submitMs)
+    {
+        perfOverlay.addSample("CPU frame", frameMs);
+        perfOverlay.addSample("CPU pacing wait", waitMs);
+        perfOverlay.addSample("CPU render", recordMs);
+        const kholst::render::PassExecutor::Stats passStats = renderer.getPassStats();
+        perfOverlay.addSample("  record passes", passStats.recordMs);
+        perfOverlay.addSample("  replay passes", passStats.replayMs);
+        perfOverlay.addSample("CPU submit", submitMs);
+
+        // Results trail by a few frames and arrive once per frame read back
+        const kholst::render::GpuProfiler::FrameResult& gpu = gpuProfiler.getLastFrame();
+        if (gpu.available && gpu.frame != lastGpuFrame)
+        {
+            lastGpuFrame = gpu.frame;
+            perfOverlay.addSample("GPU frame", gpu.gpuMs);
+            for (const kholst::render::GpuProfiler::ZoneResult& zone : gpu.zones)
+                perfOverlay.addSample(std::string(2 * (zone.depth + 1), ' ') + zone.name, zone.gpuMs);
+        }
+
+        perfOverlay.endFrame();
+    }
+
+    // Drawn over the finished frame in a pass of its own
+    void drawPerfOverlay(lvk::ICommandBuffer& buf, lvk::TextureHandle target)
+    {
+        KHOLST_PROFILER_GPU_TIMED_ZONE(&gpuProfiler, buf, "Overlay", 0xff808080);
+
+        const lvk::Framebuffer framebuffer = { .color = { { .texture = target } } };
+        imgui->beginFrame(framebuffer);
+        perfOverlay.draw();
+
+        buf.cmdBeginRendering({ .color = { { .loadOp = lvk::LoadOp_Load, .storeOp = lvk::StoreOp_Store } } }, framebuffer);
+        imgui->endFrame(buf);
+        buf.cmdEndRendering();
+    }
+
+    void updateFrameStats()
+    {
+        const kholst::core::FramePacer::Stats stats = framePacer.getStats();
+        if (!stats.frameCount)
+            return;
+
+        char text[256];
+        std::snprintf(text, sizeof(text), "%s - %.1f fps, %.2f ms avg, %.2f ms p99, %.2f ms max",
+            title.c_str(), stats.fps, stats.averageMs, stats.p99Ms, stats.maxMs);
+        glfwSetWindowTitle(window.get(), text);
+    }
+
     ~WindowApp()
     {
+        shaderWatcher.stop();
+
+        const kholst::core::FramePacer::Stats stats = framePacer.getStats();
+        KHOLST_LOGL("Frame time over the last %zu frames: %.2f ms avg, %.2f ms min, %.2f ms p99, %.2f ms max\n",
+            stats.frameCount, stats.averageMs, stats.minMs, stats.p99Ms, stats.maxMs);
+
+        if (PERF_OVERLAY)
+        {
+            std::string csvError;
+            if (perfOverlay.writeCsv(PERF_CSV_PATH, csvError))
+                KHOLST_LOGL("Frame timings written to %s\n", PERF_CSV_PATH);
+            else
+                KHOLST_LOGW("Failed to write frame timings: %s\n", csvError.c_str());
+        }
+
         window.reset();
-        vert.reset();
-        frag.reset();
-        pipeline.reset();
-        wireframePipeline.reset();
+
+        std::string pipelineCacheError;
+        if (!pipelineCache.save(ctx.get(), pipelineCacheError))
+            KHOLST_LOGW("Failed to save pipeline cache: %s\n", pipelineCacheError.c_str());
+
+        renderer.clear();
+        gpuProfiler.clear();
+        imgui.reset();
+        textureStreamer.clear();
         ctx.reset();
         glfwTerminate();
     }
 private:
-    VkBool32 isWireframe = false;
-
     kholst::render::shader::SlangCompiler compiler;
-    lvk::Holder<lvk::ShaderModuleHandle> vert;
-    lvk::Holder<lvk::ShaderModuleHandle> frag;
-    lvk::Holder<lvk::RenderPipelineHandle> pipeline;
-    lvk::Holder<lvk::RenderPipelineHandle> wireframePipeline;
+    kholst::render::shader::ShaderWatcher shaderWatcher;
+    std::vector<uint32_t> programIds; // Watcher id of each renderer program
+
+    kholst::render::PipelineCache pipelineCache{ PIPELINE_CACHE_PATH };
+    kholst::render::SceneRenderer renderer;
+    kholst::render::TextureStreamer textureStreamer;
+    bool useBarycentricWireframe = false;
+    bool useMeshShading = false;
+    bool renderGraphLogged = false;
+
+    kholst::render::GpuProfiler gpuProfiler;
+    kholst::render::PerfOverlay perfOverlay;
+    std::unique_ptr<lvk::ImGuiRenderer> imgui;
+    uint64_t lastGpuFrame = ~0ull;
+
+    std::string title;
+    kholst::core::FramePacer framePacer;
 
     std::unique_ptr<GLFWwindow, decltype(&glfwDestroyWindow)> window;
     std::unique_ptr<lvk::IContext> ctx;
@@ -161,7 +420,17 @@ private:
 int main()
 {
     minilog::initialize(LOG_FILE_PATH, { .threadNames = false });
-    WindowApp app("Kholst", WIDTH, HEIGHT);
-    app.run();
+
+    // Console and file writes happen on the log thread, not in the frame
+    std::string logError;
+    if (!kholst::core::getLog().start({}, logError))
+        KHOLST_LOGW("Logging synchronously: %s\n", logError.c_str());
+
+    {
+        WindowApp app("Kholst", WIDTH, HEIGHT);
+        app.run();
+    }
+
+    kholst::core::getLog().stop();
     return 0;
 }
@@ -0,0 +1,328 @@
+#include "gpu_culler.h"
+
+#include <algorithm>
+
+#include "core/async_log.h"
+#include "render/debug/gpu_zone.h"
+#include "render/instancing/instance_batch.h"
+#include "render/shader_programs.h"
+
+namespace kholst
+{
+namespace render
+{
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+static constexpr uint32_t HIZ_GROUP_SIZE = 8;
+
+// Layout must match CullPushConstants in cull.slang
+struct CullPushConstants
+{
+    uint64_t cull;
+    uint64_t instances;
+    uint64_t visibleInstances;
+    uint64_t drawArgs;
+};
+
+// Gribb-Hartmann plane extraction. The near plane uses the -w..w clip range,
+// which is the looser of the two depth conventions, so nothing is culled
+// wrongly whichever one the projection was built with.
+static void extractFrustumPlanes(const glm::mat4& m, glm::vec4 outPlanes[6])
+{
+    const glm::vec4 row0 = { m[0][0], m[1][0], m[2][0], m[3][0] };
+    const glm::vec4 row1 = { m[0][1], m[1][1], m[2][1], m[3][1] };
+    const glm::vec4 row2 = { m[0][2], m[1][2], m[2][2], m[3][2] };
+    const glm::vec4 row3 = { m[0][3], m[1][3], m[2][3], m[3][3] };
+
+    outPlanes[0] = row3 + row0;
+    outPlanes[1] = row3 - row0;
+    outPlanes[2] = row3 + row1;
+    outPlanes[3] = row3 - row1;
+    outPlanes[4] = row3 + row2;
+    outPlanes[5] = row3 - row2;
+
+    for (int i = 0; i < 6; i++)
+        outPlanes[i] /= glm::length(glm::vec3(outPlanes[i]));
+}
+
+static uint32_t groupCount(uint32_t size, uint32_t groupSize)
+{
+    return (size + groupSize - 1) / groupSize;
+}
+
+bool GpuCuller::initialize(
+    lvk::IContext* context,
+    shader::SlangCompiler& compiler,
+    uint32_t instanceCapacity,
+    uint32_t frameCount,
+    std::string& outErrorMsg
+)
+{
+    clear();
+
+    if (!instanceCapacity || !frameCount)
+    {
+        outErrorMsg = "Culler needs a non-zero instance capacity and frame count";
+        return false;
+    }
+
+    ctx = context;
+    program = getCullProgram();
+
+    std::vector<shader::CompiledShader> shaders;
+    if (!compiler.compileEntryPoints(program.shaderPath, program.entryPoints, shaders, outErrorMsg) ||
+        !createPipelines(shaders, outErrorMsg))
+    {
+        clear();
+        return false;
+    }
+    dependencies = compiler.getLastDependencies();
+
+    lvk::Result res;
+    visibleBuffer = ctx->createBuffer({
+        .usage = lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = sizeof(uint32_t) * (size_t)instanceCapacity * frameCount,
+        .debugName = "Buffer: visible instances",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create visible instance buffer: ") + (res.message ? res.message : "");
+        clear();
+        return false;
+    }
+
+    maxInstances = instanceCapacity;
+    framesInFlight = frameCount;
+    return true;
+}
+
+bool GpuCuller::createPipelines(const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg)
+{
+    if (shaders.size() != program.entryPoints.size())
+    {
+        outErrorMsg = "Expected one shader per entry point of " + program.shaderPath;
+        return false;
+    }
+
+    lvk::Holder<lvk::ShaderModuleHandle> modules[2];
+    lvk::Holder<lvk::ComputePipelineHandle> pipelines[2];
+    for (int i = 0; i < 2; i++)
+    {
+        const std::string debugName = "Shader Module: " + program.shaderPath + " (" + program.entryPoints[i].name + ")";
+
+        lvk::Result res;
+        modules[i] = ctx->createShaderModule({
+            shaders[i].data(),
+            shaders[i].sizeInBytes(),
+            lvk::Stage_Comp,
+            debugName.c_str()
+        }, &res);
+        if (!res.isOk())
+        {
+            outErrorMsg = "Failed to create " + debugName + ": " + (res.message ? res.message : "");
+            return false;
+        }
+
+        pipelines[i] = ctx->createComputePipeline({ .smComp = modules[i] }, &res);
+        if (!res.isOk())
+        {
+            outErrorMsg = "Failed to create compute pipeline for " + program.entryPoints[i].name + ": " + (res.message ? res.message : "");
+            return false;
+        }
+    }
+
+    // Old objects go through LVK's deferred destruction
+    cullModule = std::move(modules[0]);
+    hizModule = std::move(modules[1]);
+    cullPipeline = std::move(pipelines[0]);
+    hizPipeline = std::move(pipelines[1]);
+    return true;
+}
+
+bool GpuCuller::applyReload(const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg)
+{
+    return createPipelines(shaders, outErrorMsg);
+}
+
+void GpuCuller::resize(const lvk::Dimensions& depthDimensions)
+{
+    hizAtlas = {};
+    hizLevels.clear();
+    hizValid = false;
+
+    if (!ctx || !depthDimensions.width || !depthDimensions.height)
+        return;
+
+    // Level 0 is half the depth resolution, halving down to 1x1
+    uint32_t width = std::max(1u, (depthDimensions.width + 1) / 2);
+    uint32_t height = std::max(1u, (depthDimensions.height + 1) / 2);
+    const uint32_t level0Width = width;
+    uint32_t columnHeight = 0;
+    uint32_t columnWidth = 0;
+
+    while (hizLevels.size() < MAX_HIZ_LEVELS)
+    {
+        if (hizLevels.empty())
+        {
+            hizLevels.push_back({ 0, 0, width, height });
+        }
+        else
+        {
+            hizLevels.push_back({ level0Width, columnHeight, width, height });
+            columnHeight += height;
+            columnWidth = std::max(columnWidth, width);
+        }
+
+        if (width == 1 && height == 1)
+            break;
+        width = std::max(1u, (width + 1) / 2);
+        height = std::max(1u, (height + 1) / 2);
+    }
+
+    lvk::Result res;
+    hizAtlas = ctx->createTexture({
+        .format = lvk::Format_R_F32,
+        .dimensions = { level0Width + columnWidth, std::max(hizLevels[0].w, columnHeight) },
+        .usage = lvk::TextureUsageBits_Storage,
+        .debugName = "Hi-Z pyramid",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        KHOLST_LOGW("Failed to create Hi-Z pyramid, occlusion culling is disabled: %s\n", res.message ? res.message : "");
+        hizAtlas = {};
+        hizLevels.clear();
+    }
+}
+
+bool GpuCuller::cull(lvk::ICommandBuffer& buf, FrameRing& frameRing, const CullParams& params)
+{
+    if (cullPipeline.empty() || !params.instanceCount || !params.mesh.valid())
+        return false;
+
+    if (params.instanceCount > maxInstances)
+    {
+        KHOLST_LOGW("Culling %u instances, but the culler was set up for %u\n", params.instanceCount, maxInstances);
+        return false;
+    }
+
+    const FrameRing::Allocation args = frameRing.push(DrawIndexedIndirectCommand{
+        .indexCount = params.mesh.indexCount,
+        .instanceCount = 0,
+        .firstIndex = params.mesh.firstIndex,
+        .vertexOffset = params.mesh.vertexOffset,
+    });
+
+    const bool occlusion = occlusionEnabled && hizValid && !hizAtlas.empty();
+    CullData cullData = {
+        .prevViewProj = hizViewProj,
+        .hizSize = occlusion ? glm::vec2(hizLevels[0].z, hizLevels[0].w) : glm::vec2(0.0f),
+        .hizLevelCount = occlusion ? (uint32_t)hizLevels.size() : 0,
+        .instanceCount = params.instanceCount,
+        .meshRadius = params.meshRadius,
+        .hizImage = occlusion ? hizAtlas.index() : 0,
+    };
+    extractFrustumPlanes(params.viewProj, cullData.frustumPlanes);
+    std::copy(hizLevels.begin(), hizLevels.end(), cullData.hizLevels);
+
+    const FrameRing::Allocation cullAllocation = frameRing.push(cullData);
+    if (!args || !cullAllocation)
+        return false;
+
+    argsBuffer = frameRing.getBuffer();
+    argsOffset = args.offset;
+    drawArgsAddress = args.gpuAddress;
+    visibleAddress = ctx->gpuAddress(visibleBuffer, sizeof(uint32_t) * (size_t)maxInstances * frameRing.getFrameIndex());
+    currentViewProj = params.viewProj;
+
+    const CullPushConstants pushConstants = {
+        .cull = cullAllocation.gpuAddress,
+        .instances = params.instancesAddress,
+        .visibleInstances = visibleAddress,
+        .drawArgs = args.gpuAddress,
+    };
+
+    KHOLST_PROFILER_GPU_ZONE(buf, "Cull instances", 0xff00ff00);
+    buf.cmdBindComputePipeline(cullPipeline);
+    buf.cmdPushConstants(pushConstants);
+    buf.cmdDispatchThreadGroups(
+        { .width = groupCount(params.instanceCount, CULL_GROUP_SIZE) },
+        { .textures = { occlusion ? lvk::TextureHandle(hizAtlas) : lvk::TextureHandle() }, .buffers = { visibleBuffer } }
+    );
+    return true;
+}
+
+void GpuCuller::draw(lvk::ICommandBuffer& buf) const
+{
+    buf.cmdDrawIndexedIndirect(argsBuffer, argsOffset, 1);
+}
+
+void GpuCuller::draw(CommandList& list) const
+{
+    list.cmdDrawIndexedIndirect(argsBuffer, argsOffset, 1);
+}
+
+lvk::Dependencies GpuCuller::getDrawDependencies() const
+{
+    return { .buffers = { argsBuffer, visibleBuffer } };
+}
+
+void GpuCuller::buildHiZ(lvk::ICommandBuffer& buf, lvk::TextureHandle depth)
+{
+    if (hizPipeline.empty() || hizAtlas.empty())
+        return;
+
+    const lvk::Dimensions depthDimensions = ctx->getDimensions(depth);
+
+    KHOLST_PROFILER_GPU_ZONE(buf, "Build Hi-Z", 0xff00ff00);
+    buf.cmdBindComputePipeline(hizPipeline);
+    for (size_t level = 0; level < hizLevels.size(); level++)
+    {
+        const glm::uvec4& dst = hizLevels[level];
+        const glm::uvec4 src = level ? hizLevels[level - 1] : glm::uvec4(0, 0, depthDimensions.width, depthDimensions.height);
+
+        const HiZPushConstants pushConstants = {
+            .srcOffset = glm::ivec2(src.x, src.y),
+            .srcSize = glm::uvec2(src.z, src.w),
+            .dstOffset = glm::ivec2(dst.x, dst.y),
+            .dstSize = glm::uvec2(dst.z, dst.w),
+            .depthTexture = depth.index(),
+            .hizImage = hizAtlas.index(),
+            .fromDepth = level == 0,
+        };
+        buf.cmdPushConstants(pushConstants);
+
+        // Listing the atlas makes LVK barrier it against the previous level's writes
+        lvk::Dependencies deps = { .textures = { hizAtlas } };
+        if (!level)
+            deps.textures[1] = depth;
+
+        buf.cmdDispatchThreadGroups({ .width = groupCount(dst.z, HIZ_GROUP_SIZE), .height = groupCount(dst.w, HIZ_GROUP_SIZE) }, deps);
+    }
+
+    hizViewProj = currentViewProj;
+    hizValid = true;
+}
+
+void GpuCuller::clear()
+{
+    cullPipeline = {};
+    hizPipeline = {};
+    cullModule = {};
+    hizModule = {};
+    visibleBuffer = {};
+    hizAtlas = {};
+    hizLevels.clear();
+    hizValid = false;
+    argsBuffer = {};
+    argsOffset = 0;
+    drawArgsAddress = 0;
+    visibleAddress = 0;
+    maxInstances = 0;
+    framesInFlight = 0;
+    dependencies.clear();
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <lvk/LVK.h>
+
+#include "render/frame/frame_ring.h"
+#include "render/graph/command_list.h"
+#include "render/mesh/mesh_buffers.h"
+#include "render/shader/compiler/compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Compute-shader frustum and occlusion culling of instances
+ *
+ * Every frame cull() tests each instance's bounding sphere against the view
+ * frustum and against a Hi-Z pyramid of the previous frame's depth buffer,
+ * then appends the survivors to a compacted visible list and bumps the
+ * instance count of an indirect draw. GPU work after culling scales with
+ * what is visible rather than with the scene size.
+ *
+ * Occlusion uses last frame's depth, so an object that becomes visible
+ * from behind an occluder can show up one frame late.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class GpuCuller
+{
+public:
+    struct CullParams
+    {
+        glm::mat4 viewProj = glm::mat4(1.0f);
+        uint64_t instancesAddress = 0; // InstanceData array, see InstanceBatch
+        uint32_t instanceCount = 0;
+        MeshHandle mesh;
+        float meshRadius = 1.0f; // Bounding sphere radius of the mesh at scale 1
+    };
+
+    /**
+     * @brief Compile the culling shaders and allocate the visible lists
+     *
+     * @param ctx Context to allocate from, must outlive the culler
+     * @param compiler Initialized compiler to build src/shaders/cull.slang with
+     * @param maxInstances Upper bound of instances passed to cull()
+     * @param framesInFlight Frames in flight of the FrameRing passed to cull()
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(
+        lvk::IContext* ctx,
+        shader::SlangCompiler& compiler,
+        uint32_t maxInstances,
+        uint32_t framesInFlight,
+        std::string& outErrorMsg
+    );
+
+    /**
+     * @brief Swap in recompiled culling shaders
+     *
+     * @param shaders One compiled shader per entry point of getProgram()
+     * @param outErrorMsg Error description on failure
+     * @return true if the new pipelines were created
+     */
+    bool applyReload(const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg);
+
+    // Recreate the Hi-Z pyramid for a new depth buffer size
+    void resize(const lvk::Dimensions& depthDimensions);
+
+    /**
+     * @brief Record culling of the current frame
+     *
+     * Call outside of a render pass, after FrameRing::beginFrame().
+     *
+     * @return false if nothing was recorded and draw() must not be used
+     */
+    bool cull(lvk::ICommandBuffer& buf, FrameRing& frameRing, const CullParams& params);
+
+    // Draw the visible instances, expects pipeline, mesh buffers and push constants to be bound
+    void draw(lvk::ICommandBuffer& buf) const;
+    void draw(CommandList& list) const;
+
+    // Buffers the render pass drawing the visible instances has to depend on
+    lvk::Dependencies getDrawDependencies() const;
+
+    // Device address of the current frame's visible list, indexed by SV_InstanceID
+    uint64_t getVisibleInstancesAddress() const { return visibleAddress; }
+
+    // Device address of the current frame's indirect draw, its instance count is the visible list size
+    uint64_t getDrawArgsAddress() const { return drawArgsAddress; }
+
+    /**
+     * @brief Record the Hi-Z build from this frame's depth, used by the next cull()
+     *
+     * Call outside of a render pass, after the depth buffer was rendered.
+     */
+    void buildHiZ(lvk::ICommandBuffer& buf, lvk::TextureHandle depth);
+
+    void setOcclusionEnabled(bool enabled) { occlusionEnabled = enabled; }
+
+    const shader::ShaderCompileJob& getProgram() const { return program; }
+    const std::vector<std::string>& getDependencies() const { return dependencies; }
+
+    void clear();
+
+private:
+    static constexpr uint32_t MAX_HIZ_LEVELS = 16;
+
+    // Layout must match CullData in cull.slang
+    struct CullData
+    {
+        glm::mat4 prevViewProj;
+        glm::vec4 frustumPlanes[6];
+        glm::vec2 hizSize;
+        uint32_t hizLevelCount;
+        uint32_t instanceCount;
+        float meshRadius;
+        uint32_t hizImage;
+        uint32_t padding[2];
+        glm::uvec4 hizLevels[MAX_HIZ_LEVELS];
+    };
+
+    // Layout must match HiZPushConstants in cull.slang
+    struct HiZPushConstants
+    {
+        glm::ivec2 srcOffset;
+        glm::uvec2 srcSize;
+        glm::ivec2 dstOffset;
+        glm::uvec2 dstSize;
+        uint32_t depthTexture;
+        uint32_t hizImage;
+        uint32_t fromDepth;
+    };
+
+    lvk::IContext* ctx = nullptr;
+    shader::ShaderCompileJob program;
+    std::vector<std::string> dependencies;
+
+    lvk::Holder<lvk::ShaderModuleHandle> cullModule;
+    lvk::Holder<lvk::ShaderModuleHandle> hizModule;
+    lvk::Holder<lvk::ComputePipelineHandle> cullPipeline;
+    lvk::Holder<lvk::ComputePipelineHandle> hizPipeline;
+
+    lvk::Holder<lvk::BufferHandle> visibleBuffer; // One slice of maxInstances per frame in flight
+    uint32_t maxInstances = 0;
+    uint32_t framesInFlight = 0;
+    uint64_t visibleAddress = 0;
+
+    lvk::BufferHandle argsBuffer; // Frame ring buffer holding this frame's draw arguments
+    size_t argsOffset = 0;
+    uint64_t drawArgsAddress = 0;
+
+    // Every level of the pyramid packed into one storage image: level 0 on the
+    // left, the smaller levels stacked in a column to its right. One image
+    // means one dependency to barrier on between the build and the next cull.
+    lvk::Holder<lvk::TextureHandle> hizAtlas;
+    std::vector<glm::uvec4> hizLevels; // xy offset, zw size
+    glm::mat4 hizViewProj = glm::mat4(1.0f);
+    glm::mat4 currentViewProj = glm::mat4(1.0f);
+    bool hizValid = false;
+    bool occlusionEnabled = true;
+
+    bool createPipelines(const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg);
+};
+
+} // namespace render
+} // namespace kholst
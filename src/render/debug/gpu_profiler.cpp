@@ -0,0 +1,175 @@
+#include "gpu_profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+GpuProfiler::~GpuProfiler()
+{
+    clear();
+}
+
+bool GpuProfiler::initialize(lvk::IContext* context, const Config& profilerConfig, std::string& outErrorMsg)
+{
+    clear();
+
+    if (!profilerConfig.framesInFlight)
+    {
+        outErrorMsg = "GPU profiler needs at least one frame in flight";
+        return false;
+    }
+
+    const uint32_t frameCount = profilerConfig.framesInFlight + 1;
+    queriesPerFrame = FIRST_ZONE_QUERY + 2 * profilerConfig.maxZones;
+
+    lvk::Result res;
+    timestampPool = context->createQueryPool(frameCount * queriesPerFrame, "Query pool: GPU profiler timestamps", &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create timestamp query pool: ") + (res.message ? res.message : "");
+        timestampPool = {};
+        return false;
+    }
+
+    ctx = context;
+    config = profilerConfig;
+    timestamps.resize(queriesPerFrame);
+    frames.resize(frameCount);
+    for (Frame& frame : frames)
+        frame.zones.reserve(config.maxZones);
+    // The first beginFrame() moves to frame 0
+    currentFrame = frameCount - 1;
+    return true;
+}
+
+void GpuProfiler::beginFrame(lvk::ICommandBuffer& buf)
+{
+    if (frames.empty())
+        return;
+
+    currentFrame = (currentFrame + 1) % (uint32_t)frames.size();
+
+    Frame& frame = frames[currentFrame];
+    if (frame.recorded)
+        readBack(currentFrame);
+
+    frame.frame = frameCounter++;
+    frame.recorded = false;
+    frame.zones.clear();
+    openZones = 0;
+
+    const uint32_t firstQuery = currentFrame * queriesPerFrame;
+    buf.cmdResetQueryPool(timestampPool, firstQuery, queriesPerFrame);
+    buf.cmdWriteTimestamp(timestampPool, firstQuery + FRAME_BEGIN_QUERY);
+}
+
+uint32_t GpuProfiler::beginZone(lvk::ICommandBuffer& buf, const char* name)
+{
+    if (frames.empty())
+        return INVALID_ZONE;
+
+    Frame& frame = frames[currentFrame];
+    if (frame.zones.size() >= config.maxZones)
+        return INVALID_ZONE;
+
+    const uint32_t zone = (uint32_t)frame.zones.size();
+    frame.zones.push_back({ .name = name, .depth = openZones++ });
+    buf.cmdWriteTimestamp(timestampPool, currentFrame * queriesPerFrame + FIRST_ZONE_QUERY + 2 * zone);
+    return zone;
+}
+
+void GpuProfiler::endZone(lvk::ICommandBuffer& buf, uint32_t zone)
+{
+    if (frames.empty() || zone == INVALID_ZONE)
+        return;
+
+    Frame& frame = frames[currentFrame];
+    if (zone >= frame.zones.size() || !frame.zones[zone].open)
+        return;
+
+    frame.zones[zone].open = false;
+    openZones--;
+    buf.cmdWriteTimestamp(timestampPool, currentFrame * queriesPerFrame + FIRST_ZONE_QUERY + 2 * zone + 1);
+}
+
+void GpuProfiler::recordFrameEnd(lvk::ICommandBuffer& buf)
+{
+    if (frames.empty())
+        return;
+
+    // Reading back a query that was never written would block, close what is left open
+    Frame& frame = frames[currentFrame];
+    for (uint32_t zone = 0; zone < frame.zones.size(); zone++)
+        endZone(buf, zone);
+
+    buf.cmdWriteTimestamp(timestampPool, currentFrame * queriesPerFrame + FRAME_END_QUERY);
+    frame.recorded = true;
+}
+
+void GpuProfiler::endFrame(lvk::SubmitHandle handle)
+{
+    if (!frames.empty())
+        frames[currentFrame].submit = handle;
+}
+
+void GpuProfiler::readBack(uint32_t frameIndex)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    Frame& frame = frames[frameIndex];
+
+    // Already waited for by the frame ring, this does not block
+    if (!frame.submit.empty())
+    {
+        ctx->wait(frame.submit);
+        frame.submit = {};
+    }
+
+    // Only the queries this frame wrote, the rest of its range is still reset
+    const uint32_t queryCount = FIRST_ZONE_QUERY + 2 * (uint32_t)frame.zones.size();
+    if (!ctx->getQueryPoolResults(timestampPool, frameIndex * queriesPerFrame, queryCount,
+            queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t)))
+        return;
+
+    const double periodMs = ctx->getTimestampPeriodToMs();
+    lastFrame.available = true;
+    lastFrame.frame = frame.frame;
+    lastFrame.gpuMs = (double)(timestamps[FRAME_END_QUERY] - timestamps[FRAME_BEGIN_QUERY]) * periodMs;
+    lastFrame.zones.clear();
+    for (uint32_t zone = 0; zone < frame.zones.size(); zone++)
+    {
+        const uint64_t begin = timestamps[FIRST_ZONE_QUERY + 2 * zone];
+        const uint64_t end = timestamps[FIRST_ZONE_QUERY + 2 * zone + 1];
+        lastFrame.zones.push_back({
+            .name = frame.zones[zone].name,
+            .depth = frame.zones[zone].depth,
+            .gpuMs = (double)(end - begin) * periodMs,
+        });
+    }
+}
+
+void GpuProfiler::clear()
+{
+    if (ctx)
+    {
+        for (Frame& frame : frames)
+        {
+            if (!frame.submit.empty())
+                ctx->wait(frame.submit);
+        }
+    }
+
+    timestampPool = {};
+    timestamps.clear();
+    frames.clear();
+    queriesPerFrame = 0;
+    currentFrame = 0;
+    frameCounter = 0;
+    openZones = 0;
+    lastFrame = {};
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <lvk/LVK.h>
+
+#include "core/profiler.h"
+#include "render/debug/gpu_zone.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Per-zone GPU timestamps, read back without stalling
+ *
+ * Every frame gets its own range of a timestamp query pool: beginFrame()
+ * resets it and writes the frame's first timestamp, each zone writes one
+ * on entry and one on exit. Results are read when the range comes around
+ * again, framesInFlight + 1 frames later. The frame ring has waited for
+ * that frame's submit by then, so the readback never blocks on the GPU;
+ * the price is that getLastFrame() trails the recorded frame.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t INVALID_ZONE = ~0u;
+
+    struct Config
+    {
+        uint32_t framesInFlight = 2; // Of the renderer, results trail by one frame more
+        uint32_t maxZones = 32; // Per frame, zones past it are not timed
+    };
+
+    struct ZoneResult
+    {
+        const char* name = ""; // As passed to beginZone(), must outlive the profiler
+        uint32_t depth = 0; // Zones open around it
+        double gpuMs = 0.0;
+    };
+
+    struct FrameResult
+    {
+        bool available = false; // False until the first frame was read back
+        uint64_t frame = 0; // Index of the frame the results belong to, counted by beginFrame()
+        double gpuMs = 0.0; // From beginFrame() to recordFrameEnd()
+        std::vector<ZoneResult> zones; // In the order they were opened
+    };
+
+    GpuProfiler() = default;
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    /**
+     * @brief Create the timestamp query pool
+     *
+     * @param ctx Context to allocate from, must outlive the profiler
+     * @param config Frame and zone counts
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(lvk::IContext* ctx, const Config& config, std::string& outErrorMsg);
+
+    /**
+     * @brief Read back the oldest frame and start timing a new one
+     *
+     * Call first on the frame's command buffer, outside of a render pass.
+     */
+    void beginFrame(lvk::ICommandBuffer& buf);
+
+    /**
+     * @brief Write a timestamp opening a zone
+     *
+     * @param name Label of the zone, must outlive the profiler
+     * @return Zone to pass to endZone(), INVALID_ZONE if this frame has no queries left
+     */
+    uint32_t beginZone(lvk::ICommandBuffer& buf, const char* name);
+
+    // Close a zone returned by beginZone(), INVALID_ZONE is ignored
+    void endZone(lvk::ICommandBuffer& buf, uint32_t zone);
+
+    // Write the frame's last timestamp, call last before submitting buf outside of a render pass
+    void recordFrameEnd(lvk::ICommandBuffer& buf);
+
+    /**
+     * @brief Finish the current frame
+     *
+     * @param handle Handle returned by the submit of the frame's command buffer
+     */
+    void endFrame(lvk::SubmitHandle handle);
+
+    // Results of the most recent frame that was read back
+    const FrameResult& getLastFrame() const { return lastFrame; }
+
+    // Wait for every frame in flight and release the query pool
+    void clear();
+
+    /**
+     * @brief Debug group and timed zone of the same name for the enclosing scope
+     *
+     * Does not time anything when profiler is null.
+     */
+    class Zone
+    {
+    public:
+        Zone(GpuProfiler* profiler, lvk::ICommandBuffer& buf, const char* name, uint32_t colorRGBA)
+        : profiler(profiler)
+        , buf(buf)
+        , label(buf, name, colorRGBA)
+        , zone(profiler ? profiler->beginZone(buf, name) : INVALID_ZONE)
+        {
+        }
+
+        ~Zone()
+        {
+            if (profiler)
+                profiler->endZone(buf, zone);
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        GpuProfiler* profiler;
+        lvk::ICommandBuffer& buf;
+        GpuZone<lvk::ICommandBuffer> label;
+        uint32_t zone;
+    };
+
+private:
+    // Queries of a frame: its begin and end timestamps, then a pair per zone
+    static constexpr uint32_t FRAME_BEGIN_QUERY = 0;
+    static constexpr uint32_t FRAME_END_QUERY = 1;
+    static constexpr uint32_t FIRST_ZONE_QUERY = 2;
+
+    struct ZoneQueries
+    {
+        const char* name = "";
+        uint32_t depth = 0;
+        bool open = true; // Closed by recordFrameEnd() at the latest, every query is written
+    };
+
+    struct Frame
+    {
+        lvk::SubmitHandle submit;
+        uint64_t frame = 0;
+        bool recorded = false;
+        std::vector<ZoneQueries> zones; // Zone i owns queries FIRST_ZONE_QUERY + 2i and the next one
+    };
+
+    lvk::IContext* ctx = nullptr;
+    Config config;
+    lvk::Holder<lvk::QueryPoolHandle> timestampPool;
+    uint32_t queriesPerFrame = 0;
+    std::vector<uint64_t> timestamps; // Readback scratch, one frame's queries
+
+    std::vector<Frame> frames;
+    uint32_t currentFrame = 0;
+    uint64_t frameCounter = 0;
+    uint32_t openZones = 0;
+    FrameResult lastFrame;
+
+    void readBack(uint32_t frameIndex);
+};
+
+} // namespace render
+} // namespace kholst
+
+// A debug group, a CPU zone and a timed GPU zone of the same name. Only for
+// lvk::ICommandBuffer; zones recorded into CommandLists use
+// KHOLST_PROFILER_GPU_ZONE and are covered by the timed zone of their pass.
+#define KHOLST_PROFILER_GPU_TIMED_ZONE(profiler, buf, name, colorRGBA) \
+    KHOLST_PROFILER_ZONE(name); \
+    const kholst::render::GpuProfiler::Zone kholstGpuTimedZone_(profiler, buf, name, colorRGBA)
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include <lvk/LVK.h>
+
+#include "core/profiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Scoped debug group around a section of a command buffer
+ *
+ * Pushes the label on construction and pops it on destruction, so RenderDoc
+ * and Nsight groups cannot be left unbalanced by an early return. Works on
+ * anything with LVK's debug label commands, lvk::ICommandBuffer or CommandList.
+ */
+template<typename CommandBuffer>
+class GpuZone
+{
+public:
+    GpuZone(CommandBuffer& buf, const char* name, uint32_t colorRGBA)
+    : buf(buf)
+    {
+        buf.cmdPushDebugGroupLabel(name, colorRGBA);
+    }
+
+    ~GpuZone()
+    {
+        buf.cmdPopDebugGroupLabel();
+    }
+
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+private:
+    CommandBuffer& buf;
+};
+
+} // namespace render
+} // namespace kholst
+
+// A debug group plus a CPU zone of the same name covering its recording.
+// LVK keeps its Tracy Vulkan context private; with LVK_WITH_TRACY_GPU its own
+// GPU zones around draws and dispatches nest under these groups in a capture.
+#define KHOLST_PROFILER_GPU_ZONE(buf, name, colorRGBA) \
+    KHOLST_PROFILER_ZONE(name); \
+    const kholst::render::GpuZone kholstGpuZone_(buf, name, colorRGBA)
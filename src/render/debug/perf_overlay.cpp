@@ -0,0 +1,172 @@
+#include "perf_overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include <imgui.h>
+
+namespace kholst
+{
+namespace render
+{
+
+static constexpr float GAP = std::numeric_limits<float>::quiet_NaN();
+
+static void formatValue(char* out, size_t size, PerfOverlay::Unit unit, double value)
+{
+    std::snprintf(out, size, unit == PerfOverlay::Unit::Count ? "%.0f" : "%.3f", value);
+}
+
+void PerfOverlay::addSample(std::string_view name, double value, Unit unit)
+{
+    auto it = std::find_if(series.begin(), series.end(), [name](const Series& s) { return s.name == name; });
+    if (it == series.end())
+    {
+        series.push_back({
+            .name = std::string(name),
+            .unit = unit,
+            .values = std::vector<float>(HISTORY_FRAMES, GAP),
+        });
+        it = series.end() - 1;
+    }
+
+    it->values[frameIndex % HISTORY_FRAMES] = (float)value;
+}
+
+void PerfOverlay::endFrame()
+{
+    frameIndex++;
+    frameCount = std::min(frameCount + 1, HISTORY_FRAMES - 1);
+
+    // The slot of the new frame still holds the oldest frame's samples
+    for (Series& s : series)
+        s.values[frameIndex % HISTORY_FRAMES] = GAP;
+}
+
+PerfOverlay::SeriesStats PerfOverlay::computeStats(const Series& s) const
+{
+    SeriesStats stats;
+    double sum = 0.0;
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        const float value = s.values[historySlot(i)];
+        if (std::isnan(value))
+            continue;
+
+        stats.min = stats.sampleCount ? std::min(stats.min, (double)value) : value;
+        stats.max = stats.sampleCount ? std::max(stats.max, (double)value) : value;
+        stats.last = value;
+        sum += value;
+        stats.sampleCount++;
+    }
+
+    if (stats.sampleCount)
+        stats.average = sum / stats.sampleCount;
+    return stats;
+}
+
+PerfOverlay::SeriesStats PerfOverlay::getStats(std::string_view name) const
+{
+    auto it = std::find_if(series.begin(), series.end(), [name](const Series& s) { return s.name == name; });
+    return it != series.end() ? computeStats(*it) : SeriesStats{};
+}
+
+void PerfOverlay::draw() const
+{
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.75f);
+    const ImGuiWindowFlags flags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+    if (!ImGui::Begin("Performance", nullptr, flags))
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Last %zu frames, min / avg / max", frameCount);
+
+    // Gaps hold the previous sample so the graph does not dip to zero
+    std::vector<float> plot(frameCount);
+    for (const Series& s : series)
+    {
+        const SeriesStats stats = computeStats(s);
+        if (!stats.sampleCount)
+            continue;
+
+        float held = (float)stats.min;
+        for (size_t i = 0; i < frameCount; i++)
+        {
+            const float value = s.values[historySlot(i)];
+            held = std::isnan(value) ? held : value;
+            plot[i] = held;
+        }
+
+        char last[32], min[32], average[32], max[32];
+        formatValue(last, sizeof(last), s.unit, stats.last);
+        formatValue(min, sizeof(min), s.unit, stats.min);
+        formatValue(average, sizeof(average), s.unit, stats.average);
+        formatValue(max, sizeof(max), s.unit, stats.max);
+
+        ImGui::TextUnformatted(s.name.c_str());
+        ImGui::SameLine(200.0f);
+        ImGui::Text("%s  %s / %s / %s", last, min, average, max);
+        ImGui::PushID(s.name.c_str());
+        ImGui::PlotLines("##graph", plot.data(), (int)plot.size(), 0, nullptr,
+            0.0f, std::max((float)stats.max * 1.1f, 1e-3f), ImVec2(420.0f, 32.0f));
+        ImGui::PopID();
+    }
+
+    ImGui::End();
+}
+
+bool PerfOverlay::writeCsv(const std::filesystem::path& path, std::string& outErrorMsg) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        outErrorMsg = "Failed to open " + path.string();
+        return false;
+    }
+
+    file << "frame";
+    for (const Series& s : series)
+        file << ",\"" << s.name << (s.unit == Unit::Count ? "\"" : " (ms)\"");
+    file << '\n';
+
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        file << frameIndex - frameCount + i;
+        for (const Series& s : series)
+        {
+            file << ',';
+
+            const float value = s.values[historySlot(i)];
+            if (std::isnan(value))
+                continue;
+
+            char cell[32];
+            formatValue(cell, sizeof(cell), s.unit, value);
+            file << cell;
+        }
+        file << '\n';
+    }
+
+    if (!file.good())
+    {
+        outErrorMsg = "Failed to write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+void PerfOverlay::clear()
+{
+    series.clear();
+    frameIndex = 0;
+    frameCount = 0;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Rolling per-frame performance series, drawn with ImGui and exported as CSV
+ *
+ * Every frame the caller adds at most one sample per series, CPU phases,
+ * GPU zones or counters, then calls endFrame(). Series are created on
+ * their first sample and keep the last HISTORY_FRAMES frames; a frame
+ * without a sample for a series leaves a gap rather than a zero, which
+ * matters for GPU results that only arrive when a readback completes.
+ *
+ * draw() issues ImGui calls for a window with one line and graph per
+ * series and its min/avg/max over the window; it must run between the
+ * ImGui renderer's beginFrame() and endFrame().
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class PerfOverlay
+{
+public:
+    enum class Unit : uint8_t
+    {
+        Milliseconds,
+        Count,
+    };
+
+    struct SeriesStats
+    {
+        size_t sampleCount = 0; // Frames in the window with a sample
+        double last = 0.0;
+        double min = 0.0;
+        double average = 0.0;
+        double max = 0.0;
+    };
+
+    // Record a sample for the current frame, a second one for the same series replaces the first
+    void addSample(std::string_view name, double value, Unit unit = Unit::Milliseconds);
+
+    // Close the current frame, the next addSample() starts a new one
+    void endFrame();
+
+    // Draw the overlay window, see the ImGui constraint above
+    void draw() const;
+
+    /**
+     * @brief Write the window as CSV, one row per frame and one column per series
+     *
+     * The first column is the frame index, gaps are empty cells.
+     *
+     * @param path File to write, replaced if it exists
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool writeCsv(const std::filesystem::path& path, std::string& outErrorMsg) const;
+
+    // Statistics of a series over the window, all zero if it does not exist
+    SeriesStats getStats(std::string_view name) const;
+
+    uint64_t getFrameIndex() const { return frameIndex; }
+
+    void clear();
+
+private:
+    static constexpr size_t HISTORY_FRAMES = 600;
+
+    struct Series
+    {
+        std::string name;
+        Unit unit = Unit::Milliseconds;
+        std::vector<float> values; // HISTORY_FRAMES long, indexed by frame modulo its length, NaN marks a gap
+    };
+
+    std::vector<Series> series; // In the order they first got a sample
+    uint64_t frameIndex = 0; // Frame receiving samples
+    size_t frameCount = 0; // Closed frames in the window
+
+    // Slot of the i-th closed frame in the window, 0 is the oldest
+    size_t historySlot(size_t i) const { return (size_t)((frameIndex - frameCount + i) % HISTORY_FRAMES); }
+    SeriesStats computeStats(const Series& s) const;
+};
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,152 @@
+#include "device_features.h"
+
+#include <cstring>
+#include <vector>
+
+#include <lvk/vulkan/VulkanClasses.h>
+
+namespace kholst
+{
+namespace render
+{
+
+// Chained into the device create info by LVK, so it has to outlive the call
+static VkPhysicalDeviceFragmentShaderBarycentricFeaturesKHR barycentricFeatures = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADER_BARYCENTRIC_FEATURES_KHR,
+    .fragmentShaderBarycentric = VK_TRUE,
+};
+
+static VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+    .taskShader = VK_TRUE,
+    .meshShader = VK_TRUE,
+};
+
+// Checks the feature bits a device reports for an extension, the extension itself is already known to be there
+using FeatureCheck = bool (*)(VkPhysicalDevice device);
+
+static bool hasExtension(VkPhysicalDevice device, const char* extensionName)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+    for (const VkExtensionProperties& extension : extensions)
+    {
+        if (std::strcmp(extension.extensionName, extensionName) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Fills a chain of feature structs the way the device reports them
+static void queryFeatures(VkPhysicalDevice device, void* featureChain)
+{
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = featureChain,
+    };
+    vkGetPhysicalDeviceFeatures2(device, &features);
+}
+
+// An extension can be exposed with some of its features unsupported, enabling those is invalid
+static bool isSupportedByAllDevices(VkInstance instance, const char* extensionName, FeatureCheck hasFeatures)
+{
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+    if (devices.empty())
+        return false;
+
+    for (VkPhysicalDevice device : devices)
+    {
+        if (!hasExtension(device, extensionName) || (hasFeatures && !hasFeatures(device)))
+            return false;
+    }
+
+    return true;
+}
+
+static bool hasBarycentricFeatures(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceFragmentShaderBarycentricFeaturesKHR features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADER_BARYCENTRIC_FEATURES_KHR,
+    };
+    queryFeatures(device, &features);
+    return features.fragmentShaderBarycentric;
+}
+
+static bool hasMeshShaderFeatures(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceMeshShaderFeaturesEXT features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+    };
+    queryFeatures(device, &features);
+    // The renderer always culls in a task shader before its mesh shader
+    return features.taskShader && features.meshShader;
+}
+
+static bool appendDeviceExtension(lvk::ContextConfig& config, const char* extensionName)
+{
+    for (const char*& slot : config.extensionsDevice)
+    {
+        if (!slot)
+        {
+            slot = extensionName;
+            return true;
+        }
+    }
+    return false;
+}
+
+DeviceFeatures requestOptionalDeviceFeatures(lvk::ContextConfig& config, const DeviceFeatures& wanted)
+{
+    DeviceFeatures enabled;
+    if (!wanted.fragmentShaderBarycentric && !wanted.meshShader)
+        return enabled;
+
+    if (volkInitialize() != VK_SUCCESS)
+        return enabled;
+
+    // A bare instance is enough to enumerate devices; LVK creates its own afterwards
+    const VkApplicationInfo appInfo = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .apiVersion = VK_API_VERSION_1_3,
+    };
+    const VkInstanceCreateInfo instanceInfo = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &appInfo,
+    };
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS)
+        return enabled;
+    volkLoadInstanceOnly(instance);
+
+    if (wanted.fragmentShaderBarycentric &&
+        isSupportedByAllDevices(instance, VK_KHR_FRAGMENT_SHADER_BARYCENTRIC_EXTENSION_NAME, hasBarycentricFeatures) &&
+        appendDeviceExtension(config, VK_KHR_FRAGMENT_SHADER_BARYCENTRIC_EXTENSION_NAME))
+    {
+        barycentricFeatures.pNext = config.extensionsDeviceFeatures;
+        config.extensionsDeviceFeatures = &barycentricFeatures;
+        enabled.fragmentShaderBarycentric = true;
+    }
+
+    if (wanted.meshShader &&
+        isSupportedByAllDevices(instance, VK_EXT_MESH_SHADER_EXTENSION_NAME, hasMeshShaderFeatures) &&
+        appendDeviceExtension(config, VK_EXT_MESH_SHADER_EXTENSION_NAME))
+    {
+        meshShaderFeatures.pNext = config.extensionsDeviceFeatures;
+        config.extensionsDeviceFeatures = &meshShaderFeatures;
+        enabled.meshShader = true;
+    }
+
+    vkDestroyInstance(instance, nullptr);
+    return enabled;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <lvk/LVK.h>
+
+
+namespace kholst
+{
+namespace render
+{
+
+// Optional device features the renderer can take advantage of
+struct DeviceFeatures
+{
+    bool fragmentShaderBarycentric = false; // SV_Barycentrics in fragment shaders
+    bool meshShader = false; // Task and mesh shader stages, VK_EXT_mesh_shader
+};
+
+/**
+ * @brief Request optional device features from the context about to be created
+ *
+ * LVK refuses to create a device if a requested extension is missing, so
+ * every physical device is probed up front and a feature is only added to
+ * config if all of them support it, whichever device LVK then picks. A
+ * device supports a feature if it exposes the extension and reports every
+ * feature bit the renderer enables for it.
+ *
+ * @param config Configuration passed to lvk::createVulkanContextWithSwapchain()
+ *               afterwards; it stays valid until the next call
+ * @param wanted Features to request
+ * @return Features that were added to config
+ */
+DeviceFeatures requestOptionalDeviceFeatures(lvk::ContextConfig& config, const DeviceFeatures& wanted);
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,128 @@
+#include "frame_ring.h"
+
+#include "core/async_log.h"
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+FrameRing::~FrameRing()
+{
+    clear();
+}
+
+bool FrameRing::initialize(lvk::IContext* context, uint32_t framesInFlight, size_t sliceSize, std::string& outErrorMsg)
+{
+    clear();
+
+    if (!framesInFlight || !sliceSize)
+    {
+        outErrorMsg = "Frame ring needs at least one frame and a non-empty slice";
+        return false;
+    }
+
+    // Keep every slice aligned so allocations are aligned in absolute terms
+    sliceSize = (sliceSize + DEFAULT_ALIGNMENT - 1) & ~(DEFAULT_ALIGNMENT - 1);
+
+    lvk::Result res;
+    buffer = context->createBuffer({
+        .usage = lvk::BufferUsageBits_Storage | lvk::BufferUsageBits_Uniform | lvk::BufferUsageBits_Indirect,
+        .storage = lvk::StorageType_HostVisible,
+        .size = sliceSize * framesInFlight,
+        .debugName = "Buffer: frame ring",
+    }, nullptr, &res);
+
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create frame ring buffer: ") + (res.message ? res.message : "");
+        buffer = {};
+        return false;
+    }
+
+    ctx = context;
+    mappedPtr = ctx->getMappedPtr(buffer);
+    bytesPerFrame = sliceSize;
+    frames.resize(framesInFlight);
+    // The first beginFrame() moves to slice 0
+    currentFrame = framesInFlight - 1;
+    return true;
+}
+
+void FrameRing::beginFrame()
+{
+    if (frames.empty())
+        return;
+
+    currentFrame = (currentFrame + 1) % (uint32_t)frames.size();
+
+    Frame& frame = frames[currentFrame];
+    if (!frame.submit.empty())
+    {
+        KHOLST_PROFILER_ZONE_COLOR("Wait for frame in flight", KHOLST_PROFILER_COLOR_WAIT);
+        ctx->wait(frame.submit);
+        frame.submit = {};
+    }
+    frame.used = 0;
+}
+
+FrameRing::Allocation FrameRing::allocate(size_t size, size_t alignment)
+{
+    if (frames.empty() || !size)
+        return {};
+
+    Frame& frame = frames[currentFrame];
+    const size_t offset = (frame.used + alignment - 1) & ~(alignment - 1);
+    if (offset + size > bytesPerFrame)
+    {
+        KHOLST_LOGW("Frame ring slice exhausted (%zu of %zu bytes requested)\n", offset + size, bytesPerFrame);
+        return {};
+    }
+    frame.used = offset + size;
+
+    const size_t bufferOffset = currentFrame * bytesPerFrame + offset;
+    return {
+        .ptr = mappedPtr + bufferOffset,
+        .gpuAddress = ctx->gpuAddress(buffer, bufferOffset),
+        .offset = bufferOffset,
+        .size = size,
+    };
+}
+
+void FrameRing::flush()
+{
+    if (frames.empty())
+        return;
+
+    const Frame& frame = frames[currentFrame];
+    if (frame.used)
+        ctx->flushMappedMemory(buffer, currentFrame * bytesPerFrame, frame.used);
+}
+
+void FrameRing::endFrame(lvk::SubmitHandle handle)
+{
+    if (frames.empty())
+        return;
+
+    frames[currentFrame].submit = handle;
+}
+
+void FrameRing::clear()
+{
+    for (Frame& frame : frames)
+    {
+        if (!frame.submit.empty())
+            ctx->wait(frame.submit);
+    }
+
+    frames.clear();
+    buffer = {};
+    mappedPtr = nullptr;
+    bytesPerFrame = 0;
+    currentFrame = 0;
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
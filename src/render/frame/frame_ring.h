@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <lvk/LVK.h>
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Per-frame transient memory for a fixed number of frames in flight
+ *
+ * One host-visible buffer is split into a slice per frame in flight. The CPU
+ * writes frame N+1 into its own slice while the GPU still reads frame N from
+ * another one. beginFrame() only blocks if the GPU has not yet finished the
+ * frame that last used the slice being reused, tracked with the submit handle
+ * passed to endFrame().
+ *
+ * Allocations are linear within a slice and are valid until the same slice
+ * comes around again.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class FrameRing
+{
+public:
+    struct Allocation
+    {
+        void* ptr = nullptr;
+        uint64_t gpuAddress = 0; // Buffer device address, for pointers in push constants
+        size_t offset = 0; // Offset into getBuffer()
+        size_t size = 0;
+
+        explicit operator bool() const { return ptr != nullptr; }
+    };
+
+    FrameRing() = default;
+    ~FrameRing();
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /**
+     * @brief Create the backing buffer
+     *
+     * @param ctx Context to allocate from, must outlive the ring
+     * @param framesInFlight Number of frames the CPU may run ahead of the GPU plus one
+     * @param bytesPerFrame Size of each frame's slice
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(lvk::IContext* ctx, uint32_t framesInFlight, size_t bytesPerFrame, std::string& outErrorMsg);
+
+    // Advance to the next slice, waiting for the GPU to release it if needed
+    void beginFrame();
+
+    /**
+     * @brief Carve memory out of the current frame's slice
+     *
+     * @return Allocation, or an empty one if the slice is exhausted
+     */
+    Allocation allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT);
+
+    // Allocate and copy a value into the current frame's slice
+    template<typename ValueType>
+        requires std::is_trivially_copyable_v<ValueType>
+    Allocation push(const ValueType& value)
+    {
+        Allocation allocation = allocate(sizeof(value), alignof(ValueType) > DEFAULT_ALIGNMENT ? alignof(ValueType) : DEFAULT_ALIGNMENT);
+        if (allocation)
+            std::memcpy(allocation.ptr, &value, sizeof(value));
+        return allocation;
+    }
+
+    // Make this frame's writes visible to the device, call before submitting
+    void flush();
+
+    /**
+     * @brief Finish the current frame
+     *
+     * @param handle Handle returned by the submit that consumes this frame's data
+     */
+    void endFrame(lvk::SubmitHandle handle);
+
+    // Wait for every frame in flight and release the buffer
+    void clear();
+
+    uint32_t getFramesInFlight() const { return (uint32_t)frames.size(); }
+    uint32_t getFrameIndex() const { return currentFrame; }
+    lvk::BufferHandle getBuffer() const { return buffer; }
+
+private:
+    // Covers std140/std430 vec4 and matrix alignment as well as nonCoherentAtomSize on common hardware
+    static constexpr size_t DEFAULT_ALIGNMENT = 256;
+
+    struct Frame
+    {
+        lvk::SubmitHandle submit;
+        size_t used = 0;
+    };
+
+    lvk::IContext* ctx = nullptr;
+    lvk::Holder<lvk::BufferHandle> buffer;
+    uint8_t* mappedPtr = nullptr;
+    size_t bytesPerFrame = 0;
+
+    std::vector<Frame> frames;
+    uint32_t currentFrame = 0;
+};
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,238 @@
+#include "command_list.h"
+
+#include <string_view>
+
+namespace kholst
+{
+namespace render
+{
+
+struct BindVertexBufferArgs
+{
+    uint32_t index;
+    lvk::BufferHandle buffer;
+    uint64_t offset;
+};
+
+struct BindIndexBufferArgs
+{
+    lvk::BufferHandle buffer;
+    lvk::IndexFormat format;
+    uint64_t offset;
+};
+
+// Followed by size bytes of data
+struct PushConstantsArgs
+{
+    uint32_t size;
+    uint32_t offset;
+};
+
+struct DrawArgs
+{
+    uint32_t vertexCount;
+    uint32_t instanceCount;
+    uint32_t firstVertex;
+    uint32_t baseInstance;
+};
+
+struct DrawIndexedArgs
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t baseInstance;
+};
+
+struct DrawIndexedIndirectArgs
+{
+    lvk::BufferHandle buffer;
+    uint64_t offset;
+    uint32_t drawCount;
+    uint32_t stride;
+};
+
+// Followed by the NUL-terminated label
+struct DebugLabelArgs
+{
+    uint32_t colorRGBA;
+};
+
+template<typename Payload>
+static Payload read(const uint8_t* payload)
+{
+    Payload value;
+    std::memcpy(&value, payload, sizeof(Payload));
+    return value;
+}
+
+uint8_t* CommandList::append(Op op, size_t size)
+{
+    const size_t padded = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    const size_t offset = data.size();
+    data.resize(offset + sizeof(Header) + padded);
+
+    const Header header = { .op = op, .size = (uint32_t)padded };
+    std::memcpy(data.data() + offset, &header, sizeof(Header));
+    commandCount++;
+    return data.data() + offset + sizeof(Header);
+}
+
+void CommandList::cmdBindRenderPipeline(lvk::RenderPipelineHandle handle)
+{
+    write(Op::BindRenderPipeline, handle);
+}
+
+void CommandList::cmdBindDepthState(const lvk::DepthState& state)
+{
+    write(Op::BindDepthState, state);
+}
+
+void CommandList::cmdBindVertexBuffer(uint32_t index, lvk::BufferHandle buffer, uint64_t bufferOffset)
+{
+    write(Op::BindVertexBuffer, BindVertexBufferArgs{ .index = index, .buffer = buffer, .offset = bufferOffset });
+}
+
+void CommandList::cmdBindIndexBuffer(lvk::BufferHandle indexBuffer, lvk::IndexFormat indexFormat, uint64_t indexBufferOffset)
+{
+    write(Op::BindIndexBuffer, BindIndexBufferArgs{ .buffer = indexBuffer, .format = indexFormat, .offset = indexBufferOffset });
+}
+
+void CommandList::cmdPushConstants(const void* constants, size_t size, size_t offset)
+{
+    const PushConstantsArgs args = { .size = (uint32_t)size, .offset = (uint32_t)offset };
+    uint8_t* payload = append(Op::PushConstants, sizeof(args) + size);
+    std::memcpy(payload, &args, sizeof(args));
+    std::memcpy(payload + sizeof(args), constants, size);
+}
+
+void CommandList::cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t baseInstance)
+{
+    write(Op::Draw, DrawArgs{
+        .vertexCount = vertexCount,
+        .instanceCount = instanceCount,
+        .firstVertex = firstVertex,
+        .baseInstance = baseInstance,
+    });
+}
+
+void CommandList::cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t baseInstance)
+{
+    write(Op::DrawIndexed, DrawIndexedArgs{
+        .indexCount = indexCount,
+        .instanceCount = instanceCount,
+        .firstIndex = firstIndex,
+        .vertexOffset = vertexOffset,
+        .baseInstance = baseInstance,
+    });
+}
+
+void CommandList::cmdDrawIndexedIndirect(lvk::BufferHandle indirectBuffer, size_t indirectBufferOffset, uint32_t drawCount, uint32_t stride)
+{
+    write(Op::DrawIndexedIndirect, DrawIndexedIndirectArgs{
+        .buffer = indirectBuffer,
+        .offset = indirectBufferOffset,
+        .drawCount = drawCount,
+        .stride = stride,
+    });
+}
+
+void CommandList::cmdDrawMeshTasks(const lvk::Dimensions& threadgroupCount)
+{
+    write(Op::DrawMeshTasks, threadgroupCount);
+}
+
+void CommandList::cmdPushDebugGroupLabel(const char* label, uint32_t colorRGBA)
+{
+    const size_t length = std::string_view(label).size() + 1;
+    uint8_t* payload = append(Op::PushDebugGroupLabel, sizeof(DebugLabelArgs) + length);
+    const DebugLabelArgs args = { .colorRGBA = colorRGBA };
+    std::memcpy(payload, &args, sizeof(args));
+    std::memcpy(payload + sizeof(args), label, length);
+}
+
+void CommandList::cmdPopDebugGroupLabel()
+{
+    append(Op::PopDebugGroupLabel, 0);
+}
+
+void CommandList::replay(lvk::ICommandBuffer& buf) const
+{
+    const uint8_t* p = data.data();
+    const uint8_t* end = p + data.size();
+
+    while (p < end)
+    {
+        const Header header = read<Header>(p);
+        const uint8_t* payload = p + sizeof(Header);
+        p = payload + header.size;
+
+        switch (header.op)
+        {
+        case Op::BindRenderPipeline:
+            buf.cmdBindRenderPipeline(read<lvk::RenderPipelineHandle>(payload));
+            break;
+        case Op::BindDepthState:
+            buf.cmdBindDepthState(read<lvk::DepthState>(payload));
+            break;
+        case Op::BindVertexBuffer:
+        {
+            const BindVertexBufferArgs args = read<BindVertexBufferArgs>(payload);
+            buf.cmdBindVertexBuffer(args.index, args.buffer, args.offset);
+            break;
+        }
+        case Op::BindIndexBuffer:
+        {
+            const BindIndexBufferArgs args = read<BindIndexBufferArgs>(payload);
+            buf.cmdBindIndexBuffer(args.buffer, args.format, args.offset);
+            break;
+        }
+        case Op::PushConstants:
+        {
+            const PushConstantsArgs args = read<PushConstantsArgs>(payload);
+            buf.cmdPushConstants(payload + sizeof(args), args.size, args.offset);
+            break;
+        }
+        case Op::Draw:
+        {
+            const DrawArgs args = read<DrawArgs>(payload);
+            buf.cmdDraw(args.vertexCount, args.instanceCount, args.firstVertex, args.baseInstance);
+            break;
+        }
+        case Op::DrawIndexed:
+        {
+            const DrawIndexedArgs args = read<DrawIndexedArgs>(payload);
+            buf.cmdDrawIndexed(args.indexCount, args.instanceCount, args.firstIndex, args.vertexOffset, args.baseInstance);
+            break;
+        }
+        case Op::DrawIndexedIndirect:
+        {
+            const DrawIndexedIndirectArgs args = read<DrawIndexedIndirectArgs>(payload);
+            buf.cmdDrawIndexedIndirect(args.buffer, args.offset, args.drawCount, args.stride);
+            break;
+        }
+        case Op::DrawMeshTasks:
+            buf.cmdDrawMeshTasks(read<lvk::Dimensions>(payload));
+            break;
+        case Op::PushDebugGroupLabel:
+        {
+            const DebugLabelArgs args = read<DebugLabelArgs>(payload);
+            buf.cmdPushDebugGroupLabel((const char*)payload + sizeof(args), args.colorRGBA);
+            break;
+        }
+        case Op::PopDebugGroupLabel:
+            buf.cmdPopDebugGroupLabel();
+            break;
+        }
+    }
+}
+
+void CommandList::reset()
+{
+    data.clear();
+    commandCount = 0;
+}
+
+} // namespace render
+} // namespace kholst
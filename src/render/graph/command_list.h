@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <lvk/LVK.h>
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Records draw commands on any thread for later replay into an LVK command buffer
+ *
+ * LVK command buffers come from one command pool and can only be recorded
+ * on the render thread. A CommandList stores the same commands, with the
+ * same names and arguments as lvk::ICommandBuffer, as a compact byte stream
+ * that replay() turns into the real calls in one tight loop. Walking scene
+ * data, picking pipelines and packing push constants happens wherever the
+ * list is recorded.
+ *
+ * Only state and draw commands are covered; render passes, barriers and
+ * dispatches stay on the command buffer itself.
+ *
+ * reset() keeps the storage, so a list reused every frame stops allocating
+ * once it has seen its largest frame.
+ *
+ * Thread-safety: one thread records a list at a time.
+ */
+class CommandList
+{
+public:
+    void cmdBindRenderPipeline(lvk::RenderPipelineHandle handle);
+    void cmdBindDepthState(const lvk::DepthState& state);
+    void cmdBindVertexBuffer(uint32_t index, lvk::BufferHandle buffer, uint64_t bufferOffset = 0);
+    void cmdBindIndexBuffer(lvk::BufferHandle indexBuffer, lvk::IndexFormat indexFormat, uint64_t indexBufferOffset = 0);
+    void cmdPushConstants(const void* data, size_t size, size_t offset = 0);
+
+    template<typename Struct>
+        requires std::is_trivially_copyable_v<Struct>
+    void cmdPushConstants(const Struct& data, size_t offset = 0)
+    {
+        cmdPushConstants(&data, sizeof(Struct), offset);
+    }
+
+    void cmdDraw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t baseInstance = 0);
+    void cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t baseInstance = 0);
+    void cmdDrawIndexedIndirect(lvk::BufferHandle indirectBuffer, size_t indirectBufferOffset, uint32_t drawCount, uint32_t stride = 0);
+    void cmdDrawMeshTasks(const lvk::Dimensions& threadgroupCount);
+
+    // The label is copied into the list
+    void cmdPushDebugGroupLabel(const char* label, uint32_t colorRGBA = 0xffffffff);
+    void cmdPopDebugGroupLabel();
+
+    // Issue every recorded command on buf, in recording order
+    void replay(lvk::ICommandBuffer& buf) const;
+
+    // Drop the commands, keep the storage
+    void reset();
+
+    bool empty() const { return data.empty(); }
+    size_t getSizeBytes() const { return data.size(); }
+    uint32_t getCommandCount() const { return commandCount; }
+
+private:
+    enum class Op : uint32_t
+    {
+        BindRenderPipeline,
+        BindDepthState,
+        BindVertexBuffer,
+        BindIndexBuffer,
+        PushConstants,
+        Draw,
+        DrawIndexed,
+        DrawIndexedIndirect,
+        DrawMeshTasks,
+        PushDebugGroupLabel,
+        PopDebugGroupLabel,
+    };
+
+    // Every command starts with a header; payloads are padded to keep headers aligned
+    struct Header
+    {
+        Op op;
+        uint32_t size; // Payload bytes after the header, padded
+    };
+
+    static constexpr size_t ALIGNMENT = 8;
+
+    std::vector<uint8_t> data;
+    uint32_t commandCount = 0;
+
+    // Append a command, the returned payload has size bytes of room
+    uint8_t* append(Op op, size_t size);
+
+    template<typename Payload>
+    void write(Op op, const Payload& payload)
+    {
+        static_assert(std::is_trivially_copyable_v<Payload>);
+        std::memcpy(append(op, sizeof(Payload)), &payload, sizeof(Payload));
+    }
+};
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,193 @@
+#include "pass_executor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "core/async_log.h"
+#include "core/profiler.h"
+#include "render/debug/gpu_profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+// Debug group color of the passes, the groups recorded inside them nest under it
+static constexpr uint32_t PASS_LABEL_COLOR = 0xffffff00;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+PassExecutor::PassExecutor() = default;
+
+PassExecutor::~PassExecutor()
+{
+    if (executor)
+        executor->wait_for_all();
+}
+
+bool PassExecutor::initialize(size_t workerCount, std::string& outErrorMsg)
+{
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    if (executor)
+    {
+        outErrorMsg = "Pass executor already initialized";
+        return false;
+    }
+
+    executor = std::make_unique<tf::Executor>(workerCount);
+    return true;
+}
+
+PassExecutor::PassId PassExecutor::addPass(Pass pass)
+{
+    passes.push_back(std::move(pass));
+    return (PassId)passes.size() - 1;
+}
+
+void PassExecutor::addDependency(PassId pass, PassId dependency)
+{
+    if (pass < passes.size())
+        passes[pass].dependencies.push_back(dependency);
+}
+
+bool PassExecutor::execute(lvk::ICommandBuffer& buf)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    stats = { .passCount = (uint32_t)passes.size() };
+
+    if (!sortPasses())
+    {
+        KHOLST_LOGW("Render passes have cyclic or unknown dependencies, frame not recorded\n");
+        passes.clear();
+        return false;
+    }
+
+    ranges.clear();
+    firstRanges.clear();
+    for (PassId id = 0; id < passes.size(); id++)
+    {
+        const Pass& pass = passes[id];
+        firstRanges.push_back((uint32_t)ranges.size());
+        if (!pass.record)
+            continue;
+
+        if (!pass.itemCount)
+        {
+            ranges.push_back({ .pass = id });
+            continue;
+        }
+
+        const uint32_t step = std::max(pass.itemsPerTask, 1u);
+        for (uint32_t first = 0; first < pass.itemCount; first += step)
+            ranges.push_back({ .pass = id, .firstItem = first, .itemCount = std::min(step, pass.itemCount - first) });
+    }
+    firstRanges.push_back((uint32_t)ranges.size());
+
+    if (lists.size() < ranges.size())
+        lists.resize(ranges.size());
+
+    const std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
+    recordRanges();
+    stats.recordMs = millisecondsSince(recordStart);
+
+    const std::chrono::steady_clock::time_point replayStart = std::chrono::steady_clock::now();
+    {
+        KHOLST_PROFILER_ZONE_COLOR("Replay passes", KHOLST_PROFILER_COLOR_RECORD);
+        for (PassId id : order)
+        {
+            const Pass& pass = passes[id];
+            const GpuProfiler::Zone zone(gpuProfiler, buf, pass.name, PASS_LABEL_COLOR);
+            if (pass.begin)
+                pass.begin(buf);
+            for (uint32_t i = firstRanges[id]; i < firstRanges[id + 1]; i++)
+            {
+                lists[i].replay(buf);
+                stats.commandCount += lists[i].getCommandCount();
+                stats.commandBytes += lists[i].getSizeBytes();
+            }
+            if (pass.end)
+                pass.end(buf);
+        }
+    }
+    stats.replayMs = millisecondsSince(replayStart);
+    stats.taskCount = (uint32_t)ranges.size();
+
+    KHOLST_PROFILER_PLOT("Recorded command bytes", (int64_t)stats.commandBytes);
+
+    passes.clear();
+    return true;
+}
+
+void PassExecutor::recordRanges()
+{
+    KHOLST_PROFILER_ZONE_COLOR("Record passes", KHOLST_PROFILER_COLOR_RECORD);
+
+    auto recordRange = [this](size_t index)
+    {
+        const Range& range = ranges[index];
+        lists[index].reset();
+        passes[range.pass].record(lists[index], range.firstItem, range.itemCount);
+    };
+
+    // Not worth a round trip through the pool
+    if (!executor || ranges.size() <= 1)
+    {
+        for (size_t i = 0; i < ranges.size(); i++)
+            recordRange(i);
+        return;
+    }
+
+    tf::Taskflow taskflow;
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        taskflow.emplace([&recordRange, i]()
+        {
+            KHOLST_PROFILER_ZONE("Record range");
+            recordRange(i);
+        });
+    }
+    executor->run(taskflow).wait();
+}
+
+// Repeated sweeps over the passes in add order, so independent passes keep it
+bool PassExecutor::sortPasses()
+{
+    const size_t passCount = passes.size();
+    std::vector<bool> sorted(passCount, false);
+
+    order.clear();
+    while (order.size() < passCount)
+    {
+        const size_t sortedBefore = order.size();
+        for (PassId id = 0; id < passCount; id++)
+        {
+            if (sorted[id])
+                continue;
+
+            const std::vector<PassId>& dependencies = passes[id].dependencies;
+            const bool ready = std::all_of(dependencies.begin(), dependencies.end(), [&](PassId dependency)
+            {
+                return dependency < passCount && sorted[dependency];
+            });
+            if (ready)
+            {
+                sorted[id] = true;
+                order.push_back(id);
+            }
+        }
+
+        if (order.size() == sortedBefore)
+            return false;
+    }
+    return true;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lvk/LVK.h>
+#include <taskflow/taskflow.hpp>
+
+#include "render/graph/command_list.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+class GpuProfiler;
+
+/**
+ * @brief Records the passes of a frame on a worker pool and replays them in dependency order
+ *
+ * Each pass splits its items (draws, instances, meshes...) into ranges of
+ * Pass::itemsPerTask. Every range is recorded into its own CommandList on
+ * a Taskflow worker, for all passes at once since recording has no
+ * ordering constraints. The render thread then walks the passes in
+ * dependency order and, per pass, runs begin(), replays its ranges in item
+ * order and runs end() on the frame's command buffer, so the frame still
+ * goes out as one submit in a well-defined order.
+ *
+ * Only recording runs in parallel, and only across ranges: replay is serial
+ * and a pass without itemCount is one range. The scene passes draw through
+ * a few indirect commands and record as one range each, so today the
+ * parallelism is across passes rather than within them.
+ *
+ * Command lists are kept across frames, so steady-state frames do not
+ * allocate command storage.
+ *
+ * Thread-safety: not thread-safe, use from the render thread. Pass::record
+ * runs concurrently with itself and with other passes' record callbacks.
+ */
+class PassExecutor
+{
+public:
+    using PassId = uint32_t;
+
+    struct Pass
+    {
+        const char* name = "";
+        std::vector<PassId> dependencies; // Replayed before this pass, passes keep their add order otherwise
+        uint32_t itemCount = 0; // 0 records the pass as a single range
+        uint32_t itemsPerTask = 256;
+
+        // Render thread, before the recorded commands: begin rendering, barriers, dispatches
+        std::function<void(lvk::ICommandBuffer& buf)> begin;
+        // Worker thread: record items [firstItem, firstItem + itemCount)
+        std::function<void(CommandList& list, uint32_t firstItem, uint32_t itemCount)> record;
+        // Render thread, after the recorded commands
+        std::function<void(lvk::ICommandBuffer& buf)> end;
+    };
+
+    struct Stats
+    {
+        uint32_t passCount = 0;
+        uint32_t taskCount = 0; // Ranges recorded during the last execute()
+        uint32_t commandCount = 0;
+        size_t commandBytes = 0;
+        double recordMs = 0.0; // Wall time of the parallel recording
+        double replayMs = 0.0;
+    };
+
+    PassExecutor();
+    ~PassExecutor();
+
+    PassExecutor(const PassExecutor&) = delete;
+    PassExecutor& operator=(const PassExecutor&) = delete;
+
+    /**
+     * @brief Create the worker pool
+     *
+     * @param workerCount Number of worker threads, 0 picks the core count
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(size_t workerCount, std::string& outErrorMsg);
+
+    // Add a pass to the next execute()
+    PassId addPass(Pass pass);
+
+    // Replay dependency before pass, for dependencies on passes added later
+    void addDependency(PassId pass, PassId dependency);
+
+    /**
+     * @brief Record every pass added since the previous execute() and replay it into buf
+     *
+     * Passes are dropped afterwards, the command storage is kept.
+     *
+     * @return false if the dependencies form a cycle, nothing is replayed then
+     */
+    bool execute(lvk::ICommandBuffer& buf);
+
+    Stats getStats() const { return stats; }
+
+    // Time every replayed pass as a zone of its name, null turns it off
+    void setGpuProfiler(GpuProfiler* profiler) { gpuProfiler = profiler; }
+
+    size_t getWorkerCount() const { return executor ? executor->num_workers() : 0; }
+
+private:
+    struct Range
+    {
+        PassId pass = 0;
+        uint32_t firstItem = 0;
+        uint32_t itemCount = 0;
+    };
+
+    std::unique_ptr<tf::Executor> executor;
+    std::vector<Pass> passes;
+    std::vector<Range> ranges; // Grouped by pass, in item order
+    std::vector<uint32_t> firstRanges; // Per pass, into ranges, plus one past the end
+    std::vector<PassId> order;
+    std::vector<CommandList> lists; // One per range, reused across frames
+    GpuProfiler* gpuProfiler = nullptr;
+    Stats stats;
+
+    void recordRanges();
+    bool sortPasses();
+};
+
+} // namespace render
+} // namespace kholst
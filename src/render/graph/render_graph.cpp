@@ -0,0 +1,409 @@
+#include "render_graph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include "core/async_log.h"
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+template<typename Handle, size_t Count>
+static bool appendUnique(Handle (&slots)[Count], Handle handle)
+{
+    for (Handle& slot : slots)
+    {
+        if (slot == handle)
+            return true;
+        if (slot.empty())
+        {
+            slot = handle;
+            return true;
+        }
+    }
+    return false;
+}
+
+lvk::Dependencies mergeDependencies(const lvk::Dependencies& a, const lvk::Dependencies& b)
+{
+    lvk::Dependencies merged = a;
+    bool fits = true;
+    for (lvk::TextureHandle texture : b.textures)
+    {
+        if (!texture.empty())
+            fits &= appendUnique(merged.textures, texture);
+    }
+    for (lvk::BufferHandle buffer : b.buffers)
+    {
+        if (!buffer.empty())
+            fits &= appendUnique(merged.buffers, buffer);
+    }
+
+    if (!fits)
+        KHOLST_LOGW("Too many dependencies for one command, some barriers are missing\n");
+    return merged;
+}
+
+RenderGraph::~RenderGraph()
+{
+    clear();
+}
+
+void RenderGraph::initialize(lvk::IContext* context)
+{
+    clear();
+    ctx = context;
+}
+
+void RenderGraph::reset(std::pmr::memory_resource* memory)
+{
+    frameMemory = memory ? memory : std::pmr::get_default_resource();
+    resources.clear();
+    passes.clear();
+    compiled = false;
+    stats = {};
+}
+
+RenderGraph::ResourceId RenderGraph::importTexture(const char* name, lvk::TextureHandle texture)
+{
+    resources.push_back({ .name = name, .type = ResourceType::ImportedTexture, .texture = texture });
+    return (ResourceId)resources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(const char* name, lvk::BufferHandle buffer)
+{
+    resources.push_back({ .name = name, .type = ResourceType::ImportedBuffer, .buffer = buffer });
+    return (ResourceId)resources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::createTexture(const char* name, const TransientTextureDesc& desc)
+{
+    resources.push_back({ .name = name, .type = ResourceType::TransientTexture, .desc = desc });
+    return (ResourceId)resources.size() - 1;
+}
+
+RenderGraph::PassId RenderGraph::addPass(PassDesc pass)
+{
+    compiled = false;
+    passes.push_back({ .desc = std::move(pass) });
+    return (PassId)passes.size() - 1;
+}
+
+bool RenderGraph::compile(std::string& outErrorMsg)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    compiled = false;
+    stats = { .passCount = (uint32_t)passes.size() };
+
+    for (const PassState& pass : passes)
+    {
+        for (const std::vector<ResourceId>* ids : { &pass.desc.reads, &pass.desc.writes })
+        {
+            for (ResourceId id : *ids)
+            {
+                if (id >= resources.size())
+                {
+                    outErrorMsg = std::string("Pass '") + pass.desc.name + "' uses unknown resource " + std::to_string(id);
+                    return false;
+                }
+            }
+        }
+    }
+
+    cullPasses();
+    if (!assignTransients(outErrorMsg) || !placeBarriers(outErrorMsg))
+        return false;
+
+    compiled = true;
+    return true;
+}
+
+// Walk backwards from the passes that must run, keeping whatever produces
+// a resource a kept pass reads
+void RenderGraph::cullPasses()
+{
+    std::pmr::vector<bool> needed(resources.size(), false, frameMemory);
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        PassState& pass = passes[i];
+
+        bool keep = pass.desc.sideEffects;
+        for (ResourceId id : pass.desc.writes)
+            keep |= needed[id] || resources[id].type != ResourceType::TransientTexture;
+
+        pass.culled = !keep;
+        if (pass.culled)
+        {
+            stats.culledPasses++;
+            continue;
+        }
+
+        for (ResourceId id : pass.desc.reads)
+            needed[id] = true;
+    }
+}
+
+bool RenderGraph::sameTexture(const TransientTextureDesc& a, const TransientTextureDesc& b)
+{
+    return a.format == b.format && a.usage == b.usage &&
+           a.dimensions.width == b.dimensions.width &&
+           a.dimensions.height == b.dimensions.height &&
+           a.dimensions.depth == b.dimensions.depth;
+}
+
+bool RenderGraph::assignTransients(std::string& outErrorMsg)
+{
+    for (Resource& resource : resources)
+    {
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+        resource.physical = -1;
+    }
+
+    for (size_t i = 0; i < passes.size(); i++)
+    {
+        if (passes[i].culled)
+            continue;
+        for (const std::vector<ResourceId>* ids : { &passes[i].desc.reads, &passes[i].desc.writes })
+        {
+            for (ResourceId id : *ids)
+            {
+                Resource& resource = resources[id];
+                if (resource.firstPass < 0)
+                    resource.firstPass = (int32_t)i;
+                resource.lastPass = (int32_t)i;
+            }
+        }
+    }
+
+    for (PooledTexture& pooled : transientPool)
+        pooled.busyUntilPass = -1;
+
+    // Earliest first, so a texture becomes free for the transients that start after it ends
+    std::pmr::vector<ResourceId> transients(frameMemory);
+    for (ResourceId id = 0; id < resources.size(); id++)
+    {
+        if (resources[id].type == ResourceType::TransientTexture && resources[id].firstPass >= 0)
+            transients.push_back(id);
+    }
+    std::stable_sort(transients.begin(), transients.end(), [this](ResourceId a, ResourceId b)
+    {
+        return resources[a].firstPass < resources[b].firstPass;
+    });
+
+    std::pmr::vector<bool> usedThisFrame(transientPool.size(), false, frameMemory);
+    for (ResourceId id : transients)
+    {
+        Resource& resource = resources[id];
+
+        for (size_t i = 0; i < transientPool.size() && resource.physical < 0; i++)
+        {
+            if (transientPool[i].busyUntilPass < resource.firstPass && sameTexture(transientPool[i].desc, resource.desc))
+                resource.physical = (int32_t)i;
+        }
+
+        if (resource.physical < 0)
+        {
+            lvk::Result res;
+            lvk::Holder<lvk::TextureHandle> texture = ctx->createTexture({
+                .type = lvk::TextureType_2D,
+                .format = resource.desc.format,
+                .dimensions = resource.desc.dimensions,
+                .usage = resource.desc.usage,
+                .debugName = resource.name,
+            }, resource.name, &res);
+
+            if (!res.isOk())
+            {
+                outErrorMsg = std::string("Failed to create transient texture '") + resource.name + "': " + (res.message ? res.message : "");
+                return false;
+            }
+
+            transientPool.push_back({ .desc = resource.desc, .texture = std::move(texture) });
+            usedThisFrame.push_back(false);
+            resource.physical = (int32_t)transientPool.size() - 1;
+        }
+
+        PooledTexture& pooled = transientPool[resource.physical];
+        pooled.busyUntilPass = resource.lastPass;
+        pooled.unusedFrames = 0;
+        resource.texture = pooled.texture;
+        usedThisFrame[resource.physical] = true;
+    }
+
+    stats.transientTextures = (uint32_t)transients.size();
+    stats.physicalTextures = (uint32_t)std::count(usedThisFrame.begin(), usedThisFrame.end(), true);
+
+    // Submitted frames may still use a released texture, LVK defers the destruction
+    for (size_t i = transientPool.size(); i-- > 0;)
+    {
+        if (usedThisFrame[i] || ++transientPool[i].unusedFrames < TRANSIENT_RELEASE_FRAMES)
+            continue;
+
+        transientPool.erase(transientPool.begin() + i);
+        for (Resource& resource : resources)
+        {
+            if (resource.physical > (int32_t)i)
+                resource.physical--;
+        }
+    }
+
+    return true;
+}
+
+// Runs after assignTransients(), so every resource has its handle
+bool RenderGraph::placeBarriers(std::string& outErrorMsg)
+{
+    // Whether the last kept access to a resource so far was a write
+    std::pmr::vector<bool> written(resources.size(), false, frameMemory);
+
+    for (PassState& pass : passes)
+    {
+        pass.dependencies = {};
+        pass.dependencyCount = 0;
+        if (pass.culled)
+            continue;
+
+        for (ResourceId id : pass.desc.reads)
+        {
+            if (!written[id])
+                continue;
+
+            const Resource& resource = resources[id];
+            const bool fits = resource.type == ResourceType::ImportedBuffer ?
+                appendUnique(pass.dependencies.buffers, resource.buffer) :
+                appendUnique(pass.dependencies.textures, resource.texture);
+            if (!fits)
+            {
+                outErrorMsg = std::string("Pass '") + pass.desc.name + "' reads more resources written this frame than LVK can barrier on at once";
+                return false;
+            }
+        }
+
+        for (ResourceId id : pass.desc.reads)
+            written[id] = false;
+        for (ResourceId id : pass.desc.writes)
+            written[id] = true;
+
+        for (lvk::TextureHandle texture : pass.dependencies.textures)
+            pass.dependencyCount += !texture.empty();
+        for (lvk::BufferHandle buffer : pass.dependencies.buffers)
+            pass.dependencyCount += !buffer.empty();
+        stats.barrierResources += pass.dependencyCount;
+    }
+
+    return true;
+}
+
+bool RenderGraph::execute(lvk::ICommandBuffer& buf, PassExecutor& executor)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    if (!compiled)
+    {
+        KHOLST_LOGW("Render graph executed without a successful compile()\n");
+        return false;
+    }
+
+    for (const PassState& pass : passes)
+    {
+        if (pass.culled)
+            continue;
+
+        PassExecutor::Pass executorPass = {
+            .name = pass.desc.name,
+            .itemCount = pass.desc.itemCount,
+            .itemsPerTask = pass.desc.itemsPerTask,
+            .record = pass.desc.record,
+            .end = pass.desc.end,
+        };
+        if (pass.desc.begin)
+        {
+            executorPass.begin = [&pass](lvk::ICommandBuffer& passBuf)
+            {
+                pass.desc.begin(passBuf, pass.dependencies);
+            };
+        }
+        executor.addPass(std::move(executorPass));
+    }
+
+    return executor.execute(buf);
+}
+
+lvk::TextureHandle RenderGraph::getTexture(ResourceId id) const
+{
+    return id < resources.size() ? resources[id].texture : lvk::TextureHandle();
+}
+
+lvk::BufferHandle RenderGraph::getBuffer(ResourceId id) const
+{
+    return id < resources.size() ? resources[id].buffer : lvk::BufferHandle();
+}
+
+std::string RenderGraph::dump() const
+{
+    std::string text;
+    char line[256];
+
+    std::snprintf(line, sizeof(line), "Render graph%s: %u passes, %u culled, %u transient textures on %u pooled, %u barrier resources\n",
+        compiled ? "" : " (not compiled)", stats.passCount, stats.culledPasses, stats.transientTextures, stats.physicalTextures, stats.barrierResources);
+    text += line;
+
+    auto appendResources = [&](const char* label, const std::vector<ResourceId>& ids)
+    {
+        if (ids.empty())
+            return;
+        text += "    ";
+        text += label;
+        for (ResourceId id : ids)
+        {
+            text += ' ';
+            text += resources[id].name;
+        }
+        text += '\n';
+    };
+
+    for (size_t i = 0; i < passes.size(); i++)
+    {
+        const PassState& pass = passes[i];
+        std::snprintf(line, sizeof(line), "  #%zu %s%s\n", i, pass.desc.name, pass.culled ? " (culled)" : "");
+        text += line;
+        appendResources("reads", pass.desc.reads);
+        appendResources("writes", pass.desc.writes);
+        if (pass.dependencyCount)
+        {
+            std::snprintf(line, sizeof(line), "    barrier on %u resources\n", pass.dependencyCount);
+            text += line;
+        }
+    }
+
+    for (const Resource& resource : resources)
+    {
+        if (resource.type != ResourceType::TransientTexture)
+            continue;
+        if (resource.physical < 0)
+            std::snprintf(line, sizeof(line), "  transient %s: unused\n", resource.name);
+        else
+            std::snprintf(line, sizeof(line), "  transient %s: %ux%u, passes #%d-#%d, pooled texture %d\n", resource.name,
+                resource.desc.dimensions.width, resource.desc.dimensions.height, resource.firstPass, resource.lastPass, resource.physical);
+        text += line;
+    }
+
+    return text;
+}
+
+void RenderGraph::clear()
+{
+    reset(nullptr);
+    transientPool.clear();
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include <lvk/LVK.h>
+
+#include "render/graph/command_list.h"
+#include "render/graph/pass_executor.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Declarative description of a frame's passes and the resources between them
+ *
+ * Each frame the renderer declares its passes with the resources they read
+ * and write, then compiles and executes the graph:
+ *
+ * - Passes whose outputs nobody needs are culled. Passes with side effects
+ *   and passes writing an imported resource (swapchain image, persistent
+ *   buffers) are always kept, together with everything they depend on.
+ * - Each kept pass gets one lvk::Dependencies covering every resource it
+ *   reads that an earlier pass wrote this frame, so LVK emits a single
+ *   batched barrier at the pass boundary. Reads of imported resources that
+ *   nothing wrote this frame need none.
+ * - Transient textures live only within the frame. Those whose lifetimes
+ *   over the kept passes do not overlap and that share format, size and
+ *   usage are backed by the same pooled texture. The pool is kept across
+ *   frames, entries unused for a few frames are released.
+ *
+ * LVK allocates every texture on its own, so transients are aliased at
+ * texture granularity rather than onto shared memory ranges.
+ *
+ * Execution goes through a PassExecutor: begin() and end() run on the
+ * render thread in pass order, record() on its workers.
+ *
+ * Thread-safety: not thread-safe, use from the render thread. getTexture()
+ * and getBuffer() may be called from record() callbacks.
+ */
+class RenderGraph
+{
+public:
+    using ResourceId = uint32_t;
+    using PassId = uint32_t;
+
+    struct TransientTextureDesc
+    {
+        lvk::Format format = lvk::Format_Invalid;
+        lvk::Dimensions dimensions = {};
+        uint8_t usage = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled;
+    };
+
+    struct PassDesc
+    {
+        const char* name = "";
+        std::vector<ResourceId> reads;
+        std::vector<ResourceId> writes;
+        bool sideEffects = false; // Never culled, e.g. readbacks or state for the next frame
+
+        // As in PassExecutor::Pass
+        uint32_t itemCount = 0;
+        uint32_t itemsPerTask = 256;
+
+        // Render thread; dependencies lists the resources to barrier on before this pass
+        std::function<void(lvk::ICommandBuffer& buf, const lvk::Dependencies& dependencies)> begin;
+        // Worker thread
+        std::function<void(CommandList& list, uint32_t firstItem, uint32_t itemCount)> record;
+        // Render thread
+        std::function<void(lvk::ICommandBuffer& buf)> end;
+    };
+
+    struct Stats
+    {
+        uint32_t passCount = 0;
+        uint32_t culledPasses = 0;
+        uint32_t transientTextures = 0;
+        uint32_t physicalTextures = 0; // Pooled textures backing this frame's transients
+        uint32_t barrierResources = 0; // Dependencies over every kept pass
+    };
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // Context to allocate transient textures from, must outlive the graph
+    void initialize(lvk::IContext* ctx);
+
+    /**
+     * @brief Start declaring a new frame, the transient pool is kept
+     *
+     * @param frameMemory Scratch memory for compile(), e.g. the frame's
+     *                    core::FrameArena; the default resource if null
+     */
+    void reset(std::pmr::memory_resource* frameMemory = nullptr);
+
+    ResourceId importTexture(const char* name, lvk::TextureHandle texture);
+    ResourceId importBuffer(const char* name, lvk::BufferHandle buffer);
+    ResourceId createTexture(const char* name, const TransientTextureDesc& desc);
+
+    PassId addPass(PassDesc pass);
+
+    /**
+     * @brief Cull passes, place barriers and assign transient textures
+     *
+     * @param outErrorMsg Error description on failure
+     * @return true if the graph can be executed
+     */
+    bool compile(std::string& outErrorMsg);
+
+    /**
+     * @brief Run the kept passes in declaration order
+     *
+     * @param buf Command buffer of the frame
+     * @param executor Records the passes' command lists
+     * @return false if the graph was not compiled or execution failed
+     */
+    bool execute(lvk::ICommandBuffer& buf, PassExecutor& executor);
+
+    // Handle a resource resolves to, valid after compile()
+    lvk::TextureHandle getTexture(ResourceId id) const;
+    lvk::BufferHandle getBuffer(ResourceId id) const;
+
+    // Compiled schedule: kept and culled passes, barriers and transient lifetimes
+    std::string dump() const;
+
+    Stats getStats() const { return stats; }
+
+    // Release the transient pool
+    void clear();
+
+private:
+    // Pooled textures unused for this many compiles are released
+    static constexpr uint32_t TRANSIENT_RELEASE_FRAMES = 8;
+
+    enum class ResourceType
+    {
+        ImportedTexture,
+        ImportedBuffer,
+        TransientTexture,
+    };
+
+    struct Resource
+    {
+        const char* name = "";
+        ResourceType type = ResourceType::ImportedTexture;
+        lvk::TextureHandle texture;
+        lvk::BufferHandle buffer;
+        TransientTextureDesc desc;
+
+        // Filled by compile()
+        int32_t firstPass = -1;
+        int32_t lastPass = -1;
+        int32_t physical = -1; // Into transientPool
+    };
+
+    struct PassState
+    {
+        PassDesc desc;
+
+        // Filled by compile()
+        bool culled = false;
+        lvk::Dependencies dependencies = {};
+        uint32_t dependencyCount = 0;
+    };
+
+    struct PooledTexture
+    {
+        TransientTextureDesc desc;
+        lvk::Holder<lvk::TextureHandle> texture;
+        int32_t busyUntilPass = -1; // Last pass of the transient currently assigned this frame
+        uint32_t unusedFrames = 0;
+    };
+
+    lvk::IContext* ctx = nullptr;
+    std::pmr::memory_resource* frameMemory = std::pmr::get_default_resource();
+    std::vector<Resource> resources;
+    std::vector<PassState> passes;
+    std::vector<PooledTexture> transientPool;
+    bool compiled = false;
+    Stats stats;
+
+    void cullPasses();
+    bool placeBarriers(std::string& outErrorMsg);
+    bool assignTransients(std::string& outErrorMsg);
+    static bool sameTexture(const TransientTextureDesc& a, const TransientTextureDesc& b);
+};
+
+/**
+ * @brief Combine the resources of two dependency lists for one LVK command
+ *
+ * Duplicates are dropped. Entries that do not fit are dropped with a warning.
+ */
+lvk::Dependencies mergeDependencies(const lvk::Dependencies& a, const lvk::Dependencies& b);
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,79 @@
+#include "instance_batch.h"
+
+namespace kholst
+{
+namespace render
+{
+
+bool InstanceBatch::initialize(
+    lvk::IContext* ctx,
+    const std::vector<InstanceData>& instances,
+    const MeshHandle& mesh,
+    std::string& outErrorMsg
+)
+{
+    instanceBuffer = {};
+    indirectBuffer = {};
+    instancesAddress = 0;
+    drawArgsAddress = 0;
+    instanceCount = 0;
+
+    if (instances.empty() || !mesh.valid())
+    {
+        outErrorMsg = "Instance batch needs at least one instance and a mesh";
+        return false;
+    }
+
+    lvk::Result res;
+    instanceBuffer = ctx->createBuffer({
+        .usage = lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = instances.size() * sizeof(InstanceData),
+        .data = instances.data(),
+        .debugName = "Buffer: instances",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create instance buffer: ") + (res.message ? res.message : "");
+        instanceBuffer = {};
+        return false;
+    }
+
+    const DrawIndexedIndirectCommand command = {
+        .indexCount = mesh.indexCount,
+        .instanceCount = (uint32_t)instances.size(),
+        .firstIndex = mesh.firstIndex,
+        .vertexOffset = mesh.vertexOffset,
+    };
+
+    indirectBuffer = ctx->createBuffer({
+        .usage = lvk::BufferUsageBits_Indirect | lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = sizeof(command),
+        .data = &command,
+        .debugName = "Buffer: instance draw arguments",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create indirect buffer: ") + (res.message ? res.message : "");
+        instanceBuffer = {};
+        indirectBuffer = {};
+        return false;
+    }
+
+    instancesAddress = ctx->gpuAddress(instanceBuffer);
+    drawArgsAddress = ctx->gpuAddress(indirectBuffer);
+    instanceCount = (uint32_t)instances.size();
+    return true;
+}
+
+void InstanceBatch::draw(CommandList& list) const
+{
+    if (!instanceCount)
+        return;
+
+    list.cmdDrawIndexedIndirect(indirectBuffer, 0, 1);
+}
+
+} // namespace render
+} // namespace kholst
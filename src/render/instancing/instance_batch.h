@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <lvk/LVK.h>
+
+#include "render/graph/command_list.h"
+#include "render/mesh/mesh_buffers.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+// Per-instance data read by the vertex shader through SV_InstanceID.
+// Layout must match InstanceData in the shaders.
+struct InstanceData
+{
+    glm::vec4 positionScale = { 0.0f, 0.0f, 0.0f, 1.0f }; // xyz position, w uniform scale
+    glm::vec4 rotation = { 0.0f, 1.0f, 0.0f, 0.0f }; // xyz axis, w angular speed in radians per second
+};
+
+// Matches VkDrawIndexedIndirectCommand
+struct DrawIndexedIndirectCommand
+{
+    uint32_t indexCount = 0;
+    uint32_t instanceCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t firstInstance = 0;
+};
+
+/**
+ * @brief Many instances of one indexed mesh drawn with a single indirect draw
+ *
+ * Instances live in a device-local storage buffer the shader addresses
+ * through a pointer in push constants. The draw arguments live in an
+ * indirect buffer so a compute pass can later cull or append instances
+ * without a CPU round trip.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class InstanceBatch
+{
+public:
+    /**
+     * @brief Upload instances and the draw arguments
+     *
+     * @param ctx Context to allocate from, must outlive the batch
+     * @param instances Instances to draw
+     * @param mesh Mesh every instance draws, from the bound MeshBuffers
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(
+        lvk::IContext* ctx,
+        const std::vector<InstanceData>& instances,
+        const MeshHandle& mesh,
+        std::string& outErrorMsg
+    );
+
+    // Issue the draw, expects the pipeline, mesh buffers and push constants to be bound
+    void draw(CommandList& list) const;
+
+    // Device address of the instance array, for push constants
+    uint64_t getInstancesAddress() const { return instancesAddress; }
+    // Device address of the DrawIndexedIndirectCommand, for shaders that read the instance count
+    uint64_t getDrawArgsAddress() const { return drawArgsAddress; }
+    uint32_t getInstanceCount() const { return instanceCount; }
+
+private:
+    lvk::Holder<lvk::BufferHandle> instanceBuffer;
+    lvk::Holder<lvk::BufferHandle> indirectBuffer;
+    uint64_t instancesAddress = 0;
+    uint64_t drawArgsAddress = 0;
+    uint32_t instanceCount = 0;
+};
+
+} // namespace render
+} // namespace kholst
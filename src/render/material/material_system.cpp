@@ -0,0 +1,185 @@
+#include "material_system.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/async_log.h"
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+MaterialSystem::~MaterialSystem()
+{
+    clear();
+}
+
+bool MaterialSystem::initialize(
+    lvk::IContext* context,
+    const shader::ReflectedStruct& materialLayout,
+    uint32_t materialCapacity,
+    std::string& outErrorMsg
+)
+{
+    clear();
+
+    const uint32_t materialStride = materialLayout.stride ? materialLayout.stride : materialLayout.size;
+    if (!materialStride || !materialCapacity)
+    {
+        outErrorMsg = "Material struct '" + materialLayout.name + "' has no size or the capacity is zero";
+        return false;
+    }
+
+    constants.assign((size_t)materialStride * materialCapacity, 0);
+
+    lvk::Result res;
+    buffer = context->createBuffer({
+        .usage = lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = constants.size(),
+        .data = constants.data(),
+        .debugName = "Buffer: materials",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create material buffer: ") + (res.message ? res.message : "");
+        clear();
+        return false;
+    }
+
+    ctx = context;
+    layout = materialLayout;
+    stride = materialStride;
+    capacity = materialCapacity;
+    bufferAddress = ctx->gpuAddress(buffer);
+    return true;
+}
+
+MaterialSystem::MaterialId MaterialSystem::create()
+{
+    if (!ctx || materialCount == capacity)
+        return INVALID_MATERIAL;
+    return materialCount++;
+}
+
+bool MaterialSystem::write(MaterialId material, const std::string& fieldName, const void* data, uint32_t size)
+{
+    if (material >= materialCount)
+        return false;
+
+    auto field = std::find_if(layout.fields.begin(), layout.fields.end(),
+        [&](const shader::ReflectedField& f) { return f.name == fieldName; });
+    if (field == layout.fields.end() || field->size != size)
+        return false;
+
+    const size_t offset = (size_t)material * stride + field->offset;
+    std::memcpy(constants.data() + offset, data, size);
+
+    if (dirtyBegin == dirtyEnd)
+    {
+        dirtyBegin = offset;
+        dirtyEnd = offset + size;
+    }
+    else
+    {
+        dirtyBegin = std::min(dirtyBegin, offset);
+        dirtyEnd = std::max(dirtyEnd, offset + size);
+    }
+    return true;
+}
+
+bool MaterialSystem::setFloat(MaterialId material, const std::string& field, float value)
+{
+    return write(material, field, &value, sizeof(value));
+}
+
+bool MaterialSystem::setUint(MaterialId material, const std::string& field, uint32_t value)
+{
+    return write(material, field, &value, sizeof(value));
+}
+
+bool MaterialSystem::setVec4(MaterialId material, const std::string& field, const glm::vec4& value)
+{
+    return write(material, field, &value, sizeof(value));
+}
+
+bool MaterialSystem::setTexture(MaterialId material, const std::string& field, lvk::TextureHandle texture)
+{
+    return setUint(material, field, texture.index());
+}
+
+bool MaterialSystem::setSampler(MaterialId material, const std::string& field, lvk::SamplerHandle sampler)
+{
+    return setUint(material, field, sampler.index());
+}
+
+bool MaterialSystem::setBuffer(MaterialId material, const std::string& field, lvk::BufferHandle target)
+{
+    const uint64_t address = target.empty() ? 0 : ctx->gpuAddress(target);
+    return write(material, field, &address, sizeof(address));
+}
+
+// Materials change rarely and in bursts, one upload of the touched range is enough
+void MaterialSystem::flush()
+{
+    if (dirtyBegin == dirtyEnd)
+        return;
+
+    KHOLST_PROFILER_FUNCTION();
+
+    const size_t size = dirtyEnd - dirtyBegin;
+    const lvk::Result res = ctx->upload(buffer, constants.data() + dirtyBegin, size, dirtyBegin);
+    if (!res.isOk())
+        KHOLST_LOGW("Failed to upload materials: %s\n", res.message ? res.message : "");
+    else
+        uploadedBytes += size;
+
+    dirtyBegin = 0;
+    dirtyEnd = 0;
+}
+
+bool MaterialSystem::matchesLayout(const shader::ReflectedStruct& other) const
+{
+    if (other.name != layout.name || other.size != layout.size || other.stride != layout.stride ||
+        other.fields.size() != layout.fields.size())
+        return false;
+
+    for (size_t i = 0; i < layout.fields.size(); i++)
+    {
+        const shader::ReflectedField& a = layout.fields[i];
+        const shader::ReflectedField& b = other.fields[i];
+        if (a.name != b.name || a.offset != b.offset || a.size != b.size)
+            return false;
+    }
+    return true;
+}
+
+MaterialSystem::Stats MaterialSystem::getStats() const
+{
+    return {
+        .materialCount = materialCount,
+        .capacity = capacity,
+        .stride = stride,
+        .uploadedBytes = uploadedBytes,
+    };
+}
+
+void MaterialSystem::clear()
+{
+    buffer = {};
+    bufferAddress = 0;
+    constants.clear();
+    layout = {};
+    stride = 0;
+    capacity = 0;
+    materialCount = 0;
+    dirtyBegin = 0;
+    dirtyEnd = 0;
+    uploadedBytes = 0;
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
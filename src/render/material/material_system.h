@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <lvk/LVK.h>
+
+#include "render/shader/reflection/shader_reflection.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Material constants of every material in one storage buffer, laid out by Slang reflection
+ *
+ * The shader declares its material as a plain struct it reads through a
+ * pointer in push constants; the struct's layout comes from
+ * ShaderReflection::bufferStructs, so fields are written by name and the
+ * CPU side never mirrors the struct by hand. Textures and samplers are
+ * stored as their bindless indices into LVK's global descriptor arrays,
+ * buffers as device addresses.
+ *
+ * A draw then only pushes the buffer address and a material index:
+ * switching materials rebinds no pipeline and no descriptor set.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class MaterialSystem
+{
+public:
+    using MaterialId = uint32_t;
+    static constexpr MaterialId INVALID_MATERIAL = ~0u;
+
+    struct Stats
+    {
+        uint32_t materialCount = 0;
+        uint32_t capacity = 0;
+        uint32_t stride = 0; // Bytes per material
+        size_t uploadedBytes = 0; // Over every flush()
+    };
+
+    MaterialSystem() = default;
+    ~MaterialSystem();
+
+    MaterialSystem(const MaterialSystem&) = delete;
+    MaterialSystem& operator=(const MaterialSystem&) = delete;
+
+    /**
+     * @brief Create the material buffer
+     *
+     * @param ctx Context to allocate from, must outlive the material system
+     * @param layout Reflected material struct
+     * @param capacity Maximum number of materials
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(lvk::IContext* ctx, const shader::ReflectedStruct& layout, uint32_t capacity, std::string& outErrorMsg);
+
+    // New material with every field zero, INVALID_MATERIAL when full
+    MaterialId create();
+
+    // Field writes, false if the material or the field does not exist or its size differs
+    bool setFloat(MaterialId material, const std::string& field, float value);
+    bool setUint(MaterialId material, const std::string& field, uint32_t value);
+    bool setVec4(MaterialId material, const std::string& field, const glm::vec4& value);
+
+    // Bindless index into LVK's descriptor arrays, the field is a uint
+    bool setTexture(MaterialId material, const std::string& field, lvk::TextureHandle texture);
+    bool setSampler(MaterialId material, const std::string& field, lvk::SamplerHandle sampler);
+
+    // Device address, the field is a pointer
+    bool setBuffer(MaterialId material, const std::string& field, lvk::BufferHandle buffer);
+
+    // Upload every field written since the last flush(), call before recording draws
+    void flush();
+
+    // Device address of material 0, materials follow at getStats().stride
+    uint64_t getBufferAddress() const { return bufferAddress; }
+    lvk::BufferHandle getBuffer() const { return buffer; }
+
+    const shader::ReflectedStruct& getLayout() const { return layout; }
+
+    // True if a reflected struct has the layout materials were written with, e.g. after a reload
+    bool matchesLayout(const shader::ReflectedStruct& other) const;
+
+    Stats getStats() const;
+
+    void clear();
+
+private:
+    lvk::IContext* ctx = nullptr;
+    shader::ReflectedStruct layout;
+    uint32_t stride = 0;
+    uint32_t capacity = 0;
+    uint32_t materialCount = 0;
+
+    lvk::Holder<lvk::BufferHandle> buffer;
+    uint64_t bufferAddress = 0;
+    std::vector<uint8_t> constants; // CPU copy of the whole buffer
+
+    // Byte range written since the last flush()
+    size_t dirtyBegin = 0;
+    size_t dirtyEnd = 0;
+    size_t uploadedBytes = 0;
+
+    bool write(MaterialId material, const std::string& field, const void* data, uint32_t size);
+};
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,151 @@
+#include "mesh_buffers.h"
+
+namespace kholst
+{
+namespace render
+{
+
+bool MeshBuffers::initialize(
+    lvk::IContext* context,
+    uint32_t stride,
+    uint32_t maxVertices,
+    uint32_t maxIndices,
+    std::string& outErrorMsg
+)
+{
+    clear();
+
+    if (!stride || !maxVertices || !maxIndices)
+    {
+        outErrorMsg = "Mesh buffers need a vertex stride and non-zero capacities";
+        return false;
+    }
+
+    lvk::Result res;
+    vertexBuffer = context->createBuffer({
+        .usage = lvk::BufferUsageBits_Vertex | lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = (size_t)stride * maxVertices,
+        .debugName = "Buffer: mesh vertices",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create mesh vertex buffer: ") + (res.message ? res.message : "");
+        vertexBuffer = {};
+        return false;
+    }
+
+    indexBuffer = context->createBuffer({
+        .usage = lvk::BufferUsageBits_Index | lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = sizeof(uint32_t) * (size_t)maxIndices,
+        .debugName = "Buffer: mesh indices",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create mesh index buffer: ") + (res.message ? res.message : "");
+        vertexBuffer = {};
+        indexBuffer = {};
+        return false;
+    }
+
+    ctx = context;
+    vertexStride = stride;
+    vertexAllocator.reset(maxVertices);
+    indexAllocator.reset(maxIndices);
+    return true;
+}
+
+bool MeshBuffers::addMesh(
+    const void* vertices,
+    uint32_t vertexCount,
+    const uint32_t* indices,
+    uint32_t indexCount,
+    MeshHandle& outMesh,
+    std::string& outErrorMsg
+)
+{
+    outMesh = {};
+
+    if (!ctx)
+    {
+        outErrorMsg = "Mesh buffers are not initialized";
+        return false;
+    }
+
+    if (!vertexCount || !indexCount)
+    {
+        outErrorMsg = "Mesh has no vertices or indices";
+        return false;
+    }
+
+    const uint64_t vertexOffset = vertexAllocator.allocate(vertexCount);
+    if (vertexOffset == core::RangeAllocator::INVALID_OFFSET)
+    {
+        outErrorMsg = "Out of mesh vertex space";
+        return false;
+    }
+
+    const uint64_t firstIndex = indexAllocator.allocate(indexCount);
+    if (firstIndex == core::RangeAllocator::INVALID_OFFSET)
+    {
+        vertexAllocator.free(vertexOffset);
+        outErrorMsg = "Out of mesh index space";
+        return false;
+    }
+
+    ctx->upload(vertexBuffer, vertices, (size_t)vertexCount * vertexStride, vertexOffset * vertexStride);
+    ctx->upload(indexBuffer, indices, sizeof(uint32_t) * (size_t)indexCount, firstIndex * sizeof(uint32_t));
+
+    outMesh = {
+        .firstIndex = (uint32_t)firstIndex,
+        .indexCount = indexCount,
+        .vertexOffset = (int32_t)vertexOffset,
+        .vertexCount = vertexCount,
+    };
+    meshCount++;
+    return true;
+}
+
+void MeshBuffers::removeMesh(const MeshHandle& mesh)
+{
+    if (!mesh.valid())
+        return;
+
+    vertexAllocator.free((uint64_t)mesh.vertexOffset);
+    indexAllocator.free(mesh.firstIndex);
+    meshCount--;
+}
+
+void MeshBuffers::bind(lvk::ICommandBuffer& buf) const
+{
+    buf.cmdBindVertexBuffer(0, vertexBuffer);
+    buf.cmdBindIndexBuffer(indexBuffer, lvk::IndexFormat_UI32);
+}
+
+void MeshBuffers::clear()
+{
+    vertexBuffer = {};
+    indexBuffer = {};
+    vertexAllocator.reset(0);
+    indexAllocator.reset(0);
+    vertexStride = 0;
+    meshCount = 0;
+    ctx = nullptr;
+}
+
+MeshBuffers::Stats MeshBuffers::getStats() const
+{
+    const core::RangeAllocator::Stats vertexStats = vertexAllocator.getStats();
+    const core::RangeAllocator::Stats indexStats = indexAllocator.getStats();
+    return {
+        .meshCount = meshCount,
+        .usedVertices = vertexStats.used,
+        .vertexCapacity = vertexStats.capacity,
+        .usedIndices = indexStats.used,
+        .indexCapacity = indexStats.capacity,
+    };
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <lvk/LVK.h>
+
+#include "core/range_allocator.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Mesh location inside the shared vertex and index buffers
+ *
+ * firstIndex, indexCount and vertexOffset go straight into
+ * cmdDrawIndexed() or an indirect draw command.
+ */
+struct MeshHandle
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+
+    bool valid() const { return indexCount != 0; }
+};
+
+/**
+ * @brief Packs many meshes into one device-local vertex and one index buffer
+ *
+ * Both buffers are carved up by an offset allocator, in units of one
+ * vertex and one 32-bit index respectively, so every mesh can be drawn
+ * after a single bind. Uploads go through LVK's staging ring.
+ *
+ * Every mesh shares one vertex format, given by its stride at initialize().
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class MeshBuffers
+{
+public:
+    struct Stats
+    {
+        uint32_t meshCount = 0;
+        uint64_t usedVertices = 0;
+        uint64_t vertexCapacity = 0;
+        uint64_t usedIndices = 0;
+        uint64_t indexCapacity = 0;
+    };
+
+    /**
+     * @brief Create the shared buffers
+     *
+     * @param ctx Context to allocate from, must outlive the buffers
+     * @param vertexStride Size of one vertex in bytes
+     * @param maxVertices Vertex capacity across all meshes
+     * @param maxIndices Index capacity across all meshes
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(
+        lvk::IContext* ctx,
+        uint32_t vertexStride,
+        uint32_t maxVertices,
+        uint32_t maxIndices,
+        std::string& outErrorMsg
+    );
+
+    /**
+     * @brief Allocate space for a mesh and upload it
+     *
+     * @param vertices vertexCount vertices of the stride given at initialize()
+     * @param indices Indices relative to the mesh's first vertex
+     * @param outMesh Receives the location of the mesh
+     * @param outErrorMsg Error description on failure
+     * @return true if the mesh was uploaded
+     */
+    bool addMesh(
+        const void* vertices,
+        uint32_t vertexCount,
+        const uint32_t* indices,
+        uint32_t indexCount,
+        MeshHandle& outMesh,
+        std::string& outErrorMsg
+    );
+
+    /**
+     * @brief Return the space of a mesh to the allocators
+     *
+     * The caller makes sure no submitted work still draws the mesh, e.g. by
+     * waiting on the last submit that references it.
+     */
+    void removeMesh(const MeshHandle& mesh);
+
+    // Bind the shared vertex buffer to binding 0 and the index buffer
+    void bind(lvk::ICommandBuffer& buf) const;
+
+    // Release both buffers and every mesh
+    void clear();
+
+    lvk::BufferHandle getVertexBuffer() const { return vertexBuffer; }
+    lvk::BufferHandle getIndexBuffer() const { return indexBuffer; }
+    uint32_t getVertexStride() const { return vertexStride; }
+
+    Stats getStats() const;
+
+private:
+    lvk::IContext* ctx = nullptr;
+    lvk::Holder<lvk::BufferHandle> vertexBuffer;
+    lvk::Holder<lvk::BufferHandle> indexBuffer;
+    uint32_t vertexStride = 0;
+    uint32_t meshCount = 0;
+
+    core::RangeAllocator vertexAllocator;
+    core::RangeAllocator indexAllocator;
+};
+
+} // namespace render
+} // namespace kholst
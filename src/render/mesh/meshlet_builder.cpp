@@ -0,0 +1,189 @@
+#include "meshlet_builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+static constexpr uint32_t UNASSIGNED_VERTEX = ~0u;
+
+// Cones whose normals spread wider than this can never be culled, see meshoptimizer
+static constexpr float MIN_CONE_DOT = 0.1f;
+
+static glm::vec3 readPosition(const float* positions, uint32_t vertexStride, uint32_t index)
+{
+    const float* p = (const float*)((const uint8_t*)positions + (size_t)index * vertexStride);
+    return { p[0], p[1], p[2] };
+}
+
+static void computeBounds(
+    Meshlet& meshlet,
+    const MeshletData& data,
+    const float* positions,
+    uint32_t vertexStride
+)
+{
+    glm::vec3 boundsMin = glm::vec3(INFINITY);
+    glm::vec3 boundsMax = glm::vec3(-INFINITY);
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+    {
+        const glm::vec3 p = readPosition(positions, vertexStride, data.vertices[meshlet.vertexOffset + i]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+        radius = std::max(radius, glm::length(readPosition(positions, vertexStride, data.vertices[meshlet.vertexOffset + i]) - center));
+
+    meshlet.center = center;
+    meshlet.radius = radius;
+    meshlet.coneApex = center;
+    meshlet.coneAxis = glm::vec3(0.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    // Triangle normals and a corner of each, degenerate triangles face nowhere
+    glm::vec3 normals[MAX_MESHLET_TRIANGLES];
+    glm::vec3 corners[MAX_MESHLET_TRIANGLES];
+    uint32_t normalCount = 0;
+    glm::vec3 normalSum = glm::vec3(0.0f);
+    for (uint32_t i = 0; i < meshlet.triangleCount; i++)
+    {
+        const uint32_t packed = data.triangles[meshlet.triangleOffset + i];
+        glm::vec3 p[3];
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint32_t local = (packed >> (corner * 8)) & 0xff;
+            p[corner] = readPosition(positions, vertexStride, data.vertices[meshlet.vertexOffset + local]);
+        }
+
+        const glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        const float area = glm::length(normal);
+        if (area == 0.0f)
+            continue;
+
+        normals[normalCount] = normal / area;
+        corners[normalCount] = p[0];
+        normalSum += normals[normalCount];
+        normalCount++;
+    }
+
+    const float axisLength = glm::length(normalSum);
+    if (normalCount == 0 || axisLength == 0.0f)
+        return;
+
+    const glm::vec3 axis = normalSum / axisLength;
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < normalCount; i++)
+        minDot = std::min(minDot, glm::dot(normals[i], axis));
+
+    if (minDot <= MIN_CONE_DOT)
+        return;
+
+    // Move the apex back until every triangle plane passes in front of it
+    float maxT = 0.0f;
+    for (uint32_t i = 0; i < normalCount; i++)
+        maxT = std::max(maxT, glm::dot(center - corners[i], normals[i]) / glm::dot(axis, normals[i]));
+
+    meshlet.coneApex = center - axis * maxT;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+bool buildMeshlets(
+    const float* positions,
+    uint32_t vertexCount,
+    uint32_t vertexStride,
+    const uint32_t* indices,
+    uint32_t indexCount,
+    MeshletData& outData,
+    std::string& outErrorMsg
+)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    outData = {};
+    if (indexCount % 3 != 0)
+    {
+        outErrorMsg = "Meshlets need a triangle list, got " + std::to_string(indexCount) + " indices";
+        return false;
+    }
+
+    const uint32_t triangleCount = indexCount / 3;
+    outData.meshlets.reserve(triangleCount / MAX_MESHLET_TRIANGLES + 1);
+    outData.vertices.reserve(indexCount);
+    outData.triangles.reserve(triangleCount);
+
+    // Local index of each mesh vertex in the open meshlet
+    std::vector<uint32_t> localIndices(vertexCount, UNASSIGNED_VERTEX);
+    Meshlet meshlet = {};
+
+    auto closeMeshlet = [&]()
+    {
+        if (meshlet.triangleCount == 0)
+            return;
+
+        computeBounds(meshlet, outData, positions, vertexStride);
+        outData.meshlets.push_back(meshlet);
+
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            localIndices[outData.vertices[meshlet.vertexOffset + i]] = UNASSIGNED_VERTEX;
+
+        meshlet = {};
+        meshlet.vertexOffset = (uint32_t)outData.vertices.size();
+        meshlet.triangleOffset = (uint32_t)outData.triangles.size();
+    };
+
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        const uint32_t* corners = indices + triangle * 3;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            if (corners[corner] >= vertexCount)
+            {
+                outErrorMsg = "Index " + std::to_string(corners[corner]) + " is out of range of " +
+                    std::to_string(vertexCount) + " vertices";
+                outData = {};
+                return false;
+            }
+        }
+
+        uint32_t newVertices = 0;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+            if (localIndices[corners[corner]] == UNASSIGNED_VERTEX && !repeated)
+                newVertices++;
+        }
+
+        if (meshlet.vertexCount + newVertices > MAX_MESHLET_VERTICES || meshlet.triangleCount == MAX_MESHLET_TRIANGLES)
+            closeMeshlet();
+
+        uint32_t packed = 0;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t& local = localIndices[corners[corner]];
+            if (local == UNASSIGNED_VERTEX)
+            {
+                local = meshlet.vertexCount++;
+                outData.vertices.push_back(corners[corner]);
+            }
+            packed |= local << (corner * 8);
+        }
+
+        outData.triangles.push_back(packed);
+        meshlet.triangleCount++;
+    }
+
+    closeMeshlet();
+    return true;
+}
+
+} // namespace render
+} // namespace kholst
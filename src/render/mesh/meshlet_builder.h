@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+namespace kholst
+{
+namespace render
+{
+
+// Limits of one meshlet, the mesh shader's output arrays are sized by them
+static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+/**
+ * @brief A cluster of triangles drawn by one mesh shader workgroup
+ *
+ * Layout must match the Meshlet struct in cube.slang. Bounds are in mesh
+ * space, the task shader transforms them by the instance before culling.
+ *
+ * The normal cone culls the whole meshlet when the camera sees it from
+ * behind: dot(normalize(coneApex - camera), coneAxis) >= coneCutoff.
+ * A cutoff of 1 marks a cone too wide to ever cull.
+ */
+struct Meshlet
+{
+    glm::vec3 center; // Bounding sphere
+    float radius;
+    glm::vec3 coneApex;
+    float coneCutoff; // Cosine of the cone's half angle, widened by 90 degrees
+    glm::vec3 coneAxis;
+    uint32_t vertexOffset; // First entry in MeshletData::vertices
+    uint32_t triangleOffset; // First entry in MeshletData::triangles
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint32_t padding;
+};
+
+/**
+ * @brief Meshlets of one mesh, ready to be uploaded as storage buffers
+ *
+ * Meshlet vertices index the mesh's own vertices, so the vertex buffer is
+ * shared with the indexed path. Triangles pack three 8-bit indices into
+ * the meshlet's vertices per uint32_t, low byte first.
+ */
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint32_t> triangles;
+};
+
+/**
+ * @brief Split an indexed triangle list into meshlets
+ *
+ * Triangles are taken in index order and a meshlet is closed as soon as
+ * the next triangle would overflow either limit, so meshes optimized for
+ * the vertex cache give the tightest meshlets.
+ *
+ * @param positions Position of the first vertex, read as three floats
+ * @param vertexCount Vertices of the mesh
+ * @param vertexStride Bytes between two positions
+ * @param indices Triangle list indices relative to the first vertex
+ * @param indexCount Number of indices, a multiple of three
+ * @param outData Receives the meshlets, previous contents are dropped
+ * @param outErrorMsg Error description on failure
+ * @return true on success
+ */
+bool buildMeshlets(
+    const float* positions,
+    uint32_t vertexCount,
+    uint32_t vertexStride,
+    const uint32_t* indices,
+    uint32_t indexCount,
+    MeshletData& outData,
+    std::string& outErrorMsg
+);
+
+} // namespace render
+} // namespace kholst
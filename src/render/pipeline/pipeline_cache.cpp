@@ -0,0 +1,189 @@
+#include "pipeline_cache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <lvk/vulkan/VulkanClasses.h>
+
+#include "core/binary_stream.h"
+#include "core/file_utils.h"
+#include "core/hash.h"
+
+namespace kholst
+{
+namespace render
+{
+
+// Bump when the file layout changes so old files are silently ignored
+static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x434c504b; // "KPLC"
+static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+static lvk::VulkanContext* toVulkanContext(lvk::IContext* ctx)
+{
+    return static_cast<lvk::VulkanContext*>(ctx);
+}
+
+// The driver is required to reject foreign data itself, but not every driver
+// does so gracefully, so the Vulkan header is checked here as well
+static bool isCompatibleCacheData(const uint8_t* data, size_t size, const VkPhysicalDeviceProperties& props)
+{
+    VkPipelineCacheHeaderVersionOne header = {};
+    if (size < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data, sizeof(header));
+    return header.headerSize >= sizeof(header) && header.headerSize <= size &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == props.vendorID &&
+        header.deviceID == props.deviceID &&
+        std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+PipelineCache::PipelineCache(std::filesystem::path path)
+    : path(std::move(path))
+{
+}
+
+bool PipelineCache::load(lvk::IContext* ctx, std::string& outErrorMsg)
+{
+    lvk::VulkanContext* vkCtx = toVulkanContext(ctx);
+    if (!vkCtx || vkCtx->pipelineCache_ == VK_NULL_HANDLE)
+    {
+        outErrorMsg = "Context has no pipeline cache";
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        outErrorMsg = "No pipeline cache at " + path.string();
+        return false;
+    }
+    const std::vector<uint8_t> contents{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    VkPhysicalDeviceProperties props = {};
+    vkGetPhysicalDeviceProperties(vkCtx->getVkPhysicalDevice(), &props);
+
+    core::BinaryReader reader(contents.data(), contents.size());
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t vendorID = 0;
+    uint32_t deviceID = 0;
+    uint32_t driverVersion = 0;
+    uint8_t uuid[VK_UUID_SIZE] = {};
+    uint64_t dataSize = 0;
+    uint64_t dataHash = 0;
+    reader.read(magic);
+    reader.read(version);
+    reader.read(vendorID);
+    reader.read(deviceID);
+    reader.read(driverVersion);
+    reader.readBytes(uuid, sizeof(uuid));
+    reader.read(dataSize);
+    reader.read(dataHash);
+
+    if (!reader.ok() || magic != PIPELINE_CACHE_MAGIC || version != PIPELINE_CACHE_VERSION)
+    {
+        outErrorMsg = "Unrecognized pipeline cache file";
+        return false;
+    }
+
+    // A driver update can keep the UUID while changing the code it generates
+    if (vendorID != props.vendorID || deviceID != props.deviceID || driverVersion != props.driverVersion ||
+        std::memcmp(uuid, props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        outErrorMsg = "Pipeline cache was written by a different device or driver";
+        return false;
+    }
+
+    const uint8_t* data = contents.data() + (contents.size() - reader.remaining());
+    if (dataSize != reader.remaining() || core::hashBytes(data, dataSize) != dataHash ||
+        !isCompatibleCacheData(data, dataSize, props))
+    {
+        outErrorMsg = "Pipeline cache is corrupt";
+        return false;
+    }
+
+    const VkPipelineCacheCreateInfo ci = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = dataSize,
+        .pInitialData = data,
+    };
+
+    VkPipelineCache loadedCache = VK_NULL_HANDLE;
+    if (vkCreatePipelineCache(vkCtx->getVkDevice(), &ci, nullptr, &loadedCache) != VK_SUCCESS)
+    {
+        outErrorMsg = "vkCreatePipelineCache() failed";
+        return false;
+    }
+
+    // The context's cache was created before the file could be validated
+    // against the device, so the loaded data is merged into it
+    const VkResult result = vkMergePipelineCaches(vkCtx->getVkDevice(), vkCtx->pipelineCache_, 1, &loadedCache);
+    vkDestroyPipelineCache(vkCtx->getVkDevice(), loadedCache, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        outErrorMsg = "vkMergePipelineCaches() failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool PipelineCache::save(lvk::IContext* ctx, std::string& outErrorMsg)
+{
+    lvk::VulkanContext* vkCtx = toVulkanContext(ctx);
+    if (!vkCtx || vkCtx->pipelineCache_ == VK_NULL_HANDLE)
+    {
+        outErrorMsg = "Context has no pipeline cache";
+        return false;
+    }
+
+    const VkDevice device = vkCtx->getVkDevice();
+
+    // The cache can grow between the size query and the copy
+    std::vector<uint8_t> data;
+    VkResult result = VK_INCOMPLETE;
+    while (result == VK_INCOMPLETE)
+    {
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(device, vkCtx->pipelineCache_, &dataSize, nullptr) != VK_SUCCESS)
+        {
+            outErrorMsg = "vkGetPipelineCacheData() failed";
+            return false;
+        }
+
+        data.resize(dataSize);
+        result = vkGetPipelineCacheData(device, vkCtx->pipelineCache_, &dataSize, data.data());
+        data.resize(dataSize);
+    }
+
+    if (result != VK_SUCCESS || data.empty())
+    {
+        outErrorMsg = "vkGetPipelineCacheData() failed";
+        return false;
+    }
+
+    VkPhysicalDeviceProperties props = {};
+    vkGetPhysicalDeviceProperties(vkCtx->getVkPhysicalDevice(), &props);
+
+    core::BinaryWriter writer;
+    writer.write(PIPELINE_CACHE_MAGIC);
+    writer.write(PIPELINE_CACHE_VERSION);
+    writer.write(props.vendorID);
+    writer.write(props.deviceID);
+    writer.write(props.driverVersion);
+    writer.writeBytes(props.pipelineCacheUUID, VK_UUID_SIZE);
+    writer.write((uint64_t)data.size());
+    writer.write(core::hashBytes(data.data(), data.size()));
+    writer.writeBytes(data.data(), data.size());
+
+    return core::writeFileAtomic(path, writer.getBuffer(), outErrorMsg);
+}
+
+} // namespace render
+} // namespace kholst
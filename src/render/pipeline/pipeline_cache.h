@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <lvk/LVK.h>
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Persists the driver's compiled pipelines across runs
+ *
+ * The Vulkan context owns one VkPipelineCache that every pipeline is created
+ * through. load() merges the data saved by a previous run into it and save()
+ * writes its current contents back, so warm starts skip the SPIR-V to ISA
+ * compile in the driver.
+ *
+ * The file is only used if it was written by the same device, driver version
+ * and pipeline cache UUID; anything else is discarded instead of being handed
+ * to the driver.
+ *
+ * Thread-safety: not thread-safe, call while no pipelines are being created.
+ */
+class PipelineCache
+{
+public:
+    explicit PipelineCache(std::filesystem::path path);
+
+    /**
+     * @brief Merge the on-disk cache into the context's pipeline cache
+     *
+     * @param ctx Vulkan context created by lvk::createVulkanContextWithSwapchain()
+     * @param outErrorMsg Reason the file was not used
+     * @return true if cached pipelines were merged in
+     */
+    bool load(lvk::IContext* ctx, std::string& outErrorMsg);
+
+    /**
+     * @brief Write the context's pipeline cache to disk
+     *
+     * Call before the context is destroyed.
+     *
+     * @param ctx Vulkan context the pipelines were created with
+     * @param outErrorMsg Error description on failure
+     * @return true if the file was written
+     */
+    bool save(lvk::IContext* ctx, std::string& outErrorMsg);
+
+    const std::filesystem::path& getPath() const { return path; }
+
+private:
+    std::filesystem::path path;
+};
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,449 @@
+#include "pipeline_variants.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "core/async_log.h"
+#include "core/hash.h"
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+static std::vector<shader::ShaderDefine> sortedDefines(const std::vector<shader::ShaderDefine>& defines)
+{
+    std::vector<shader::ShaderDefine> sorted = defines;
+    std::sort(sorted.begin(), sorted.end(),
+        [](const shader::ShaderDefine& a, const shader::ShaderDefine& b) { return a.name < b.name; });
+    return sorted;
+}
+
+static uint64_t hashDefines(const std::vector<shader::ShaderDefine>& defines)
+{
+    core::Hasher hasher;
+    for (const shader::ShaderDefine& define : sortedDefines(defines))
+    {
+        hasher.add(define.name);
+        hasher.add(define.value);
+    }
+    return hasher.finish();
+}
+
+static uint64_t hashVariant(const PipelineVariantDesc& variant)
+{
+    std::vector<SpecConstantValue> constants = variant.specConstants;
+    std::sort(constants.begin(), constants.end(),
+        [](const SpecConstantValue& a, const SpecConstantValue& b) { return a.constantId < b.constantId; });
+
+    core::Hasher hasher;
+    hasher.add(hashDefines(variant.defines));
+    for (const SpecConstantValue& constant : constants)
+    {
+        hasher.add(constant.constantId);
+        hasher.add(constant.value);
+    }
+    hasher.add(variant.polygonMode);
+    return hasher.finish();
+}
+
+static lvk::ShaderStage toLvkStage(SlangStage stage)
+{
+    switch (stage)
+    {
+        case SLANG_STAGE_FRAGMENT: return lvk::Stage_Frag;
+        case SLANG_STAGE_GEOMETRY: return lvk::Stage_Geom;
+        case SLANG_STAGE_HULL: return lvk::Stage_Tesc;
+        case SLANG_STAGE_DOMAIN: return lvk::Stage_Tese;
+        case SLANG_STAGE_COMPUTE: return lvk::Stage_Comp;
+        case SLANG_STAGE_AMPLIFICATION: return lvk::Stage_Task;
+        case SLANG_STAGE_MESH: return lvk::Stage_Mesh;
+        default: return lvk::Stage_Vert;
+    }
+}
+
+PipelineVariantManager::PipelineVariantManager() = default;
+
+PipelineVariantManager::~PipelineVariantManager() = default;
+
+void PipelineVariantManager::initialize(
+    lvk::IContext* context,
+    const shader::SlangCompiler& prototypeCompiler,
+    const shader::ShaderCompileJob& programJob,
+    const lvk::RenderPipelineDesc& desc,
+    size_t pipelineBudget
+)
+{
+    clear();
+    ctx = context;
+    prototype = &prototypeCompiler;
+    program = programJob;
+    baseDesc = desc;
+    maxPipelines = pipelineBudget;
+}
+
+void PipelineVariantManager::clear()
+{
+    lru.clear();
+    pipelines.clear();
+    moduleSets.clear();
+    failedModuleKeys.clear();
+    compilers.clear();
+    dependencies.clear();
+}
+
+bool PipelineVariantManager::createModules(
+    const std::vector<shader::CompiledShader>& shaders,
+    ModuleSet& outModuleSet,
+    std::string& outErrorMsg
+)
+{
+    if (shaders.size() != program.entryPoints.size())
+    {
+        outErrorMsg = "Expected one shader per entry point of " + program.shaderPath;
+        return false;
+    }
+
+    outModuleSet.modules.clear();
+    outModuleSet.reflection = shaders.empty() || !shaders[0].getReflection() ? shader::ShaderReflection() : *shaders[0].getReflection();
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        const std::string debugName = "Shader Module: " + program.shaderPath + " (" + program.entryPoints[i].name + ")";
+
+        lvk::Result res;
+        outModuleSet.modules.push_back(ctx->createShaderModule({
+            shaders[i].data(),
+            shaders[i].sizeInBytes(),
+            toLvkStage(program.entryPoints[i].stage),
+            debugName.c_str()
+        }, &res));
+
+        if (!res.isOk())
+        {
+            outErrorMsg = "Failed to create " + debugName + ": " + (res.message ? res.message : "");
+            outModuleSet.modules.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<const PipelineVariantManager::ModuleSet> PipelineVariantManager::getModules(
+    uint64_t moduleKey,
+    const std::vector<shader::ShaderDefine>& defines
+)
+{
+    auto it = moduleSets.find(moduleKey);
+    if (it != moduleSets.end())
+        return it->second;
+
+    if (failedModuleKeys.contains(moduleKey))
+        return nullptr;
+
+    std::unique_ptr<shader::SlangCompiler>& compiler = compilers[moduleKey];
+    if (!compiler)
+    {
+        // Variant defines are appended to the ones the prototype was set up with
+        std::vector<shader::ShaderDefine> sessionDefines = prototype->getDefines();
+        const std::vector<shader::ShaderDefine> variantDefines = sortedDefines(defines);
+        sessionDefines.insert(sessionDefines.end(), variantDefines.begin(), variantDefines.end());
+
+        // Does not wait for a global session the prototype is still creating;
+        // a prototype without Slang serves every variant from its archive
+        compiler = std::make_unique<shader::SlangCompiler>();
+        if (!compiler->initialize(*prototype, sessionDefines))
+        {
+            KHOLST_LOGW("Failed to create variant session: %s\n", compiler->getLastDiagnostics().c_str());
+            compiler.reset();
+            failedModuleKeys.insert(moduleKey);
+            return nullptr;
+        }
+
+        if (prototype->getCache())
+            compiler->enableCache(prototype->getCache());
+        if (prototype->getArchive())
+            compiler->enableArchive(prototype->getArchive());
+    }
+
+    std::vector<shader::CompiledShader> shaders;
+    std::string errorMsg;
+    std::shared_ptr<ModuleSet> moduleSet = std::make_shared<ModuleSet>();
+    if (!compiler->compileEntryPoints(program.shaderPath, program.entryPoints, shaders, errorMsg) ||
+        !createModules(shaders, *moduleSet, errorMsg))
+    {
+        KHOLST_LOGW("Failed to build shader variant of %s: %s\n", program.shaderPath.c_str(), errorMsg.c_str());
+        failedModuleKeys.insert(moduleKey);
+        return nullptr;
+    }
+
+    for (const std::string& dependency : compiler->getLastDependencies())
+    {
+        if (std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+            dependencies.push_back(dependency);
+    }
+
+    moduleSets[moduleKey] = moduleSet;
+    return moduleSet;
+}
+
+lvk::Holder<lvk::RenderPipelineHandle> PipelineVariantManager::createPipeline(const ModuleSet& moduleSet, PipelineEntry& entry)
+{
+    lvk::RenderPipelineDesc desc = baseDesc;
+
+    for (size_t i = 0; i < program.entryPoints.size(); i++)
+    {
+        const lvk::ShaderModuleHandle module = moduleSet.modules[i];
+        switch (program.entryPoints[i].stage)
+        {
+            case SLANG_STAGE_VERTEX: desc.smVert = module; break;
+            case SLANG_STAGE_FRAGMENT: desc.smFrag = module; break;
+            case SLANG_STAGE_GEOMETRY: desc.smGeom = module; break;
+            case SLANG_STAGE_HULL: desc.smTesc = module; break;
+            case SLANG_STAGE_DOMAIN: desc.smTese = module; break;
+            case SLANG_STAGE_AMPLIFICATION: desc.smTask = module; break;
+            case SLANG_STAGE_MESH: desc.smMesh = module; break;
+            default: break;
+        }
+    }
+
+    const std::vector<SpecConstantValue>& constants = entry.variant.specConstants;
+    if (constants.size() > lvk::SpecializationConstantDesc::LVK_SPECIALIZATION_CONSTANTS_MAX)
+    {
+        KHOLST_LOGW("Too many specialization constants in a variant of %s\n", program.shaderPath.c_str());
+        return {};
+    }
+
+    entry.specData.clear();
+    desc.specInfo = {};
+    for (size_t i = 0; i < constants.size(); i++)
+    {
+        entry.specData.push_back(constants[i].value);
+        desc.specInfo.entries[i] = {
+            .constantId = constants[i].constantId,
+            .offset = (uint32_t)(i * sizeof(uint32_t)),
+            .size = sizeof(uint32_t),
+        };
+    }
+    if (!entry.specData.empty())
+    {
+        desc.specInfo.data = entry.specData.data();
+        desc.specInfo.dataSize = entry.specData.size() * sizeof(uint32_t);
+    }
+
+    desc.polygonMode = entry.variant.polygonMode;
+
+    lvk::Result res;
+    lvk::Holder<lvk::RenderPipelineHandle> pipeline = ctx->createRenderPipeline(desc, &res);
+    if (!res.isOk())
+    {
+        KHOLST_LOGW("Failed to create pipeline variant of %s: %s\n", program.shaderPath.c_str(), res.message ? res.message : "");
+        return {};
+    }
+
+    return pipeline;
+}
+
+PipelineVariantKey PipelineVariantManager::computeKey(const PipelineVariantDesc& variant)
+{
+    return { .pipeline = hashVariant(variant), .modules = hashDefines(variant.defines) };
+}
+
+PipelineVariantManager::PipelineEntry* PipelineVariantManager::findOrCreate(
+    const PipelineVariantDesc& variant,
+    const PipelineVariantKey& key,
+    bool pin
+)
+{
+    std::shared_ptr<const ModuleSet> modules = getModules(key.modules, variant.defines);
+
+    auto it = pipelines.find(key.pipeline);
+    if (it != pipelines.end())
+    {
+        PipelineEntry& entry = it->second;
+
+        if (pin && !entry.pinned)
+        {
+            lru.erase(entry.lruPosition);
+            entry.pinned = true;
+        }
+        else if (!entry.pinned)
+        {
+            lru.splice(lru.begin(), lru, entry.lruPosition);
+        }
+
+        // Modules were replaced by a reload, rebuild but keep the previous
+        // pipeline if that fails
+        if (modules && entry.modules != modules)
+        {
+            lvk::Holder<lvk::RenderPipelineHandle> pipeline = createPipeline(*modules, entry);
+            if (pipeline.valid())
+            {
+                entry.pipeline = std::move(pipeline);
+                entry.modules = modules;
+            }
+            misses++;
+        }
+        else
+        {
+            hits++;
+        }
+
+        return &entry;
+    }
+
+    misses++;
+    if (!modules)
+        return nullptr;
+
+    PipelineEntry& entry = pipelines[key.pipeline];
+    entry.variant = variant;
+    entry.modules = modules;
+    entry.pinned = pin;
+    entry.pipeline = createPipeline(*modules, entry);
+
+    if (!entry.pipeline.valid())
+    {
+        pipelines.erase(key.pipeline);
+        return nullptr;
+    }
+
+    if (!pin)
+    {
+        lru.push_front(key.pipeline);
+        entry.lruPosition = lru.begin();
+        evict();
+    }
+
+    return &entry;
+}
+
+lvk::RenderPipelineHandle PipelineVariantManager::get(const PipelineVariantDesc& variant)
+{
+    return get(variant, computeKey(variant));
+}
+
+lvk::RenderPipelineHandle PipelineVariantManager::get(const PipelineVariantDesc& variant, const PipelineVariantKey& key)
+{
+    PipelineEntry* entry = findOrCreate(variant, key, false);
+    return entry ? lvk::RenderPipelineHandle(entry->pipeline) : lvk::RenderPipelineHandle();
+}
+
+const shader::ShaderReflection* PipelineVariantManager::getReflection(const PipelineVariantDesc& variant)
+{
+    std::shared_ptr<const ModuleSet> modules = getModules(hashDefines(variant.defines), variant.defines);
+    return modules ? &modules->reflection : nullptr;
+}
+
+void PipelineVariantManager::evict()
+{
+    while (lru.size() > maxPipelines)
+    {
+        pipelines.erase(lru.back());
+        lru.pop_back();
+        evictions++;
+    }
+}
+
+size_t PipelineVariantManager::prewarm(const std::vector<PipelineVariantDesc>& variants)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    size_t failures = 0;
+    std::vector<lvk::RenderPipelineHandle> handles;
+    handles.reserve(variants.size());
+
+    for (const PipelineVariantDesc& variant : variants)
+    {
+        PipelineEntry* entry = findOrCreate(variant, computeKey(variant), true);
+        if (entry)
+            handles.push_back(entry->pipeline);
+        else
+            failures++;
+    }
+
+    warmUp(handles);
+    return failures;
+}
+
+void PipelineVariantManager::warmUp(const std::vector<lvk::RenderPipelineHandle>& handles)
+{
+    if (handles.empty())
+        return;
+
+    // Binding compiles the pipeline; the attachments only have to match the
+    // formats the pipelines were declared with
+    lvk::Holder<lvk::TextureHandle> colorTarget;
+    lvk::Holder<lvk::TextureHandle> depthTarget;
+
+    if (baseDesc.color[0].format != lvk::Format_Invalid)
+    {
+        colorTarget = ctx->createTexture({
+            .format = baseDesc.color[0].format,
+            .dimensions = { 1, 1 },
+            .usage = lvk::TextureUsageBits_Attachment,
+            .debugName = "Pipeline warm-up color",
+        });
+    }
+
+    if (baseDesc.depthFormat != lvk::Format_Invalid)
+    {
+        depthTarget = ctx->createTexture({
+            .format = baseDesc.depthFormat,
+            .dimensions = { 1, 1 },
+            .usage = lvk::TextureUsageBits_Attachment,
+            .debugName = "Pipeline warm-up depth",
+        });
+    }
+
+    lvk::ICommandBuffer& buf = ctx->acquireCommandBuffer();
+    buf.cmdBeginRendering(
+        { .color = { { .loadOp = lvk::LoadOp_DontCare } }, .depth = { .loadOp = lvk::LoadOp_DontCare } },
+        { .color = { { .texture = colorTarget } }, .depthStencil = { .texture = depthTarget } }
+    );
+    for (lvk::RenderPipelineHandle handle : handles)
+        buf.cmdBindRenderPipeline(handle);
+    buf.cmdEndRendering();
+    ctx->wait(ctx->submit(buf));
+}
+
+bool PipelineVariantManager::applyReload(const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg)
+{
+    std::shared_ptr<ModuleSet> moduleSet = std::make_shared<ModuleSet>();
+    if (!createModules(shaders, *moduleSet, outErrorMsg))
+        return false;
+
+    // Variants with defines have to see the edited sources too, drop their
+    // modules and the sessions that cached the old ones
+    const uint64_t defaultKey = hashDefines({});
+    moduleSets.clear();
+    moduleSets[defaultKey] = moduleSet;
+    failedModuleKeys.clear();
+    for (auto& [moduleKey, compiler] : compilers)
+        compiler->resetSession();
+
+    // Rebuild the hot set right away so it is warm when it is next used
+    std::vector<lvk::RenderPipelineHandle> handles;
+    for (auto& [key, entry] : pipelines)
+    {
+        if (entry.pinned)
+            handles.push_back(findOrCreate(entry.variant, { .pipeline = key, .modules = hashDefines(entry.variant.defines) }, true)->pipeline);
+    }
+    warmUp(handles);
+
+    return true;
+}
+
+PipelineVariantManager::Stats PipelineVariantManager::getStats() const
+{
+    return {
+        .hits = hits,
+        .misses = misses,
+        .evictions = evictions,
+        .residentPipelines = pipelines.size(),
+    };
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <lvk/LVK.h>
+
+#include "render/shader/compiler/compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+// 32-bit specialization constant value, bools are passed as VkBool32
+struct SpecConstantValue
+{
+    uint32_t constantId = 0;
+    uint32_t value = 0;
+};
+
+/**
+ * @brief One permutation of a program
+ *
+ * Defines select a distinct SPIR-V compile, specialization constants and
+ * the polygon mode only produce a distinct pipeline over the same modules.
+ * Order of defines and constants does not matter.
+ */
+struct PipelineVariantDesc
+{
+    std::vector<shader::ShaderDefine> defines;
+    std::vector<SpecConstantValue> specConstants;
+    lvk::PolygonMode polygonMode = lvk::PolygonMode_Fill;
+};
+
+// Hashes of a normalized PipelineVariantDesc, computed once so lookups do not sort and allocate
+struct PipelineVariantKey
+{
+    uint64_t pipeline = 0; // Defines, specialization constants and polygon mode
+    uint64_t modules = 0; // Defines only
+};
+
+/**
+ * @brief Lazily compiles and creates render pipelines for program variants
+ *
+ * Identical variant requests are deduplicated by a hash of their normalized
+ * description. Shader modules are shared by every variant with the same
+ * defines. Pipelines are kept in an LRU table bounded by maxPipelines;
+ * variants declared through prewarm() are pinned and never evicted.
+ *
+ * Evicted or replaced pipelines are destroyed through LVK's deferred
+ * destruction, so frames still in flight keep working.
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class PipelineVariantManager
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t residentPipelines = 0;
+    };
+
+    PipelineVariantManager();
+    ~PipelineVariantManager();
+
+    /**
+     * @brief Set up the manager for one program
+     *
+     * @param ctx Context to create modules and pipelines with, must outlive the manager
+     * @param prototype Initialized compiler whose global session, target and
+     *                  cache are used for variant compiles. Must outlive the manager.
+     * @param program Module and entry points every variant is built from
+     * @param baseDesc Pipeline state shared by every variant; shader modules,
+     *                 specialization info and polygon mode are overridden
+     * @param maxPipelines Upper bound of resident unpinned pipelines
+     */
+    void initialize(
+        lvk::IContext* ctx,
+        const shader::SlangCompiler& prototype,
+        const shader::ShaderCompileJob& program,
+        const lvk::RenderPipelineDesc& baseDesc,
+        size_t maxPipelines
+    );
+
+    /**
+     * @brief Get the pipeline of a variant, creating it on first use
+     *
+     * @return Pipeline handle, or an empty handle if the variant failed to build
+     */
+    lvk::RenderPipelineHandle get(const PipelineVariantDesc& variant);
+
+    // Same as above with the key computed ahead, for per-frame lookups
+    lvk::RenderPipelineHandle get(const PipelineVariantDesc& variant, const PipelineVariantKey& key);
+
+    static PipelineVariantKey computeKey(const PipelineVariantDesc& variant);
+
+    /**
+     * @brief Build and pin a hot set of variants ahead of their first use
+     *
+     * Pipelines are also bound once in a throwaway render pass, because LVK
+     * creates the Vulkan pipeline object lazily on first bind.
+     *
+     * @return Number of variants that failed to build
+     */
+    size_t prewarm(const std::vector<PipelineVariantDesc>& variants);
+
+    /**
+     * @brief Replace the modules of the default (no defines) variants
+     *
+     * Used by hot reload. Pinned pipelines are rebuilt and warmed right away,
+     * other variants are recompiled and rebuilt lazily on their next use. If
+     * rebuilding a pipeline fails the previous one keeps being returned.
+     *
+     * @param shaders One compiled shader per program entry point
+     * @param outErrorMsg Error description on failure
+     * @return true if the new modules were created and swapped in
+     */
+    bool applyReload(const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg);
+
+    /**
+     * @brief Reflection of the modules a variant is built from, building them on first use
+     *
+     * @return Reflection data valid until the next applyReload() or clear(),
+     *         or null if the modules failed to build
+     */
+    const shader::ShaderReflection* getReflection(const PipelineVariantDesc& variant);
+
+    // Destroy every module and pipeline
+    void clear();
+
+    // Files the program was compiled from, across every define set built so far
+    const std::vector<std::string>& getDependencies() const { return dependencies; }
+
+    Stats getStats() const;
+
+private:
+    struct ModuleSet
+    {
+        std::vector<lvk::Holder<lvk::ShaderModuleHandle>> modules; // In program entry point order
+        shader::ShaderReflection reflection; // Global parameters, shared by every entry point
+    };
+
+    struct PipelineEntry
+    {
+        PipelineVariantDesc variant;
+        lvk::Holder<lvk::RenderPipelineHandle> pipeline;
+        std::shared_ptr<const ModuleSet> modules; // Kept alive, LVK builds the VkPipeline lazily
+        std::vector<uint32_t> specData;
+        bool pinned = false;
+        std::list<uint64_t>::iterator lruPosition; // Only valid for unpinned entries
+    };
+
+    lvk::IContext* ctx = nullptr;
+    const shader::SlangCompiler* prototype = nullptr;
+    shader::ShaderCompileJob program;
+    lvk::RenderPipelineDesc baseDesc;
+    size_t maxPipelines = 0;
+
+    // One compiler per define set, sessions bake their defines in
+    std::unordered_map<uint64_t, std::unique_ptr<shader::SlangCompiler>> compilers;
+    std::unordered_map<uint64_t, std::shared_ptr<const ModuleSet>> moduleSets;
+    std::unordered_set<uint64_t> failedModuleKeys; // Not retried until the next reload
+    std::unordered_map<uint64_t, PipelineEntry> pipelines;
+    std::list<uint64_t> lru; // Unpinned entries, most recently used first
+    std::vector<std::string> dependencies;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    std::shared_ptr<const ModuleSet> getModules(uint64_t moduleKey, const std::vector<shader::ShaderDefine>& defines);
+    bool createModules(const std::vector<shader::CompiledShader>& shaders, ModuleSet& outModuleSet, std::string& outErrorMsg);
+    lvk::Holder<lvk::RenderPipelineHandle> createPipeline(const ModuleSet& moduleSet, PipelineEntry& entry);
+    PipelineEntry* findOrCreate(const PipelineVariantDesc& variant, const PipelineVariantKey& key, bool pin);
+    void evict();
+    void warmUp(const std::vector<lvk::RenderPipelineHandle>& handles);
+};
+
+} // namespace render
+} // namespace kholst
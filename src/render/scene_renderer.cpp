@@ -0,0 +1,583 @@
+#include "scene_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
+#include <lvk/vulkan/VulkanClasses.h>
+
+#include "core/async_log.h"
+#include "core/profiler.h"
+#include "render/debug/gpu_zone.h"
+#include "render/mesh/meshlet_builder.h"
+#include "render/shader_programs.h"
+
+namespace kholst
+{
+namespace render
+{
+
+// Material struct of cube.slang, fields are looked up by name in its reflection
+static const char* CUBE_MATERIAL_STRUCT = "CubeMaterial";
+
+static constexpr uint32_t CUBE_TRIANGLES = 36;
+
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+static const Vertex CUBE_VERTICES[] = {
+    { { -1.0f, -1.0f,  1.0f }, { 1.0f, 0.0f, 0.0f } }, { {  1.0f, -1.0f,  1.0f }, { 0.0f, 1.0f, 0.0f } },
+    { {  1.0f,  1.0f,  1.0f }, { 0.0f, 0.0f, 1.0f } }, { { -1.0f,  1.0f,  1.0f }, { 1.0f, 1.0f, 0.0f } },
+    { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 0.0f } }, { {  1.0f, -1.0f, -1.0f }, { 0.0f, 0.0f, 1.0f } },
+    { {  1.0f,  1.0f, -1.0f }, { 0.0f, 1.0f, 0.0f } }, { { -1.0f,  1.0f, -1.0f }, { 1.0f, 0.0f, 0.0f } },
+};
+
+static const uint32_t CUBE_INDICES[CUBE_TRIANGLES] = {
+    0, 1, 2, 2, 3, 0, // front
+    1, 5, 6, 6, 2, 1, // right
+    7, 6, 5, 5, 4, 7, // back
+    4, 0, 3, 3, 7, 4, // left
+    4, 5, 1, 1, 0, 4, // bottom
+    3, 2, 6, 6, 7, 3  // top
+};
+
+static const float CUBE_BOUNDING_RADIUS = std::sqrt(3.0f);
+
+// Shared geometry capacity across all meshes
+static constexpr uint32_t MAX_MESH_VERTICES = 1 << 20;
+static constexpr uint32_t MAX_MESH_INDICES = 1 << 22;
+
+// Must match the meshlet path of cube.slang
+static constexpr uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+static constexpr uint32_t MAX_TASK_GROUPS_Y = 65535;
+
+// Layout must match the shader structs in cube.slang
+struct PerFrameData
+{
+    glm::mat4 viewProj;
+    glm::vec4 cameraPosition;
+    float time;
+};
+
+struct CubePushConstants
+{
+    uint64_t perFrame;
+    uint64_t instances;
+    uint64_t visibleInstances;
+    uint64_t materials;
+    uint64_t drawArgs;
+    uint64_t vertices;
+    uint64_t meshlets;
+    uint64_t meshletVertices;
+    uint64_t meshletTriangles;
+    uint32_t materialIndex;
+    uint32_t meshletCount;
+};
+
+// cmdBeginRendering only makes buffer dependencies visible to the vertex
+// pipeline, the task shader reads the culled count and list directly
+static void barrierCullToTaskShader(lvk::ICommandBuffer& buf)
+{
+    const VkMemoryBarrier2 barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        .srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT,
+        .dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+    };
+    const VkDependencyInfo dependency = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &barrier,
+    };
+    vkCmdPipelineBarrier2(static_cast<lvk::CommandBuffer&>(buf).getVkCommandBuffer(), &dependency);
+}
+
+SceneRenderer::~SceneRenderer()
+{
+    clear();
+}
+
+bool SceneRenderer::initialize(
+    lvk::IContext* context,
+    shader::SlangCompiler& compiler,
+    const Config& rendererConfig,
+    std::string& outErrorMsg
+)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    clear();
+    ctx = context;
+    config = rendererConfig;
+
+    // render() only checks ctx, a partly built renderer must not keep it
+    if (!createScene(compiler, outErrorMsg))
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool SceneRenderer::createScene(shader::SlangCompiler& compiler, std::string& outErrorMsg)
+{
+    if (!frameRing.initialize(ctx, config.framesInFlight, config.perFrameBufferSize, outErrorMsg))
+        return false;
+
+    frameArenas.initialize(config.framesInFlight, config.frameArenaSize);
+    graph.initialize(ctx);
+    if (passExecutor.getWorkerCount() == 0 && !passExecutor.initialize(config.recordThreads, outErrorMsg))
+        return false;
+
+    if (!meshBuffers.initialize(ctx, sizeof(Vertex), MAX_MESH_VERTICES, MAX_MESH_INDICES, outErrorMsg) ||
+        !meshBuffers.addMesh(CUBE_VERTICES, (uint32_t)std::size(CUBE_VERTICES), CUBE_INDICES, CUBE_TRIANGLES, cubeMesh, outErrorMsg))
+        return false;
+
+    if (!cubeInstances.initialize(ctx, createCubeInstances(), cubeMesh, outErrorMsg))
+        return false;
+
+    if (!createUnculledDraw(outErrorMsg))
+        return false;
+
+    std::string cullError;
+    if (culler.initialize(ctx, compiler, config.cubeCount, config.framesInFlight, cullError))
+        culler.setOcclusionEnabled(config.occlusionCulling);
+    else
+        KHOLST_LOGW("GPU culling is unavailable, drawing every cube: %s\n", cullError.c_str());
+
+    cubeProgram = getCubeProgram();
+    solidVariant = {};
+    wireframeVariant = {
+        .specConstants = { { .constantId = 0, .value = VK_FALSE } },
+        .polygonMode = lvk::PolygonMode_Line,
+    };
+    barycentricWireframeVariant = {
+        .defines = getBarycentricWireframeDefines(),
+        .specConstants = { { .constantId = 1, .value = VK_TRUE } },
+    };
+    solidVariantKey = PipelineVariantManager::computeKey(solidVariant);
+    wireframeVariantKey = PipelineVariantManager::computeKey(wireframeVariant);
+    barycentricWireframeVariantKey = PipelineVariantManager::computeKey(barycentricWireframeVariant);
+
+    const lvk::RenderPipelineDesc cubeDesc = {
+        .vertexInput = {
+            .attributes = {
+                { .location = 0, .format = lvk::VertexFormat::Float3, .offset = offsetof(Vertex, position) },
+                { .location = 1, .format = lvk::VertexFormat::Float3, .offset = offsetof(Vertex, color) },
+            },
+            .inputBindings = { { .stride = sizeof(Vertex) } },
+        },
+        .color  = { { .format = config.colorFormat } },
+        .depthFormat = config.depthFormat,
+        .cullMode = lvk::CullMode_Back,
+    };
+    cubeVariants.initialize(ctx, compiler, cubeProgram, cubeDesc, config.maxPipelineVariants);
+
+    // Every cube pass is drawn every frame, build them before the first one
+    const std::vector<PipelineVariantDesc> drawnVariants = config.barycentricWireframe ?
+        std::vector<PipelineVariantDesc>{ barycentricWireframeVariant } :
+        std::vector<PipelineVariantDesc>{ solidVariant, wireframeVariant };
+
+    std::string meshletError;
+    if (config.meshShading && !createMeshlets(compiler, cubeDesc, drawnVariants, meshletError))
+    {
+        KHOLST_LOGW("Mesh shading is unavailable, drawing with the vertex path: %s\n", meshletError.c_str());
+        clearMeshlets();
+        config.meshShading = false;
+    }
+
+    const size_t failures = config.meshShading ? 0 : cubeVariants.prewarm(drawnVariants);
+    if (failures)
+        KHOLST_LOGW("Failed to build %zu cube pipeline variants\n", failures);
+
+    return createMaterials(outErrorMsg);
+}
+
+// Meshlets share the mesh buffers' vertices, only their own tables are uploaded
+bool SceneRenderer::createMeshlets(
+    shader::SlangCompiler& compiler,
+    const lvk::RenderPipelineDesc& cubeDesc,
+    const std::vector<PipelineVariantDesc>& variants,
+    std::string& outErrorMsg
+)
+{
+    MeshletData meshletData;
+    if (!buildMeshlets(&CUBE_VERTICES[0].position.x, (uint32_t)std::size(CUBE_VERTICES), sizeof(Vertex),
+            CUBE_INDICES, CUBE_TRIANGLES, meshletData, outErrorMsg))
+        return false;
+
+    const size_t meshletBytes = meshletData.meshlets.size() * sizeof(Meshlet);
+    const size_t vertexBytes = meshletData.vertices.size() * sizeof(uint32_t);
+    const size_t triangleBytes = meshletData.triangles.size() * sizeof(uint32_t);
+
+    std::vector<uint8_t> contents(meshletBytes + vertexBytes + triangleBytes);
+    std::memcpy(contents.data(), meshletData.meshlets.data(), meshletBytes);
+    std::memcpy(contents.data() + meshletBytes, meshletData.vertices.data(), vertexBytes);
+    std::memcpy(contents.data() + meshletBytes + vertexBytes, meshletData.triangles.data(), triangleBytes);
+
+    lvk::Result res;
+    meshletBuffer = ctx->createBuffer({
+        .usage = lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = contents.size(),
+        .data = contents.data(),
+        .debugName = "Buffer: cube meshlets",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create meshlet buffer: ") + (res.message ? res.message : "");
+        return false;
+    }
+
+    meshletsAddress = ctx->gpuAddress(meshletBuffer);
+    meshletVerticesAddress = ctx->gpuAddress(meshletBuffer, meshletBytes);
+    meshletTrianglesAddress = ctx->gpuAddress(meshletBuffer, meshletBytes + vertexBytes);
+    meshletCount = (uint32_t)meshletData.meshlets.size();
+
+    meshletProgram = getCubeMeshletProgram();
+
+    // Vertices are fetched by the mesh shader, the pipeline has no vertex input
+    lvk::RenderPipelineDesc meshletDesc = cubeDesc;
+    meshletDesc.vertexInput = {};
+    meshletVariants.initialize(ctx, compiler, meshletProgram, meshletDesc, config.maxPipelineVariants);
+
+    const size_t failures = meshletVariants.prewarm(variants);
+    if (failures)
+    {
+        outErrorMsg = "Failed to build " + std::to_string(failures) + " meshlet pipeline variants";
+        return false;
+    }
+    return true;
+}
+
+void SceneRenderer::clearMeshlets()
+{
+    meshletVariants.clear();
+    meshletProgram = {};
+    meshletBuffer = {};
+    meshletsAddress = 0;
+    meshletVerticesAddress = 0;
+    meshletTrianglesAddress = 0;
+    meshletCount = 0;
+}
+
+bool SceneRenderer::createUnculledDraw(std::string& outErrorMsg)
+{
+    std::vector<uint32_t> visible(cubeInstances.getInstanceCount());
+    std::iota(visible.begin(), visible.end(), 0u);
+
+    lvk::Result res;
+    unculledBuffer = ctx->createBuffer({
+        .usage = lvk::BufferUsageBits_Storage,
+        .storage = lvk::StorageType_Device,
+        .size = visible.size() * sizeof(uint32_t),
+        .data = visible.data(),
+        .debugName = "Buffer: unculled cube instances",
+    }, nullptr, &res);
+    if (!res.isOk())
+    {
+        outErrorMsg = std::string("Failed to create unculled instance buffer: ") + (res.message ? res.message : "");
+        return false;
+    }
+
+    unculledVisibleAddress = ctx->gpuAddress(unculledBuffer);
+    return true;
+}
+
+// Materials use the layout of the variant that is drawn, every variant declares the same struct
+bool SceneRenderer::createMaterials(std::string& outErrorMsg)
+{
+    const shader::ShaderReflection* reflection = cubeVariants.getReflection(config.barycentricWireframe ? barycentricWireframeVariant : solidVariant);
+    const shader::ReflectedStruct* layout = reflection ? shader::findBufferStruct(*reflection, CUBE_MATERIAL_STRUCT) : nullptr;
+    if (!layout)
+    {
+        outErrorMsg = std::string("No ") + CUBE_MATERIAL_STRUCT + " buffer struct in the reflection of " + cubeProgram.shaderPath;
+        return false;
+    }
+
+    if (!materials.initialize(ctx, *layout, config.maxMaterials, outErrorMsg))
+        return false;
+
+    // Texture and sampler 0 are LVK's white dummy texture and default sampler
+    auto create = [this](const glm::vec4& baseColor)
+    {
+        const MaterialSystem::MaterialId material = materials.create();
+        const bool written =
+            materials.setVec4(material, "baseColor", baseColor) &&
+            materials.setUint(material, "baseColorTexture", 0) &&
+            materials.setUint(material, "baseColorSampler", 0) &&
+            materials.setFloat(material, "textureScale", 1.0f);
+        if (!written)
+            KHOLST_LOGW("%s does not have the fields the renderer writes\n", CUBE_MATERIAL_STRUCT);
+        return material;
+    };
+
+    cubeMaterial = create(glm::vec4(1.0f));
+    wireframeMaterial = create(glm::vec4(0.2f, 0.2f, 0.2f, 1.0f)); // Darkens the edges drawn over the solid pass
+    materials.flush();
+    return true;
+}
+
+// A cubic grid centered on the origin, the camera is pulled back to fit it
+std::vector<InstanceData> SceneRenderer::createCubeInstances()
+{
+    const uint32_t side = (uint32_t)std::ceil(std::cbrt((double)config.cubeCount));
+    const float extent = (side - 1) * config.cubeSpacing;
+    cameraDistance = 3.5f + extent * 1.5f;
+
+    std::vector<InstanceData> instances;
+    instances.reserve(config.cubeCount);
+    for (uint32_t i = 0; i < config.cubeCount; i++)
+    {
+        const glm::vec3 cell = { (float)(i % side), (float)(i / side % side), (float)(i / (side * side)) };
+        const glm::vec3 position = cell * config.cubeSpacing - glm::vec3(extent * 0.5f);
+        const glm::vec3 axis = i ? glm::vec3(1.0f + cell.y, 1.0f + cell.z, 1.0f + cell.x) : glm::vec3(1.0f);
+        instances.push_back({
+            .positionScale = { position, 1.0f },
+            .rotation = { axis, 1.0f + (i % 7) * 0.1f },
+        });
+    }
+    return instances;
+}
+
+// The Hi-Z pyramid follows the size of the color target, and so of depth
+void SceneRenderer::updateTargetDimensions(const lvk::Dimensions& dimensions)
+{
+    if (dimensions.width == targetDimensions.width && dimensions.height == targetDimensions.height)
+        return;
+
+    targetDimensions = dimensions;
+    culler.resize(dimensions);
+}
+
+bool SceneRenderer::render(lvk::ICommandBuffer& buf, lvk::TextureHandle color, const FrameParams& params)
+{
+    if (!ctx)
+        return false;
+
+    frameRing.beginFrame();
+    core::FrameArena& frameArena = frameArenas.beginFrame();
+    materials.flush();
+    const FrameRing::Allocation perFrame = frameRing.push(PerFrameData{
+        .viewProj = params.viewProj,
+        .cameraPosition = glm::vec4(params.cameraPosition, 1.0f),
+        .time = params.time,
+    });
+    if (!perFrame)
+        return false;
+
+    const lvk::Dimensions dimensions = ctx->getDimensions(color);
+    updateTargetDimensions(dimensions);
+
+    KHOLST_PROFILER_ZONE_COLOR("Record commands", KHOLST_PROFILER_COLOR_RECORD);
+
+    // Culling feeds this frame's draws only, it runs before the graph
+    bool culled = false;
+    {
+        KHOLST_PROFILER_GPU_TIMED_ZONE(gpuProfiler, buf, "Culling", 0xff00ff00);
+        culled = culler.cull(buf, frameRing, {
+            .viewProj = params.viewProj,
+            .instancesAddress = cubeInstances.getInstancesAddress(),
+            .instanceCount = cubeInstances.getInstanceCount(),
+            .mesh = cubeMesh,
+            .meshRadius = CUBE_BOUNDING_RADIUS,
+        });
+    }
+    if (culled && config.meshShading)
+        barrierCullToTaskShader(buf);
+
+    // Passes differ only in the material they push, nothing else is rebound for it
+    const CubePushConstants pushConstants = {
+        .perFrame = perFrame.gpuAddress,
+        .instances = cubeInstances.getInstancesAddress(),
+        .visibleInstances = culled ? culler.getVisibleInstancesAddress() : unculledVisibleAddress,
+        .materials = materials.getBufferAddress(),
+        .drawArgs = culled ? culler.getDrawArgsAddress() : cubeInstances.getDrawArgsAddress(),
+        .vertices = ctx->gpuAddress(meshBuffers.getVertexBuffer(), (size_t)cubeMesh.vertexOffset * sizeof(Vertex)),
+        .meshlets = meshletsAddress,
+        .meshletVertices = meshletVerticesAddress,
+        .meshletTriangles = meshletTrianglesAddress,
+        .materialIndex = cubeMaterial,
+        .meshletCount = meshletCount,
+    };
+    CubePushConstants wireframePushConstants = pushConstants;
+    wireframePushConstants.materialIndex = wireframeMaterial;
+
+    // Variant lookups may build pipelines, so they stay on the render thread
+    PipelineVariantManager& variants = config.meshShading ? meshletVariants : cubeVariants;
+    const lvk::RenderPipelineHandle barycentricPipeline = config.barycentricWireframe ? variants.get(barycentricWireframeVariant, barycentricWireframeVariantKey) : lvk::RenderPipelineHandle();
+    const lvk::RenderPipelineHandle solidPipeline = config.barycentricWireframe ? lvk::RenderPipelineHandle() : variants.get(solidVariant, solidVariantKey);
+    const lvk::RenderPipelineHandle wireframePipeline = config.barycentricWireframe ? lvk::RenderPipelineHandle() : variants.get(wireframeVariant, wireframeVariantKey);
+
+    // Task groups cover every instance and meshlet, groups past the culled count exit
+    const uint32_t instanceCount = cubeInstances.getInstanceCount();
+    const lvk::Dimensions taskGroups = {
+        .width = (meshletCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE,
+        .height = std::min(instanceCount, MAX_TASK_GROUPS_Y),
+        .depth = (instanceCount + MAX_TASK_GROUPS_Y - 1) / MAX_TASK_GROUPS_Y,
+    };
+    auto drawCubes = [&](CommandList& list)
+    {
+        if (config.meshShading)
+            list.cmdDrawMeshTasks(taskGroups);
+        else if (culled)
+            culler.draw(list);
+        else
+            cubeInstances.draw(list);
+    };
+
+    graph.reset(&frameArena);
+    const RenderGraph::ResourceId colorTarget = graph.importTexture("Color", color);
+    const RenderGraph::ResourceId depthTarget = graph.createTexture("Depth buffer", {
+        .format = config.depthFormat,
+        .dimensions = dimensions,
+    });
+
+    graph.addPass({
+        .name = "Scene",
+        .writes = { colorTarget, depthTarget },
+        .begin = [&](lvk::ICommandBuffer& passBuf, const lvk::Dependencies& dependencies)
+        {
+            passBuf.cmdBeginRendering(
+                {
+                    .color = { { .loadOp = lvk::LoadOp_Clear, .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f } } },
+                    .depth = { .loadOp = lvk::LoadOp_Clear, .clearDepth = 1.0f },
+                },
+                { .color = { { .texture = graph.getTexture(colorTarget) } }, .depthStencil = { .texture = graph.getTexture(depthTarget) } },
+                culled ? mergeDependencies(dependencies, culler.getDrawDependencies()) : dependencies
+            );
+            meshBuffers.bind(passBuf);
+        },
+        .record = [&](CommandList& list, uint32_t, uint32_t)
+        {
+            if (config.barycentricWireframe)
+            {
+                KHOLST_PROFILER_GPU_ZONE(list, "Render cube with wireframe overlay", 0xff0000ff);
+                list.cmdBindRenderPipeline(barycentricPipeline);
+                list.cmdBindDepthState({ .compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true });
+                list.cmdPushConstants(pushConstants);
+                drawCubes(list);
+                return;
+            }
+
+            {
+                KHOLST_PROFILER_GPU_ZONE(list, "Render cube", 0xff0000ff);
+                list.cmdBindRenderPipeline(solidPipeline);
+                list.cmdBindDepthState({ .compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true });
+                list.cmdPushConstants(pushConstants);
+                drawCubes(list);
+            }
+
+            {
+                KHOLST_PROFILER_GPU_ZONE(list, "Render wireframe cube", 0xff0000ff);
+                list.cmdBindRenderPipeline(wireframePipeline);
+                list.cmdBindDepthState({ .compareOp = lvk::CompareOp_LessEqual, .isDepthWriteEnabled = false });
+                list.cmdPushConstants(wireframePushConstants);
+                drawCubes(list);
+            }
+        },
+        .end = [](lvk::ICommandBuffer& passBuf)
+        {
+            passBuf.cmdEndRendering();
+        },
+    });
+
+    // Occluders for the next frame's culling, culled from the graph when occlusion is off
+    graph.addPass({
+        .name = "Hi-Z",
+        .reads = { depthTarget },
+        .sideEffects = config.occlusionCulling,
+        .begin = [&](lvk::ICommandBuffer& passBuf, const lvk::Dependencies&)
+        {
+            culler.buildHiZ(passBuf, graph.getTexture(depthTarget));
+        },
+    });
+
+    std::string errorMsg;
+    const bool recorded = graph.compile(errorMsg) && graph.execute(buf, passExecutor);
+    if (!errorMsg.empty())
+        KHOLST_LOGW("Failed to compile the frame graph: %s\n", errorMsg.c_str());
+
+    frameRing.flush();
+    return recorded;
+}
+
+void SceneRenderer::endFrame(lvk::SubmitHandle handle)
+{
+    frameRing.endFrame(handle);
+}
+
+void SceneRenderer::setGpuProfiler(GpuProfiler* profiler)
+{
+    gpuProfiler = profiler;
+    passExecutor.setGpuProfiler(profiler);
+}
+
+std::vector<SceneRenderer::Program> SceneRenderer::getPrograms() const
+{
+    std::vector<Program> programs = {
+        { .job = &cubeProgram, .dependencies = &cubeVariants.getDependencies() },
+        { .job = &culler.getProgram(), .dependencies = &culler.getDependencies() },
+    };
+    if (config.meshShading)
+        programs.push_back({ .job = &meshletProgram, .dependencies = &meshletVariants.getDependencies() });
+    return programs;
+}
+
+bool SceneRenderer::applyReload(size_t programIndex, const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg)
+{
+    switch (programIndex)
+    {
+    case 0:
+    {
+        if (!cubeVariants.applyReload(shaders, outErrorMsg))
+            return false;
+
+        // Existing materials were written for the old layout
+        const shader::ShaderReflection* reflection = shaders.empty() ? nullptr : shaders[0].getReflection();
+        const shader::ReflectedStruct* layout = reflection ? shader::findBufferStruct(*reflection, CUBE_MATERIAL_STRUCT) : nullptr;
+        if (!layout || !materials.matchesLayout(*layout))
+            KHOLST_LOGW("%s layout changed, restart to rebuild the materials\n", CUBE_MATERIAL_STRUCT);
+        return true;
+    }
+    case 1:
+        return culler.applyReload(shaders, outErrorMsg);
+    case 2:
+        if (config.meshShading)
+            return meshletVariants.applyReload(shaders, outErrorMsg);
+        [[fallthrough]];
+    default:
+        outErrorMsg = "Unknown scene program " + std::to_string(programIndex);
+        return false;
+    }
+}
+
+void SceneRenderer::clear()
+{
+    materials.clear();
+    cubeMaterial = MaterialSystem::INVALID_MATERIAL;
+    wireframeMaterial = MaterialSystem::INVALID_MATERIAL;
+    clearMeshlets();
+    cubeVariants.clear();
+    frameRing.clear();
+    culler.clear();
+    unculledBuffer = {};
+    unculledVisibleAddress = 0;
+    cubeInstances = {};
+    meshBuffers.clear();
+    cubeMesh = {};
+    graph.clear();
+    frameArenas.clear();
+    targetDimensions = {};
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
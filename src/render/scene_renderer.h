@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <lvk/LVK.h>
+
+#include "core/frame_arena.h"
+#include "render/culling/gpu_culler.h"
+#include "render/debug/gpu_profiler.h"
+#include "render/frame/frame_ring.h"
+#include "render/graph/pass_executor.h"
+#include "render/graph/render_graph.h"
+#include "render/instancing/instance_batch.h"
+#include "render/material/material_system.h"
+#include "render/mesh/mesh_buffers.h"
+#include "render/pipeline/pipeline_variants.h"
+#include "render/shader/compiler/compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Renders the cube grid scene into a color target
+ *
+ * Owns every GPU resource of the scene, culling, materials and the
+ * per-frame ring, but neither the window nor the swapchain, so the same
+ * renderer drives the interactive app and the headless benchmark. The frame is declared as a
+ * RenderGraph each render(); depth is one of its transient textures.
+ *
+ * With Config::meshShading the culled instances are drawn as meshlets by
+ * task and mesh shaders, which cull each meshlet by its bounding sphere and
+ * normal cone. If the meshlet pipelines cannot be built the renderer falls
+ * back to instanced indexed draws. If GPU culling cannot be set up or
+ * cull() records nothing, every instance is drawn unculled.
+ *
+ * Per frame: render() records into a command buffer and flushes per-frame
+ * data, the caller submits it and hands the submit handle to endFrame().
+ *
+ * Thread-safety: not thread-safe, use from the render thread.
+ */
+class SceneRenderer
+{
+public:
+    struct Config
+    {
+        uint32_t cubeCount = 1;
+        float cubeSpacing = 3.0f;
+        lvk::Format colorFormat = lvk::Format_Invalid;
+        lvk::Format depthFormat = lvk::Format_Z_F32;
+        bool occlusionCulling = true; // Against last frame's Hi-Z, frustum culling always runs
+        bool barycentricWireframe = false; // Requires DeviceFeatures::fragmentShaderBarycentric
+        bool meshShading = false; // Draw meshlets with task and mesh shaders, requires DeviceFeatures::meshShader
+        uint32_t framesInFlight = 2;
+        size_t perFrameBufferSize = 64 * 1024;
+        size_t frameArenaSize = 64 * 1024; // CPU scratch per frame in flight, grows to the largest frame
+        size_t maxPipelineVariants = 64;
+        uint32_t maxMaterials = 256;
+        uint32_t recordThreads = 0; // Workers recording pass command lists, 0 picks the core count
+    };
+
+    struct FrameParams
+    {
+        glm::mat4 viewProj = glm::mat4(1.0f);
+        glm::vec3 cameraPosition = glm::vec3(0.0f); // World space, for meshlet cone culling
+        float time = 0.0f; // Seconds, drives the cube animation
+    };
+
+    // A program the renderer builds, for the shader watcher
+    struct Program
+    {
+        const shader::ShaderCompileJob* job = nullptr;
+        const std::vector<std::string>* dependencies = nullptr;
+    };
+
+    SceneRenderer() = default;
+    ~SceneRenderer();
+
+    SceneRenderer(const SceneRenderer&) = delete;
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+
+    /**
+     * @brief Build the scene, its pipelines and per-frame resources
+     *
+     * @param ctx Context to allocate from, must outlive the renderer
+     * @param compiler Initialized compiler, must outlive the renderer
+     * @param config Scene and renderer settings
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(lvk::IContext* ctx, shader::SlangCompiler& compiler, const Config& config, std::string& outErrorMsg);
+
+    /**
+     * @brief Record one frame into color
+     *
+     * Waits for the frame in flight that last used this frame's resources.
+     * Call outside of a render pass; submit buf before the next render().
+     *
+     * @return false if nothing was recorded
+     */
+    bool render(lvk::ICommandBuffer& buf, lvk::TextureHandle color, const FrameParams& params);
+
+    // Pass the submit handle of the command buffer given to render()
+    void endFrame(lvk::SubmitHandle handle);
+
+    // Graph of the last render(), see RenderGraph::dump()
+    const RenderGraph& getRenderGraph() const { return graph; }
+
+    // CPU record and replay times of the last render()
+    PassExecutor::Stats getPassStats() const { return passExecutor.getStats(); }
+
+    /**
+     * @brief Time culling and every graph pass as GPU zones
+     *
+     * @param profiler Profiler whose frame brackets render(), must outlive
+     *                 the renderer; null turns timing off
+     */
+    void setGpuProfiler(GpuProfiler* profiler);
+
+    // Camera distance from the origin that fits the whole grid
+    float getCameraDistance() const { return cameraDistance; }
+
+    // Programs in the order applyReload() expects
+    std::vector<Program> getPrograms() const;
+
+    // False if mesh shading was not requested or fell back to the vertex path
+    bool isMeshShading() const { return config.meshShading; }
+
+    /**
+     * @brief Swap in a recompiled program
+     *
+     * @param programIndex Index into getPrograms()
+     * @param shaders One compiled shader per entry point of the program
+     * @param outErrorMsg Error description on failure
+     * @return true if the new pipelines were created
+     */
+    bool applyReload(size_t programIndex, const std::vector<shader::CompiledShader>& shaders, std::string& outErrorMsg);
+
+    void clear();
+
+private:
+    lvk::IContext* ctx = nullptr;
+    Config config;
+
+    shader::ShaderCompileJob cubeProgram;
+    PipelineVariantManager cubeVariants;
+    PipelineVariantDesc solidVariant;
+    PipelineVariantDesc wireframeVariant;
+    PipelineVariantDesc barycentricWireframeVariant;
+    // Looked up every frame, hashed once here
+    PipelineVariantKey solidVariantKey;
+    PipelineVariantKey wireframeVariantKey;
+    PipelineVariantKey barycentricWireframeVariantKey;
+
+    shader::ShaderCompileJob meshletProgram;
+    PipelineVariantManager meshletVariants;
+    lvk::Holder<lvk::BufferHandle> meshletBuffer; // Meshlets, then their vertices, then their triangles
+    uint64_t meshletsAddress = 0;
+    uint64_t meshletVerticesAddress = 0;
+    uint64_t meshletTrianglesAddress = 0;
+    uint32_t meshletCount = 0;
+
+    FrameRing frameRing;
+    core::FrameArenas frameArenas;
+    MeshBuffers meshBuffers;
+    MeshHandle cubeMesh;
+    InstanceBatch cubeInstances;
+    GpuCuller culler;
+
+    // Drawn when culling is unavailable: every instance in order, with the
+    // draw arguments of cubeInstances
+    lvk::Holder<lvk::BufferHandle> unculledBuffer;
+    uint64_t unculledVisibleAddress = 0;
+
+    MaterialSystem materials;
+    MaterialSystem::MaterialId cubeMaterial = MaterialSystem::INVALID_MATERIAL;
+    MaterialSystem::MaterialId wireframeMaterial = MaterialSystem::INVALID_MATERIAL;
+
+    RenderGraph graph;
+    PassExecutor passExecutor;
+    GpuProfiler* gpuProfiler = nullptr;
+
+    lvk::Dimensions targetDimensions = {};
+    float cameraDistance = 3.5f;
+
+    bool createScene(shader::SlangCompiler& compiler, std::string& outErrorMsg);
+    std::vector<InstanceData> createCubeInstances();
+    bool createMaterials(std::string& outErrorMsg);
+    bool createUnculledDraw(std::string& outErrorMsg);
+    bool createMeshlets(
+        shader::SlangCompiler& compiler,
+        const lvk::RenderPipelineDesc& cubeDesc,
+        const std::vector<PipelineVariantDesc>& variants,
+        std::string& outErrorMsg
+    );
+    void clearMeshlets();
+    void updateTargetDimensions(const lvk::Dimensions& dimensions);
+};
+
+} // namespace render
+} // namespace kholst
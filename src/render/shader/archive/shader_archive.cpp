@@ -0,0 +1,219 @@
+#include "shader_archive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "core/binary_stream.h"
+#include "core/file_utils.h"
+#include "core/hash.h"
+#include "core/profiler.h"
+#include "render/shader/reflection/shader_reflection.h"
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+// Bump when the file layout or the key changes so old archives are rejected
+static constexpr uint32_t SHADER_ARCHIVE_MAGIC = 0x4153484b; // "KHSA"
+static constexpr uint32_t SHADER_ARCHIVE_VERSION = 1;
+
+// SPIR-V and reflection blobs start on this boundary
+static constexpr size_t SHADER_ARCHIVE_ALIGNMENT = 8;
+
+struct ShaderArchive::Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct ShaderArchive::IndexEntry
+{
+    uint64_t key;
+    uint64_t spirvOffset; // From the start of the file
+    uint64_t reflectionOffset;
+    uint32_t spirvWords;
+    uint32_t reflectionSize;
+};
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t ShaderArchive::computeKey(
+    const std::string& shaderPath,
+    const EntryPointDesc& entryPoint,
+    SlangCompileTarget target,
+    const std::string& profile,
+    const std::vector<ShaderDefine>& defines
+)
+{
+    std::vector<ShaderDefine> sorted = defines;
+    std::sort(sorted.begin(), sorted.end(),
+        [](const ShaderDefine& a, const ShaderDefine& b) { return a.name < b.name; });
+
+    core::Hasher hasher;
+    hasher.add(SHADER_ARCHIVE_VERSION);
+    hasher.add(std::filesystem::path(shaderPath).lexically_normal().generic_string());
+    hasher.add(entryPoint.name);
+    hasher.add(entryPoint.stage);
+    hasher.add(target);
+    hasher.add(profile);
+    for (const ShaderDefine& define : sorted)
+    {
+        hasher.add(define.name);
+        hasher.add(define.value);
+    }
+    return hasher.finish();
+}
+
+bool ShaderArchive::open(const std::filesystem::path& path, std::string& outErrorMsg)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    file = {};
+    index = nullptr;
+    entryCount = 0;
+
+    std::shared_ptr<core::MappedFile> mapped = std::make_shared<core::MappedFile>();
+    if (!mapped->open(path, outErrorMsg))
+        return false;
+
+    const uint8_t* bytes = mapped->data();
+    const size_t size = mapped->size();
+
+    Header header = {};
+    if (size < sizeof(header))
+    {
+        outErrorMsg = path.string() + " is too small to be a shader archive";
+        return false;
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (header.magic != SHADER_ARCHIVE_MAGIC || header.version != SHADER_ARCHIVE_VERSION)
+    {
+        outErrorMsg = path.string() + " is not a shader archive of version " + std::to_string(SHADER_ARCHIVE_VERSION);
+        return false;
+    }
+
+    if ((size - sizeof(header)) / sizeof(IndexEntry) < header.entryCount)
+    {
+        outErrorMsg = path.string() + " is truncated";
+        return false;
+    }
+
+    // The mapping is page aligned, so the index and every blob are aligned too
+    const IndexEntry* entries = reinterpret_cast<const IndexEntry*>(bytes + sizeof(header));
+    for (uint32_t i = 0; i < header.entryCount; i++)
+    {
+        const IndexEntry& entry = entries[i];
+        const bool inRange =
+            entry.spirvOffset % sizeof(uint32_t) == 0 &&
+            entry.spirvOffset <= size && entry.spirvWords <= (size - entry.spirvOffset) / sizeof(uint32_t) &&
+            entry.reflectionOffset <= size && entry.reflectionSize <= size - entry.reflectionOffset;
+        if (!inRange || (i > 0 && entries[i - 1].key >= entry.key))
+        {
+            outErrorMsg = path.string() + " has a corrupt index";
+            return false;
+        }
+    }
+
+    file = std::move(mapped);
+    index = entries;
+    entryCount = header.entryCount;
+    return true;
+}
+
+bool ShaderArchive::find(uint64_t key, CompiledShader& outShader) const
+{
+    const IndexEntry* end = index + entryCount;
+    const IndexEntry* entry = std::lower_bound(index, end, key,
+        [](const IndexEntry& e, uint64_t k) { return e.key < k; });
+    if (entry == end || entry->key != key)
+        return false;
+
+    std::shared_ptr<ShaderReflection> reflection = std::make_shared<ShaderReflection>();
+    if (!deserializeReflection(file->data() + entry->reflectionOffset, entry->reflectionSize, *reflection))
+        return false;
+
+    const std::span<const uint32_t> code = {
+        reinterpret_cast<const uint32_t*>(file->data() + entry->spirvOffset),
+        entry->spirvWords,
+    };
+    outShader = CompiledShader(code, file, std::move(reflection));
+    return true;
+}
+
+bool ShaderArchiveWriter::add(uint64_t key, std::span<const uint32_t> spirv, std::vector<uint8_t> reflection)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [key](const Entry& e) { return e.key == key; });
+    if (it != entries.end())
+        return false;
+
+    entries.push_back({
+        .key = key,
+        .spirv = { spirv.begin(), spirv.end() },
+        .reflection = std::move(reflection),
+    });
+    return true;
+}
+
+bool ShaderArchiveWriter::write(const std::filesystem::path& path, std::string& outErrorMsg) const
+{
+    std::vector<const Entry*> sorted;
+    sorted.reserve(entries.size());
+    for (const Entry& entry : entries)
+        sorted.push_back(&entry);
+    std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->key < b->key; });
+
+    // Lay out the blobs after the index first, the index points at them
+    std::vector<ShaderArchive::IndexEntry> indexEntries;
+    indexEntries.reserve(sorted.size());
+    size_t offset = sizeof(ShaderArchive::Header) + sorted.size() * sizeof(ShaderArchive::IndexEntry);
+    for (const Entry* entry : sorted)
+    {
+        const size_t spirvOffset = alignUp(offset, SHADER_ARCHIVE_ALIGNMENT);
+        const size_t reflectionOffset = alignUp(spirvOffset + entry->spirv.size() * sizeof(uint32_t), SHADER_ARCHIVE_ALIGNMENT);
+        indexEntries.push_back({
+            .key = entry->key,
+            .spirvOffset = spirvOffset,
+            .reflectionOffset = reflectionOffset,
+            .spirvWords = (uint32_t)entry->spirv.size(),
+            .reflectionSize = (uint32_t)entry->reflection.size(),
+        });
+        offset = reflectionOffset + entry->reflection.size();
+    }
+
+    core::BinaryWriter writer;
+    writer.write(ShaderArchive::Header{
+        .magic = SHADER_ARCHIVE_MAGIC,
+        .version = SHADER_ARCHIVE_VERSION,
+        .entryCount = (uint32_t)sorted.size(),
+        .reserved = 0,
+    });
+    writer.writeBytes(indexEntries.data(), indexEntries.size() * sizeof(ShaderArchive::IndexEntry));
+
+    auto pad = [&writer](size_t to)
+    {
+        static const uint8_t ZEROES[SHADER_ARCHIVE_ALIGNMENT] = {};
+        writer.writeBytes(ZEROES, to - writer.getBuffer().size());
+    };
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        pad(indexEntries[i].spirvOffset);
+        writer.writeBytes(sorted[i]->spirv.data(), sorted[i]->spirv.size() * sizeof(uint32_t));
+        pad(indexEntries[i].reflectionOffset);
+        writer.writeBytes(sorted[i]->reflection.data(), sorted[i]->reflection.size());
+    }
+
+    return core::writeFileAtomic(path, writer.getBuffer(), outErrorMsg);
+}
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
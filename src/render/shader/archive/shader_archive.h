@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <slang.h>
+
+#include "core/mapped_file.h"
+#include "render/shader/compiler/compiled_shader.h"
+#include "render/shader/compiler/compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+/**
+ * @brief Memory-mapped archive of precompiled SPIR-V and reflection data
+ *
+ * Written at build time by kholst-shaderc. The file starts with a header and
+ * an index of entries sorted by key, followed by the SPIR-V and serialized
+ * reflection of every entry. Opening it maps the file and validates the
+ * index; shaders found in it point straight into the mapping, so nothing is
+ * read from disk before a shader module is created from it.
+ *
+ * Entries are keyed by computeKey(), not by the module source: the archive
+ * is only as fresh as the build that produced it.
+ *
+ * Thread-safety: find() may be called concurrently once open() returned.
+ */
+class ShaderArchive
+{
+public:
+    /**
+     * @brief Key of one entry point compiled with a given session setup
+     *
+     * Defines are order-independent. Paths are compared lexically, so the
+     * archive and the runtime have to spell module paths the same way.
+     */
+    static uint64_t computeKey(
+        const std::string& shaderPath,
+        const EntryPointDesc& entryPoint,
+        SlangCompileTarget target,
+        const std::string& profile,
+        const std::vector<ShaderDefine>& defines
+    );
+
+    /**
+     * @brief Map an archive and validate its index
+     *
+     * @param path Archive written by ShaderArchiveWriter
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool open(const std::filesystem::path& path, std::string& outErrorMsg);
+
+    /**
+     * @brief Look up an entry
+     *
+     * @param key Key from computeKey()
+     * @param outShader Receives code pointing into the mapping, and its reflection
+     * @return false if the archive has no such entry
+     */
+    bool find(uint64_t key, CompiledShader& outShader) const;
+
+    size_t getEntryCount() const { return entryCount; }
+    size_t getSizeBytes() const { return file ? file->size() : 0; }
+
+private:
+    struct Header;
+    struct IndexEntry;
+
+    friend class ShaderArchiveWriter;
+
+    std::shared_ptr<core::MappedFile> file;
+    const IndexEntry* index = nullptr;
+    size_t entryCount = 0;
+};
+
+/**
+ * @brief Collects compiled entry points and writes a ShaderArchive file
+ *
+ * Thread-safety: not thread-safe.
+ */
+class ShaderArchiveWriter
+{
+public:
+    /**
+     * @brief Add one entry
+     *
+     * @param key Key from ShaderArchive::computeKey()
+     * @param spirv Code of the entry, copied
+     * @param reflection Serialized reflection, see serializeReflection()
+     * @return false if an entry with the same key was already added
+     */
+    bool add(uint64_t key, std::span<const uint32_t> spirv, std::vector<uint8_t> reflection);
+
+    /**
+     * @brief Write every entry to path
+     *
+     * Written to a temporary next to path and renamed, so a failed build
+     * never leaves a truncated archive behind.
+     *
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool write(const std::filesystem::path& path, std::string& outErrorMsg) const;
+
+    size_t getEntryCount() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        uint64_t key = 0;
+        std::vector<uint32_t> spirv;
+        std::vector<uint8_t> reflection;
+    };
+
+    std::vector<Entry> entries;
+};
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,263 @@
+#include "spirv_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "core/hash.h"
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+// Bump when the entry layout changes so old caches are silently ignored
+static constexpr uint32_t CACHE_MAGIC = 0x5650534b; // "KSPV"
+static constexpr uint32_t CACHE_VERSION = 2;
+
+static bool hashFileContents(const std::string& path, uint64_t& outHash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    const std::string contents{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    outHash = core::hashBytes(contents.data(), contents.size());
+    return true;
+}
+
+template<typename ValueType>
+static bool readValue(std::ifstream& file, ValueType& value)
+{
+    return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+// Bytes between the read position and the end of the file, sizes read from an
+// entry are checked against it so a corrupt one cannot make us allocate
+static uint64_t bytesLeft(std::ifstream& file, uint64_t fileSize)
+{
+    const std::streamoff position = file.tellg();
+    return position < 0 || (uint64_t)position > fileSize ? 0 : fileSize - (uint64_t)position;
+}
+
+template<typename ValueType>
+static void writeValue(std::ofstream& file, const ValueType& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+SpirvCache::SpirvCache(std::filesystem::path directory)
+    : directory(std::move(directory))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(this->directory, ec);
+}
+
+std::filesystem::path SpirvCache::entryPath(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)key);
+    return directory / name;
+}
+
+bool SpirvCache::load(
+    uint64_t key,
+    std::vector<uint32_t>& outSpirv,
+    std::vector<std::string>* outDependencies,
+    std::vector<uint8_t>* outMetadata
+)
+{
+    std::ifstream file(entryPath(key), std::ios::binary | std::ios::ate);
+    const std::streamoff fileSize = file.is_open() ? (std::streamoff)file.tellg() : -1;
+    if (fileSize < 0 || !file.seekg(0))
+    {
+        misses++;
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, storedKey) ||
+        magic != CACHE_MAGIC || version != CACHE_VERSION || storedKey != key)
+    {
+        misses++;
+        return false;
+    }
+
+    // Reject the entry if any imported file changed since it was written
+    uint32_t dependencyCount = 0;
+    // Every dependency takes at least its length and hash
+    if (!readValue(file, dependencyCount) ||
+        (uint64_t)dependencyCount * (sizeof(uint32_t) + sizeof(uint64_t)) > bytesLeft(file, fileSize))
+    {
+        misses++;
+        return false;
+    }
+
+    std::vector<std::string> dependencies;
+    dependencies.reserve(dependencyCount);
+    for (uint32_t i = 0; i < dependencyCount; i++)
+    {
+        uint32_t pathLength = 0;
+        if (!readValue(file, pathLength) || pathLength > bytesLeft(file, fileSize))
+        {
+            misses++;
+            return false;
+        }
+
+        std::string path(pathLength, '\0');
+        uint64_t storedHash = 0;
+        uint64_t currentHash = 0;
+        if (!file.read(path.data(), pathLength) || !readValue(file, storedHash) ||
+            !hashFileContents(path, currentHash) || currentHash != storedHash)
+        {
+            misses++;
+            return false;
+        }
+        dependencies.push_back(std::move(path));
+    }
+
+    uint64_t spirvSize = 0;
+    if (!readValue(file, spirvSize) || spirvSize == 0 || spirvSize % sizeof(uint32_t) != 0 ||
+        spirvSize > bytesLeft(file, fileSize))
+    {
+        misses++;
+        return false;
+    }
+
+    outSpirv.resize(spirvSize / sizeof(uint32_t));
+    if (!file.read(reinterpret_cast<char*>(outSpirv.data()), spirvSize))
+    {
+        outSpirv.clear();
+        misses++;
+        return false;
+    }
+
+    uint64_t metadataSize = 0;
+    std::vector<uint8_t> metadata;
+    if (readValue(file, metadataSize))
+    {
+        if (metadataSize > bytesLeft(file, fileSize))
+        {
+            outSpirv.clear();
+            misses++;
+            return false;
+        }
+
+        metadata.resize(metadataSize);
+        if (metadataSize && !file.read(reinterpret_cast<char*>(metadata.data()), metadataSize))
+        {
+            outSpirv.clear();
+            misses++;
+            return false;
+        }
+    }
+
+    if (outMetadata)
+        *outMetadata = std::move(metadata);
+
+    if (outDependencies)
+        *outDependencies = std::move(dependencies);
+
+    hits++;
+    return true;
+}
+
+bool SpirvCache::store(
+    uint64_t key,
+    const std::vector<std::string>& dependencies,
+    const uint32_t* spirv,
+    size_t wordCount,
+    const std::vector<uint8_t>& metadata
+)
+{
+    // An entry that can't be validated later is worse than no entry
+    std::vector<std::pair<const std::string*, uint64_t>> hashedDependencies;
+    hashedDependencies.reserve(dependencies.size());
+    for (const std::string& dependency : dependencies)
+    {
+        uint64_t hash = 0;
+        if (!hashFileContents(dependency, hash))
+            return false;
+        hashedDependencies.emplace_back(&dependency, hash);
+    }
+
+    const std::filesystem::path finalPath = entryPath(key);
+
+    // Write to a per-thread temporary and rename, so readers never observe a
+    // partially written entry
+    std::filesystem::path tempPath = finalPath;
+    tempPath += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        writeValue(file, CACHE_MAGIC);
+        writeValue(file, CACHE_VERSION);
+        writeValue(file, key);
+
+        writeValue(file, (uint32_t)hashedDependencies.size());
+        for (const auto& [path, hash] : hashedDependencies)
+        {
+            writeValue(file, (uint32_t)path->size());
+            file.write(path->data(), path->size());
+            writeValue(file, hash);
+        }
+
+        const uint64_t spirvSize = wordCount * sizeof(uint32_t);
+        writeValue(file, spirvSize);
+        file.write(reinterpret_cast<const char*>(spirv), spirvSize);
+
+        writeValue(file, (uint64_t)metadata.size());
+        file.write(reinterpret_cast<const char*>(metadata.data()), metadata.size());
+
+        if (!file.good())
+        {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    stores++;
+    return true;
+}
+
+SpirvCache::Stats SpirvCache::getStats() const
+{
+    return {
+        .hits = hits.load(),
+        .misses = misses.load(),
+        .stores = stores.load(),
+    };
+}
+
+void SpirvCache::resetStats()
+{
+    hits = 0;
+    misses = 0;
+    stores = 0;
+}
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
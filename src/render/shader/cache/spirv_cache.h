@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+/**
+ * @brief Persistent content-addressed store of compiled SPIR-V blobs
+ *
+ * Each entry lives in its own file named after the 64-bit key. The key is
+ * computed by the caller from everything that affects code generation
+ * (module source, entry point, stage, target, profile, defines). Imported
+ * modules are not known before Slang resolves them, so every entry also
+ * records the content hash of its dependency files and is rejected on load
+ * if any of them changed.
+ *
+ * Thread-safety: load() and store() may be called concurrently for different
+ * keys. Concurrent stores of the same key are safe (last writer wins).
+ */
+class SpirvCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+    };
+
+    explicit SpirvCache(std::filesystem::path directory);
+
+    /**
+     * @brief Look up an entry and validate its dependencies
+     *
+     * @param key Content key of the entry
+     * @param outSpirv Receives the SPIR-V words on a hit
+     * @param outDependencies Optionally receives the recorded dependency files
+     * @param outMetadata Optionally receives the metadata stored with the entry
+     * @return true on a hit, false if the entry is missing, corrupt or stale
+     */
+    bool load(
+        uint64_t key,
+        std::vector<uint32_t>& outSpirv,
+        std::vector<std::string>* outDependencies = nullptr,
+        std::vector<uint8_t>* outMetadata = nullptr
+    );
+
+    /**
+     * @brief Write an entry to disk
+     *
+     * @param key Content key of the entry
+     * @param dependencies Files whose contents the SPIR-V depends on besides the
+     *                     module source already covered by the key
+     * @param spirv SPIR-V words
+     * @param wordCount Number of words in spirv
+     * @param metadata Opaque bytes stored with the entry, e.g. reflection data
+     * @return true if the entry was written, false also when a dependency
+     *         can't be read
+     */
+    bool store(
+        uint64_t key,
+        const std::vector<std::string>& dependencies,
+        const uint32_t* spirv,
+        size_t wordCount,
+        const std::vector<uint8_t>& metadata = {}
+    );
+
+    Stats getStats() const;
+    void resetStats();
+
+    const std::filesystem::path& getDirectory() const { return directory; }
+
+private:
+    std::filesystem::path directory;
+
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> stores = 0;
+
+    std::filesystem::path entryPath(uint64_t key) const;
+};
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,154 @@
+#include "batch_compiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+BatchCompiler::BatchCompiler() = default;
+
+BatchCompiler::~BatchCompiler()
+{
+    // Workers reference the compilers, drain them before tearing down
+    if (executor)
+        executor->wait_for_all();
+}
+
+bool BatchCompiler::initialize(const SlangCompiler& prototype, size_t workerCount, std::string& outErrorMsg)
+{
+    if (!prototype.isInitialized())
+    {
+        outErrorMsg = "Prototype compiler not initialized";
+        return false;
+    }
+
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Sessions are created here, on a single thread, because the shared
+    // global session must not be used concurrently. Waiting for a global
+    // session the prototype is still creating keeps the workers from
+    // deferring theirs to concurrent misses.
+    prototype.getGlobalSession();
+
+    compilers.clear();
+    compilers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        std::unique_ptr<SlangCompiler> compiler = std::make_unique<SlangCompiler>();
+        if (!compiler->initialize(prototype, prototype.getDefines()))
+        {
+            outErrorMsg = "Failed to create worker session: " + compiler->getLastDiagnostics();
+            compilers.clear();
+            return false;
+        }
+
+        if (prototype.getArchive())
+            compiler->enableArchive(prototype.getArchive());
+        if (prototype.getCache())
+            compiler->enableCache(prototype.getCache());
+
+        compilers.push_back(std::move(compiler));
+    }
+
+    executor = std::make_unique<tf::Executor>(workerCount);
+    return true;
+}
+
+ShaderCompileResult BatchCompiler::run(const ShaderCompileJob& job)
+{
+    ShaderCompileResult result;
+
+    const int workerId = executor->this_worker_id();
+    if (workerId < 0 || (size_t)workerId >= compilers.size())
+    {
+        result.errorMsg = "Shader job scheduled outside of the batch worker pool";
+        return result;
+    }
+
+    SlangCompiler& compiler = *compilers[workerId];
+    result.success = compiler.compileEntryPoints(job.shaderPath, job.entryPoints, result.shaders, result.errorMsg);
+    result.diagnostics = compiler.getLastDiagnostics();
+    return result;
+}
+
+std::future<ShaderCompileResult> BatchCompiler::submit(ShaderCompileJob job)
+{
+    std::shared_ptr<std::promise<ShaderCompileResult>> promise = std::make_shared<std::promise<ShaderCompileResult>>();
+    std::future<ShaderCompileResult> future = promise->get_future();
+
+    if (!executor)
+    {
+        promise->set_value({ .errorMsg = "Batch compiler not initialized" });
+        return future;
+    }
+
+    executor->silent_async([this, promise, job = std::move(job)]()
+    {
+        promise->set_value(run(job));
+    });
+
+    return future;
+}
+
+std::vector<std::future<ShaderCompileResult>> BatchCompiler::submit(const std::vector<ShaderCompileJob>& jobs)
+{
+    std::vector<std::future<ShaderCompileResult>> futures;
+    futures.reserve(jobs.size());
+    for (const ShaderCompileJob& job : jobs)
+        futures.push_back(submit(job));
+    return futures;
+}
+
+void BatchCompiler::submit(const std::vector<ShaderCompileJob>& jobs, CompletionCallback onComplete)
+{
+    struct BatchState
+    {
+        std::vector<ShaderCompileResult> results;
+        std::atomic<size_t> remaining;
+        CompletionCallback onComplete;
+    };
+
+    if (jobs.empty() || !executor)
+    {
+        std::vector<ShaderCompileResult> results(jobs.size());
+        for (ShaderCompileResult& result : results)
+            result.errorMsg = "Batch compiler not initialized";
+        onComplete(std::move(results));
+        return;
+    }
+
+    std::shared_ptr<BatchState> state = std::make_shared<BatchState>();
+    state->results.resize(jobs.size());
+    state->remaining = jobs.size();
+    state->onComplete = std::move(onComplete);
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        executor->silent_async([this, state, i, job = jobs[i]]()
+        {
+            state->results[i] = run(job);
+
+            // The last job to finish hands the whole batch over
+            if (state->remaining.fetch_sub(1) == 1)
+                state->onComplete(std::move(state->results));
+        });
+    }
+}
+
+void BatchCompiler::waitIdle()
+{
+    if (executor)
+        executor->wait_for_all();
+}
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <taskflow/taskflow.hpp>
+
+#include "compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+/**
+ * @brief Compiles independent shader modules concurrently on a worker pool
+ *
+ * Every worker owns a SlangCompiler with its own ISession; all of them share
+ * the IGlobalSession, target, profile, shader archive and SPIR-V cache of
+ * the prototype compiler passed in. Jobs must be independent modules: a
+ * batch never links across jobs.
+ *
+ * Thread-safety: submit() may be called from any thread. Completion
+ * callbacks run on a worker thread.
+ */
+class BatchCompiler
+{
+public:
+    using CompletionCallback = std::function<void(std::vector<ShaderCompileResult>&& results)>;
+
+    BatchCompiler();
+    ~BatchCompiler();
+
+    /**
+     * @brief Create the worker pool and the per-worker sessions
+     *
+     * @param prototype Initialized compiler to take the global session, target,
+     *                  profile, defines, archive and cache from. Must outlive
+     *                  this object.
+     * @param workerCount Number of worker threads, 0 picks the core count
+     * @param outErrorMsg Error description on failure
+     * @return true if every worker session was created
+     */
+    bool initialize(const SlangCompiler& prototype, size_t workerCount, std::string& outErrorMsg);
+
+    // Queue a single job, the future becomes ready when it finishes
+    std::future<ShaderCompileResult> submit(ShaderCompileJob job);
+
+    // Queue a batch of jobs, one future per job in request order
+    std::vector<std::future<ShaderCompileResult>> submit(const std::vector<ShaderCompileJob>& jobs);
+
+    // Queue a batch of jobs and invoke onComplete once all of them finished
+    void submit(const std::vector<ShaderCompileJob>& jobs, CompletionCallback onComplete);
+
+    // Block until every queued job finished
+    void waitIdle();
+
+    size_t getWorkerCount() const { return compilers.size(); }
+
+private:
+    std::unique_ptr<tf::Executor> executor;
+    std::vector<std::unique_ptr<SlangCompiler>> compilers; // Indexed by worker id
+
+    ShaderCompileResult run(const ShaderCompileJob& job);
+};
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <slang.h>
+#include <slang-com-ptr.h>
+
+#include "render/shader/reflection/shader_reflection.h"
+
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+/**
+ * @brief SPIR-V code of one compiled entry point
+ *
+ * Code produced by Slang stays in the blob Slang returned, which is kept
+ * alive here, so handing it to createShaderModule() does not copy it.
+ * Code loaded from the SPIR-V cache owns its words instead, and code from a
+ * shader archive points into the mapped archive, which it keeps mapped.
+ * Copies share the underlying blob, mapping and reflection data.
+ */
+class CompiledShader
+{
+public:
+    CompiledShader() = default;
+
+    explicit CompiledShader(
+        Slang::ComPtr<slang::IBlob> blob,
+        std::shared_ptr<const ShaderReflection> reflection = nullptr
+    )
+        : blob(std::move(blob))
+        , reflection(std::move(reflection))
+    {
+    }
+
+    explicit CompiledShader(
+        std::vector<uint32_t> words,
+        std::shared_ptr<const ShaderReflection> reflection = nullptr
+    )
+        : words(std::move(words))
+        , reflection(std::move(reflection))
+    {
+    }
+
+    // Code inside memory that owner keeps alive
+    CompiledShader(
+        std::span<const uint32_t> code,
+        std::shared_ptr<const void> owner,
+        std::shared_ptr<const ShaderReflection> reflection = nullptr
+    )
+        : code(code)
+        , owner(std::move(owner))
+        , reflection(std::move(reflection))
+    {
+    }
+
+    std::span<const uint32_t> getSpirv() const
+    {
+        if (blob)
+            return { static_cast<const uint32_t*>(blob->getBufferPointer()), blob->getBufferSize() / sizeof(uint32_t) };
+        if (owner)
+            return code;
+        return { words.data(), words.size() };
+    }
+
+    const void* data() const { return getSpirv().data(); }
+    size_t sizeInBytes() const { return getSpirv().size_bytes(); }
+    bool empty() const { return getSpirv().empty(); }
+
+    // Entry point and global parameter layout, null if it was not produced
+    const ShaderReflection* getReflection() const { return reflection.get(); }
+
+    // Copy of the code, for callers that need to own or modify it
+    std::vector<uint32_t> toVector() const
+    {
+        const std::span<const uint32_t> spirv = getSpirv();
+        return { spirv.begin(), spirv.end() };
+    }
+
+private:
+    Slang::ComPtr<slang::IBlob> blob;
+    std::vector<uint32_t> words;
+    std::span<const uint32_t> code;
+    std::shared_ptr<const void> owner;
+    std::shared_ptr<const ShaderReflection> reflection;
+};
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -1,7 +1,15 @@
 #include "compiler.h"
-#include <iostream>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <system_error>
+
+#include "core/async_log.h"
+#include "core/hash.h"
+#include "core/profiler.h"
+#include "render/shader/archive/shader_archive.h"
+#include "render/shader/reflection/shader_reflection.h"
 
 namespace kholst
 {
@@ -14,7 +22,15 @@ SlangCompiler::SlangCompiler() = default;
 
 SlangCompiler::~SlangCompiler() = default;
 
-bool SlangCompiler::initialize(SlangCompileTarget target)
+// Bump to invalidate every cached blob after a change in how code is generated
+static constexpr uint32_t CACHE_KEY_VERSION = 1;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool SlangCompiler::initialize(SlangCompileTarget target, const std::vector<ShaderDefine>& defines)
 {
     if (initialized)
         return true;
@@ -26,15 +42,142 @@ bool SlangCompiler::initialize(SlangCompileTarget target)
         return false;
     }
 
+    compileTarget = target;
+    sessionDefines = defines;
+    return createSession();
+}
+
+bool SlangCompiler::initialize(
+    slang::IGlobalSession* sharedGlobalSession,
+    SlangCompileTarget target,
+    const std::vector<ShaderDefine>& defines
+)
+{
+    if (initialized)
+        return true;
+
+    if (!sharedGlobalSession)
+    {
+        lastDiagnostics = "Shared Slang global session is null";
+        return false;
+    }
+
+    globalSession = sharedGlobalSession;
+    compileTarget = target;
+    sessionDefines = defines;
+    return createSession();
+}
+
+bool SlangCompiler::initializeAsync(SlangCompileTarget target, const std::vector<ShaderDefine>& defines)
+{
+    if (initialized)
+        return true;
+
+    // Only created on the worker, used on the calling thread once the future is ready
+    pendingGlobalSession = std::async(std::launch::async, []
+    {
+        KHOLST_PROFILER_ZONE_COLOR("Slang create global session", KHOLST_PROFILER_COLOR_SHADER);
+
+        Slang::ComPtr<slang::IGlobalSession> created;
+        if (SLANG_FAILED(slang::createGlobalSession(created.writeRef())))
+            created = nullptr;
+        return created;
+    }).share();
+
+    compileTarget = target;
+    sessionDefines = defines;
+    initialized = true;
+    return true;
+}
+
+bool SlangCompiler::initialize(const SlangCompiler& prototype, const std::vector<ShaderDefine>& defines)
+{
+    if (initialized)
+        return true;
+
+    compileTarget = prototype.compileTarget;
+    profileName = prototype.profileName;
+    sessionDefines = defines;
+
+    const bool pending = prototype.pendingGlobalSession.valid() &&
+        prototype.pendingGlobalSession.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    if (pending)
+    {
+        pendingGlobalSession = prototype.pendingGlobalSession;
+        initialized = true;
+        return true;
+    }
+
+    globalSession = prototype.getGlobalSession();
+    if (!globalSession)
+    {
+        initialized = true;
+        return true;
+    }
+
+    return createSession();
+}
+
+bool SlangCompiler::initialize(
+    std::shared_ptr<const ShaderArchive> sharedArchive,
+    SlangCompileTarget target,
+    const std::vector<ShaderDefine>& defines
+)
+{
+    if (initialized)
+        return true;
+
+    if (!sharedArchive)
+    {
+        lastDiagnostics = "Shader archive is null";
+        return false;
+    }
+
+    archive = std::move(sharedArchive);
+    compileTarget = target;
+    sessionDefines = defines;
+    initialized = true;
+    return true;
+}
+
+void SlangCompiler::enableArchive(std::shared_ptr<const ShaderArchive> sharedArchive)
+{
+    archive = std::move(sharedArchive);
+}
+
+slang::IGlobalSession* SlangCompiler::getGlobalSession() const
+{
+    if (pendingGlobalSession.valid())
+        return pendingGlobalSession.get().get();
+    return globalSession.get();
+}
+
+bool SlangCompiler::createSession()
+{
+    slang::IGlobalSession* global = getGlobalSession();
+    if (!global)
+    {
+        lastDiagnostics = pendingGlobalSession.valid() ?
+            "Failed to create Slang global session" : "Slang is not initialized";
+        return false;
+    }
+
     // Configure session description
     slang::TargetDesc targetDesc = {
-        .format = target,
-        .profile = globalSession->findProfile("spirv_1_5"),
+        .format = compileTarget,
+        .profile = global->findProfile(profileName.c_str()),
     };
 
+    std::vector<slang::PreprocessorMacroDesc> macros;
+    macros.reserve(sessionDefines.size());
+    for (const ShaderDefine& define : sessionDefines)
+        macros.push_back({ .name = define.name.c_str(), .value = define.value.c_str() });
+
     slang::SessionDesc sessionDesc = {
         .targets = &targetDesc,
         .targetCount = 1,
+        .preprocessorMacros = macros.data(),
+        .preprocessorMacroCount = (SlangInt)macros.size(),
     };
     
     // Add common search paths if needed
@@ -42,7 +185,7 @@ bool SlangCompiler::initialize(SlangCompileTarget target)
     // sessionDesc.searchPathCount = searchPathCount;
 
     // Create session
-    if (SLANG_FAILED(globalSession->createSession(sessionDesc, session.writeRef())))
+    if (SLANG_FAILED(global->createSession(sessionDesc, session.writeRef())))
     {
         lastDiagnostics = "Failed to create Slang session";
         return false;
@@ -52,11 +195,59 @@ bool SlangCompiler::initialize(SlangCompileTarget target)
     return true;
 }
 
+bool SlangCompiler::resetSession()
+{
+    if (!initialized || !getGlobalSession())
+        return false;
+
+    initialized = false;
+    loadedModules.clear();
+    session = nullptr;
+    return createSession();
+}
+
+void SlangCompiler::enableCache(const std::string& directory)
+{
+    cache = std::make_shared<SpirvCache>(directory);
+}
+
+void SlangCompiler::enableCache(std::shared_ptr<SpirvCache> sharedCache)
+{
+    cache = std::move(sharedCache);
+}
+
+SpirvCache::Stats SlangCompiler::getCacheStats() const
+{
+    return cache ? cache->getStats() : SpirvCache::Stats{};
+}
+
+uint64_t SlangCompiler::computeCacheKey(
+    const std::string& shaderCode,
+    const std::string& entryPoint,
+    SlangStage stage
+) const
+{
+    core::Hasher hasher;
+    hasher.add(CACHE_KEY_VERSION);
+    hasher.add(spGetBuildTagString());
+    hasher.add(shaderCode);
+    hasher.add(entryPoint);
+    hasher.add(stage);
+    hasher.add(compileTarget);
+    hasher.add(profileName);
+    for (const ShaderDefine& define : sessionDefines)
+    {
+        hasher.add(define.name);
+        hasher.add(define.value);
+    }
+    return hasher.finish();
+}
+
 bool SlangCompiler::compileToSPIRV(
     const std::string& shaderPath,
     const std::string& entryPoint,
     SlangStage stage,
-    std::vector<uint32_t>& outSpirv,
+    CompiledShader& outShader,
     std::string& outErrorMsg
 )
 {
@@ -66,15 +257,34 @@ bool SlangCompiler::compileToSPIRV(
         return false;
     }
 
-    return compileEntryPoint(shaderPath, entryPoint, stage, outSpirv, outErrorMsg);
+    std::vector<CompiledShader> shaders;
+    if (!compileModule(shaderPath, { { .name = entryPoint, .stage = stage } }, shaders, outErrorMsg))
+        return false;
+
+    outShader = std::move(shaders[0]);
+    return true;
 }
 
-bool SlangCompiler::compileVertexFragment(
+bool SlangCompiler::compileToSPIRV(
     const std::string& shaderPath,
-    const std::string& vertexEntry,
-    const std::string& fragmentEntry,
-    std::vector<uint32_t>& outVertexSpirv,
-    std::vector<uint32_t>& outFragmentSpirv,
+    const std::string& entryPoint,
+    SlangStage stage,
+    std::vector<uint32_t>& outSpirv,
+    std::string& outErrorMsg
+)
+{
+    CompiledShader shader;
+    if (!compileToSPIRV(shaderPath, entryPoint, stage, shader, outErrorMsg))
+        return false;
+
+    outSpirv = shader.toVector();
+    return true;
+}
+
+bool SlangCompiler::compileEntryPoints(
+    const std::string& shaderPath,
+    const std::vector<EntryPointDesc>& entryPoints,
+    std::vector<CompiledShader>& outShaders,
     std::string& outErrorMsg
 )
 {
@@ -84,87 +294,184 @@ bool SlangCompiler::compileVertexFragment(
         return false;
     }
 
-    // Compile vertex shader
-    if (!compileEntryPoint(shaderPath, vertexEntry, SLANG_STAGE_VERTEX, outVertexSpirv, outErrorMsg))
+    if (entryPoints.empty())
+    {
+        outErrorMsg = "No entry points requested for " + shaderPath;
         return false;
+    }
 
-    // Compile fragment shader
-    if (!compileEntryPoint(shaderPath, fragmentEntry, SLANG_STAGE_FRAGMENT, outFragmentSpirv, outErrorMsg))
+    return compileModule(shaderPath, entryPoints, outShaders, outErrorMsg);
+}
+
+bool SlangCompiler::compileVertexFragment(
+    const std::string& shaderPath,
+    const std::string& vertexEntry,
+    const std::string& fragmentEntry,
+    CompiledShader& outVertexShader,
+    CompiledShader& outFragmentShader,
+    std::string& outErrorMsg
+)
+{
+    std::vector<CompiledShader> shaders;
+    if (!compileEntryPoints(
+        shaderPath,
+        {
+            { .name = vertexEntry, .stage = SLANG_STAGE_VERTEX },
+            { .name = fragmentEntry, .stage = SLANG_STAGE_FRAGMENT },
+        },
+        shaders,
+        outErrorMsg))
+    {
         return false;
+    }
 
+    outVertexShader = std::move(shaders[0]);
+    outFragmentShader = std::move(shaders[1]);
     return true;
 }
 
-bool SlangCompiler::compileEntryPoint(
+bool SlangCompiler::compileVertexFragment(
     const std::string& shaderPath,
-    const std::string& entryPoint,
-    SlangStage stage,
-    std::vector<uint32_t>& outSpirv,
+    const std::string& vertexEntry,
+    const std::string& fragmentEntry,
+    std::vector<uint32_t>& outVertexSpirv,
+    std::vector<uint32_t>& outFragmentSpirv,
     std::string& outErrorMsg
 )
 {
-    lastDiagnostics.clear();
-
-    // Read shader file
-    std::ifstream file(shaderPath, std::ios::binary);
-    if (!file.is_open())
-    {
-        outErrorMsg = "Failed to open shader file: " + shaderPath;
+    CompiledShader vertexShader;
+    CompiledShader fragmentShader;
+    if (!compileVertexFragment(shaderPath, vertexEntry, fragmentEntry, vertexShader, fragmentShader, outErrorMsg))
         return false;
-    }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string shaderCode = buffer.str();
+    outVertexSpirv = vertexShader.toVector();
+    outFragmentSpirv = fragmentShader.toVector();
+    return true;
+}
+
+void SlangCompiler::appendDiagnostics(slang::IBlob* diagnostics)
+{
+    if (!diagnostics)
+        return;
 
-    // Load the module
-    Slang::ComPtr<slang::IBlob> diagnosticsBlob;
-    slang::IModule* module = session->loadModule(
-        shaderPath.c_str(),
-        diagnosticsBlob.writeRef()
+    lastDiagnostics.append(
+        (const char*)diagnostics->getBufferPointer(),
+        diagnostics->getBufferSize()
     );
+}
+
+SlangCompiler::LoadedModule* SlangCompiler::findOrLoadModule(const std::string& shaderPath, std::string& outErrorMsg)
+{
+    const std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+
+    auto it = loadedModules.find(shaderPath);
+    if (it != loadedModules.end())
+    {
+        bool upToDate = true;
+        for (const auto& [path, time] : it->second.fileTimes)
+            upToDate = upToDate && queryFileTime(path) == time;
+
+        if (upToDate)
+        {
+            sessionStats.moduleHits++;
+            lastTimings.loadMs = millisecondsSince(stageStart);
+            return &it->second;
+        }
+
+        // The session would hand back the module it loaded before, and every
+        // module importing the edited file is just as stale
+        sessionStats.staleSessions++;
+        if (!resetSession())
+        {
+            outErrorMsg = "Failed to recreate Slang session\n" + lastDiagnostics;
+            return nullptr;
+        }
+    }
 
-    if (diagnosticsBlob)
+    slang::IModule* module = nullptr;
     {
-        lastDiagnostics = std::string(
-            (const char*)diagnosticsBlob->getBufferPointer(),
-            diagnosticsBlob->getBufferSize()
+        KHOLST_PROFILER_ZONE("Slang load");
+        Slang::ComPtr<slang::IBlob> diagnosticsBlob;
+        module = session->loadModule(
+            shaderPath.c_str(),
+            diagnosticsBlob.writeRef()
         );
+        appendDiagnostics(diagnosticsBlob);
     }
 
     if (!module)
     {
         outErrorMsg = "Failed to load module: " + shaderPath + "\n" + lastDiagnostics;
-        return false;
+        return nullptr;
     }
 
-    // Find entry point
-    Slang::ComPtr<slang::IEntryPoint> entryPointObj;
-    module->findAndCheckEntryPoint(entryPoint.c_str(), stage, entryPointObj.writeRef(),
-        diagnosticsBlob.writeRef());
+    LoadedModule loaded;
+    loaded.module = module;
+    loaded.fileTimes.emplace_back(shaderPath, queryFileTime(shaderPath));
+    for (SlangInt32 i = 0; i < module->getDependencyFileCount(); i++)
+    {
+        const char* dependency = module->getDependencyFilePath(i);
+        if (dependency && shaderPath != dependency)
+        {
+            loaded.dependencies.emplace_back(dependency);
+            loaded.fileTimes.emplace_back(dependency, queryFileTime(dependency));
+        }
+    }
 
-    if (diagnosticsBlob)
+    lastTimings.loadMs = millisecondsSince(stageStart);
+    return &(loadedModules[shaderPath] = std::move(loaded));
+}
+
+slang::IComponentType* SlangCompiler::findOrLinkProgram(
+    LoadedModule& loaded,
+    const std::string& shaderPath,
+    const std::vector<EntryPointDesc>& entryPoints,
+    std::string& outErrorMsg
+)
+{
+    core::Hasher hasher;
+    for (const EntryPointDesc& entryPoint : entryPoints)
     {
-        lastDiagnostics = std::string(
-            (const char*)diagnosticsBlob->getBufferPointer(),
-            diagnosticsBlob->getBufferSize()
-        );
+        hasher.add(entryPoint.name);
+        hasher.add(entryPoint.stage);
     }
+    const uint64_t programKey = hasher.finish();
 
-    if (!entryPointObj)
+    auto it = loaded.programs.find(programKey);
+    if (it != loaded.programs.end())
     {
-        outErrorMsg = "Failed to find entry point: " + entryPoint + " in " + shaderPath + "\n" + lastDiagnostics;
-        return false;
+        sessionStats.programHits++;
+        return it->second;
+    }
+
+    // Find entry points
+    std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+    std::vector<Slang::ComPtr<slang::IEntryPoint>> entryPointObjs(entryPoints.size());
+    for (size_t i = 0; i < entryPoints.size(); i++)
+    {
+        Slang::ComPtr<slang::IBlob> entryDiagnostics;
+        loaded.module->findAndCheckEntryPoint(entryPoints[i].name.c_str(), entryPoints[i].stage,
+            entryPointObjs[i].writeRef(), entryDiagnostics.writeRef());
+        appendDiagnostics(entryDiagnostics);
+
+        if (!entryPointObjs[i])
+        {
+            outErrorMsg = "Failed to find entry point: " + entryPoints[i].name + " in " + shaderPath + "\n" + lastDiagnostics;
+            return nullptr;
+        }
     }
 
-    // Create component type list for linking
+    // Create component type list for linking, entry point i lands at index i
     std::vector<slang::IComponentType*> componentTypes;
-    componentTypes.push_back(module);
-    componentTypes.push_back(entryPointObj);
+    componentTypes.reserve(entryPoints.size() + 1);
+    componentTypes.push_back(loaded.module);
+    for (const Slang::ComPtr<slang::IEntryPoint>& entryPointObj : entryPointObjs)
+        componentTypes.push_back(entryPointObj);
 
     // Create composite component type (linked program)
     Slang::ComPtr<slang::IComponentType> composedProgram;
     {
+        KHOLST_PROFILER_ZONE("Slang compose");
         Slang::ComPtr<slang::IBlob> composeDiagnostics;
         SlangResult result = session->createCompositeComponentType(
             componentTypes.data(),
@@ -172,138 +479,212 @@ bool SlangCompiler::compileEntryPoint(
             composedProgram.writeRef(),
             composeDiagnostics.writeRef()
         );
-
-        if (composeDiagnostics)
-        {
-            std::string diag(
-                (const char*)composeDiagnostics->getBufferPointer(),
-                composeDiagnostics->getBufferSize()
-            );
-            lastDiagnostics += diag;
-        }
+        appendDiagnostics(composeDiagnostics);
 
         if (SLANG_FAILED(result))
         {
             outErrorMsg = "Failed to compose program\n" + lastDiagnostics;
-            return false;
+            return nullptr;
         }
     }
+    lastTimings.composeMs = millisecondsSince(stageStart);
 
     // Link the program
     Slang::ComPtr<slang::IComponentType> linkedProgram;
+    stageStart = std::chrono::steady_clock::now();
     {
+        KHOLST_PROFILER_ZONE("Slang link");
         Slang::ComPtr<slang::IBlob> linkDiagnostics;
         SlangResult result = composedProgram->link(linkedProgram.writeRef(), linkDiagnostics.writeRef());
+        appendDiagnostics(linkDiagnostics);
 
-        if (linkDiagnostics)
+        if (SLANG_FAILED(result))
         {
-            std::string diag(
-                (const char*)linkDiagnostics->getBufferPointer(),
-                linkDiagnostics->getBufferSize()
-            );
-            lastDiagnostics += diag;
+            outErrorMsg = "Failed to link program\n" + lastDiagnostics;
+            return nullptr;
         }
+    }
+    lastTimings.linkMs = millisecondsSince(stageStart);
 
-        if (SLANG_FAILED(result))
+    return loaded.programs[programKey] = linkedProgram;
+}
+
+SlangCompiler::FileTime SlangCompiler::queryFileTime(const std::string& path)
+{
+    std::error_code error;
+    const FileTime time = std::filesystem::last_write_time(path, error);
+    return error ? FileTime::min() : time;
+}
+
+bool SlangCompiler::compileModule(
+    const std::string& shaderPath,
+    const std::vector<EntryPointDesc>& entryPoints,
+    std::vector<CompiledShader>& outShaders,
+    std::string& outErrorMsg
+)
+{
+    KHOLST_PROFILER_ZONE_COLOR("Slang compile module", KHOLST_PROFILER_COLOR_SHADER);
+    KHOLST_PROFILER_ZONE_TEXT(shaderPath.c_str(), shaderPath.size());
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point stageStart = startTime;
+
+    lastTimings = {};
+    lastDiagnostics.clear();
+    lastDependencies.assign(1, shaderPath);
+    outShaders.assign(entryPoints.size(), {});
+
+    if (archive)
+    {
+        KHOLST_PROFILER_ZONE("Shader archive lookup");
+
+        bool allFound = true;
+        for (size_t i = 0; i < entryPoints.size() && allFound; i++)
+            allFound = archive->find(ShaderArchive::computeKey(shaderPath, entryPoints[i], compileTarget, profileName, sessionDefines), outShaders[i]);
+
+        if (allFound)
         {
-            outErrorMsg = "Failed to link program\n" + lastDiagnostics;
-            return false;
+            lastTimings.archiveHit = true;
+            lastTimings.totalMs = millisecondsSince(startTime);
+            return true;
         }
+        outShaders.assign(entryPoints.size(), {});
     }
 
-    // Print reflection information
+    // The source is only needed to key the cache, Slang reads the file itself
+    std::vector<uint64_t> cacheKeys;
+    if (cache)
     {
-        slang::ProgramLayout* layout = linkedProgram->getLayout();
-        if (layout)
+        KHOLST_PROFILER_ZONE("Slang cache lookup");
+
+        std::ifstream file(shaderPath, std::ios::binary);
+        if (!file.is_open())
         {
-            std::cout << "=== Shader Reflection: " << entryPoint << " ===" << std::endl;
-            
-            // Print entry point info
-            unsigned int entryPointCount = layout->getEntryPointCount();
-            std::cout << "Entry Points: " << entryPointCount << std::endl;
-            
-            for (unsigned int i = 0; i < entryPointCount; i++)
+            outErrorMsg = "Failed to open shader file: " + shaderPath;
+            return false;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string shaderCode = buffer.str();
+
+        bool allHit = true;
+        std::vector<std::string> cachedDependencies;
+        cacheKeys.reserve(entryPoints.size());
+        for (size_t i = 0; i < entryPoints.size(); i++)
+        {
+            cacheKeys.push_back(computeCacheKey(shaderCode, entryPoints[i].name, entryPoints[i].stage));
+
+            std::vector<uint32_t> words;
+            std::vector<uint8_t> metadata;
+            std::shared_ptr<ShaderReflection> reflection = std::make_shared<ShaderReflection>();
+            if (cache->load(cacheKeys.back(), words, &cachedDependencies, &metadata) &&
+                deserializeReflection(metadata.data(), metadata.size(), *reflection))
             {
-                slang::EntryPointLayout* ep = layout->getEntryPointByIndex(i);
-                const char* epName = ep->getName();
-                SlangStage epStage = ep->getStage();
-                
-                const char* stageName = "unknown";
-                switch (epStage)
-                {
-                    case SLANG_STAGE_VERTEX: stageName = "vertex"; break;
-                    case SLANG_STAGE_FRAGMENT: stageName = "fragment"; break;
-                    case SLANG_STAGE_COMPUTE: stageName = "compute"; break;
-                    case SLANG_STAGE_GEOMETRY: stageName = "geometry"; break;
-                    case SLANG_STAGE_HULL: stageName = "hull"; break;
-                    case SLANG_STAGE_DOMAIN: stageName = "domain"; break;
-                    default: break;
-                }
-                
-                std::cout << "  [" << i << "] " << epName << " (" << stageName << ")" << std::endl;
+                outShaders[i] = CompiledShader(std::move(words), std::move(reflection));
             }
-            
-            // Print global parameters
-            unsigned int globalParamCount = layout->getParameterCount();
-            if (globalParamCount > 0)
+            else
             {
-                std::cout << "Global Parameters: " << globalParamCount << std::endl;
-                
-                for (unsigned int i = 0; i < globalParamCount; i++)
-                {
-                    slang::VariableLayoutReflection* param = layout->getParameterByIndex(i);
-                    const char* paramName = param->getName();
-                    slang::TypeReflection* paramType = param->getType();
-                    const char* typeName = paramType ? paramType->getName() : "unknown";
-                    
-                    std::cout << "  [" << i << "] " << paramName << " : " << typeName << std::endl;
-                }
+                allHit = false;
             }
-            
-            std::cout << "================================" << std::endl;
+        }
+
+        lastTimings.cacheLookupMs = millisecondsSince(stageStart);
+        if (allHit)
+        {
+            // Entry points of one module share their imports
+            lastDependencies.insert(lastDependencies.end(), cachedDependencies.begin(), cachedDependencies.end());
+            lastTimings.cacheHit = true;
+            lastTimings.totalMs = millisecondsSince(startTime);
+            KHOLST_PROFILER_PLOT("Shader cache hits", (int64_t)cache->getStats().hits);
+            return true;
         }
     }
 
-    // Get the compiled code
-    Slang::ComPtr<slang::IBlob> spirvCode;
+    // Deferred by initializeAsync(), or no Slang at all behind an archive
+    if (!session)
     {
-        Slang::ComPtr<slang::IBlob> getDiagnostics;
-        SlangResult result = linkedProgram->getEntryPointCode(
-            0, // Entry point index (we only have one in the linked program)
-            0, // Target index
-            spirvCode.writeRef(),
-            getDiagnostics.writeRef()
-        );
+        KHOLST_PROFILER_ZONE("Wait for Slang session");
 
-        if (getDiagnostics)
+        const std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+        if (!createSession())
         {
-            std::string diag(
-                (const char*)getDiagnostics->getBufferPointer(),
-                getDiagnostics->getBufferSize()
+            outErrorMsg = shaderPath + " is not in the shader archive or cache: " + lastDiagnostics;
+            return false;
+        }
+        lastTimings.sessionWaitMs = millisecondsSince(waitStart);
+    }
+
+    LoadedModule* loaded = findOrLoadModule(shaderPath, outErrorMsg);
+    if (!loaded)
+        return false;
+
+    // Imported modules are only known after loading, they are recorded so
+    // cache entries are invalidated when any of them changes
+    const std::vector<std::string>& dependencies = loaded->dependencies;
+    lastDependencies.insert(lastDependencies.end(), dependencies.begin(), dependencies.end());
+
+    slang::IComponentType* linkedProgram = findOrLinkProgram(*loaded, shaderPath, entryPoints, outErrorMsg);
+    if (!linkedProgram)
+        return false;
+
+    slang::ProgramLayout* layout = linkedProgram->getLayout();
+    if (dumpReflection && layout)
+    {
+        ShaderReflection programReflection;
+        buildReflection(layout, -1, programReflection);
+        KHOLST_LOGL("=== Shader Reflection: %s ===\n%s================================\n",
+            shaderPath.c_str(), reflectionToString(programReflection).c_str());
+    }
+
+    // Get the compiled code
+    for (size_t i = 0; i < entryPoints.size(); i++)
+    {
+        Slang::ComPtr<slang::IBlob> spirvCode;
+        stageStart = std::chrono::steady_clock::now();
+        {
+            KHOLST_PROFILER_ZONE("Slang codegen");
+            Slang::ComPtr<slang::IBlob> getDiagnostics;
+            SlangResult result = linkedProgram->getEntryPointCode(
+                (SlangInt)i, // Entry point index, matches the composition order
+                0, // Target index
+                spirvCode.writeRef(),
+                getDiagnostics.writeRef()
             );
-            lastDiagnostics += diag;
+            appendDiagnostics(getDiagnostics);
+
+            if (SLANG_FAILED(result) || !spirvCode)
+            {
+                outErrorMsg = "Failed to get compiled code for " + entryPoints[i].name + "\n" + lastDiagnostics;
+                return false;
+            }
         }
+        lastTimings.codegenMs += millisecondsSince(stageStart);
 
-        if (SLANG_FAILED(result) || !spirvCode)
+        size_t spirvSize = spirvCode->getBufferSize();
+
+        if (spirvSize % 4 != 0)
         {
-            outErrorMsg = "Failed to get compiled code\n" + lastDiagnostics;
+            outErrorMsg = "Invalid SPIRV size (not multiple of 4 bytes)";
             return false;
         }
-    }
 
-    // Copy SPIRV data to output vector
-    const uint32_t* spirvData = (const uint32_t*)spirvCode->getBufferPointer();
-    size_t spirvSize = spirvCode->getBufferSize();
-    
-    if (spirvSize % 4 != 0)
-    {
-        outErrorMsg = "Invalid SPIRV size (not multiple of 4 bytes)";
-        return false;
-    }
+        std::shared_ptr<ShaderReflection> reflection = std::make_shared<ShaderReflection>();
+        buildReflection(layout, (int)i, *reflection);
 
-    outSpirv.resize(spirvSize / 4);
-    std::memcpy(outSpirv.data(), spirvData, spirvSize);
+        if (cache)
+        {
+            const std::span<const uint32_t> spirv = { (const uint32_t*)spirvCode->getBufferPointer(), spirvSize / 4 };
+            cache->store(cacheKeys[i], dependencies, spirv.data(), spirv.size(), serializeReflection(*reflection));
+        }
+
+        // Keep the blob alive instead of copying it out
+        outShaders[i] = CompiledShader(std::move(spirvCode), std::move(reflection));
+    }
 
+    lastTimings.totalMs = millisecondsSince(startTime);
+    KHOLST_PROFILER_PLOT("Shader compile ms", lastTimings.totalMs);
+    if (cache)
+        KHOLST_PROFILER_PLOT("Shader cache misses", (int64_t)cache->getStats().misses);
     return true;
 }
 
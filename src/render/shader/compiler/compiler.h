@@ -1,10 +1,20 @@
 #pragma once
 
-#include <slang.h>
-#include <slang-com-ptr.h>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <slang.h>
+#include <slang-com-ptr.h>
+
+#include "compiled_shader.h"
+#include "render/shader/cache/spirv_cache.h"
+
 
 namespace kholst
 {
@@ -13,16 +23,158 @@ namespace render
 namespace shader
 {
 
+class ShaderArchive;
+
+// Preprocessor macro applied to every module compiled by a session
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+// Entry point to pull out of a module
+struct EntryPointDesc
+{
+    std::string name;
+    SlangStage stage = SLANG_STAGE_NONE;
+};
+
+// One module and the entry points to compile from it
+struct ShaderCompileJob
+{
+    std::string shaderPath;
+    std::vector<EntryPointDesc> entryPoints;
+};
+
+// Wall time of each stage of one module compilation, zero for skipped stages
+struct ShaderCompileTimings
+{
+    double cacheLookupMs = 0.0;
+    double loadMs = 0.0;
+    double composeMs = 0.0; // Entry point lookup and composition
+    double linkMs = 0.0;
+    double codegenMs = 0.0; // Summed over entry points
+    double sessionWaitMs = 0.0; // Waiting for a deferred Slang session, see initializeAsync()
+    double totalMs = 0.0;
+    bool cacheHit = false; // Every entry point came from the SPIR-V cache
+    bool archiveHit = false; // Every entry point came from the shader archive
+};
+
+struct ShaderCompileResult
+{
+    bool success = false;
+    std::vector<CompiledShader> shaders; // One per requested entry point
+    std::string errorMsg;
+    std::string diagnostics;
+};
+
 class SlangCompiler
 {
 public:
+    // Reuse of modules and linked programs within the current session
+    struct SessionStats
+    {
+        uint64_t moduleHits = 0; // Module already loaded and unchanged on disk
+        uint64_t programHits = 0; // Entry point set already linked
+        uint64_t staleSessions = 0; // Sessions recreated because a loaded file changed
+    };
+
     SlangCompiler();
     ~SlangCompiler();
 
     // Initialize the compiler with target settings
-    bool initialize(SlangCompileTarget target = SLANG_SPIRV);
+    bool initialize(
+        SlangCompileTarget target = SLANG_SPIRV,
+        const std::vector<ShaderDefine>& defines = {}
+    );
+
+    /**
+     * @brief Initialize with a session created from an existing global session
+     *
+     * Creating the global session loads the Slang core module and dominates
+     * initialization time, so compilers used on worker threads share one.
+     * The global session is not thread-safe: callers must serialize calls to
+     * this function for compilers sharing it.
+     */
+    bool initialize(
+        slang::IGlobalSession* sharedGlobalSession,
+        SlangCompileTarget target = SLANG_SPIRV,
+        const std::vector<ShaderDefine>& defines = {}
+    );
+
+    /**
+     * @brief Initialize right away, creating the Slang global session on a background thread
+     *
+     * Creating the global session takes hundreds of milliseconds, and with an
+     * archive or a warm cache it is often not needed at all. Lookups work
+     * immediately; the session is created on the first miss, which blocks
+     * until the global session is ready. getGlobalSession() blocks as well.
+     * Creation failures are reported by the first compilation that misses.
+     */
+    bool initializeAsync(
+        SlangCompileTarget target = SLANG_SPIRV,
+        const std::vector<ShaderDefine>& defines = {}
+    );
+
+    /**
+     * @brief Initialize with the global session and target of another compiler
+     *
+     * Does not wait for a global session the prototype is still creating:
+     * the session is then deferred to the first miss, like initializeAsync().
+     * A prototype without Slang gives a compiler without Slang, which needs
+     * enableArchive(). Deferred sessions are created on the thread that
+     * misses, so compilers sharing a global session must not miss concurrently.
+     */
+    bool initialize(const SlangCompiler& prototype, const std::vector<ShaderDefine>& defines);
+
+    /**
+     * @brief Initialize without Slang, serving every compilation from an archive
+     *
+     * No global session or session is created, so Slang is never
+     * initialized. Entry points missing from the archive fail to compile.
+     */
+    bool initialize(
+        std::shared_ptr<const ShaderArchive> archive,
+        SlangCompileTarget target = SLANG_SPIRV,
+        const std::vector<ShaderDefine>& defines = {}
+    );
+
+    /**
+     * @brief Look up entry points in a baked archive before anything else
+     *
+     * Keyed by module path, entry point, target, profile and defines, see
+     * ShaderArchive::computeKey(). Misses fall through to the SPIR-V cache
+     * and Slang, if the compiler has a session.
+     */
+    void enableArchive(std::shared_ptr<const ShaderArchive> archive);
+
+    /**
+     * @brief Enable the persistent SPIR-V cache
+     *
+     * Once enabled, every entry point compilation first looks for a blob keyed
+     * by the module source, entry point, stage, target, profile and defines.
+     * On a hit the Slang session is not touched at all.
+     *
+     * @param directory Directory holding cache entries, created if missing
+     */
+    void enableCache(const std::string& directory);
+
+    // Share an existing cache, e.g. between compilers of a batch
+    void enableCache(std::shared_ptr<SpirvCache> sharedCache);
+
+    // Cache hit/miss counters, all zero if the cache is disabled
+    SpirvCache::Stats getCacheStats() const;
 
     // Compile a Slang shader file to SPIRV
+    bool compileToSPIRV(
+        const std::string& shaderPath,
+        const std::string& entryPoint,
+        SlangStage stage,
+        CompiledShader& outShader,
+        std::string& outErrorMsg
+    );
+
+    // Same as above, copying the code into a vector
     bool compileToSPIRV(
         const std::string& shaderPath,
         const std::string& entryPoint,
@@ -31,7 +183,38 @@ public:
         std::string& outErrorMsg
     );
 
+    /**
+     * @brief Compile several entry points of one module in a single pass
+     *
+     * The module is loaded once and a single composite holding every requested
+     * entry point is linked; code for each entry point is then pulled by index.
+     * Entry points already present in the cache are not recompiled, but if any
+     * of them misses the whole set is linked together.
+     *
+     * @param shaderPath Path to the Slang module
+     * @param entryPoints Entry points to compile, any mix of stages
+     * @param outShaders Receives one compiled shader per entry point, in request order
+     * @param outErrorMsg Error description on failure
+     * @return true if every entry point compiled
+     */
+    bool compileEntryPoints(
+        const std::string& shaderPath,
+        const std::vector<EntryPointDesc>& entryPoints,
+        std::vector<CompiledShader>& outShaders,
+        std::string& outErrorMsg
+    );
+
     // Compile vertex and fragment shaders from a single Slang file
+    bool compileVertexFragment(
+        const std::string& shaderPath,
+        const std::string& vertexEntry,
+        const std::string& fragmentEntry,
+        CompiledShader& outVertexShader,
+        CompiledShader& outFragmentShader,
+        std::string& outErrorMsg
+    );
+
+    // Same as above, copying the code into vectors
     bool compileVertexFragment(
         const std::string& shaderPath,
         const std::string& vertexEntry,
@@ -41,29 +224,104 @@ public:
         std::string& outErrorMsg
     );
 
+    // Log the reflection of every linked program, off by default
+    void setReflectionDump(bool enabled) { dumpReflection = enabled; }
+
     // Get diagnostics from the last compilation
     std::string getLastDiagnostics() const;
 
+    // Files the last compiled module was built from: the module itself first,
+    // followed by every module it imports
+    const std::vector<std::string>& getLastDependencies() const { return lastDependencies; }
+
+    // Stage timings of the last successful compilation
+    const ShaderCompileTimings& getLastTimings() const { return lastTimings; }
+
+    /**
+     * @brief Drop every module loaded so far by recreating the session
+     *
+     * Slang sessions cache loaded modules by name and never reload them.
+     * Compiling a module whose file or imports changed on disk since it was
+     * loaded does this automatically; call it to force a clean session.
+     */
+    bool resetSession();
+
+    SessionStats getSessionStats() const { return sessionStats; }
+
     // Check if the compiler is initialized
     bool isInitialized() const { return initialized; }
 
+    // Blocks while a global session started by initializeAsync() is being created
+    slang::IGlobalSession* getGlobalSession() const;
+    SlangCompileTarget getTarget() const { return compileTarget; }
+    const std::string& getProfile() const { return profileName; }
+    const std::vector<ShaderDefine>& getDefines() const { return sessionDefines; }
+    const std::shared_ptr<SpirvCache>& getCache() const { return cache; }
+    const std::shared_ptr<const ShaderArchive>& getArchive() const { return archive; }
+
 private:
     Slang::ComPtr<slang::IGlobalSession> globalSession;
+    std::shared_future<Slang::ComPtr<slang::IGlobalSession>> pendingGlobalSession; // Set instead by initializeAsync()
     Slang::ComPtr<slang::ISession> session;
     bool initialized = false;
     std::string lastDiagnostics;
+    std::vector<std::string> lastDependencies;
+    ShaderCompileTimings lastTimings;
 
-    // Helper to create a compilation request
-    bool compileEntryPoint(
-        const std::string& shaderPath,
+    SlangCompileTarget compileTarget = SLANG_SPIRV;
+    std::string profileName = "spirv_1_5";
+    std::vector<ShaderDefine> sessionDefines;
+    std::shared_ptr<SpirvCache> cache;
+    std::shared_ptr<const ShaderArchive> archive;
+    bool dumpReflection = false;
+
+    using FileTime = std::filesystem::file_time_type;
+
+    // A module loaded by the current session and the programs linked from it.
+    // Linked programs are keyed by the hash of their entry point set.
+    struct LoadedModule
+    {
+        Slang::ComPtr<slang::IModule> module;
+        std::vector<std::string> dependencies; // Imported files
+        std::vector<std::pair<std::string, FileTime>> fileTimes; // Module and imports when loaded
+        std::unordered_map<uint64_t, Slang::ComPtr<slang::IComponentType>> programs;
+    };
+    std::unordered_map<std::string, LoadedModule> loadedModules;
+    SessionStats sessionStats;
+
+    // Key of a cache entry; does not include specialization constant values,
+    // those are applied at pipeline creation and do not change the SPIR-V
+    uint64_t computeCacheKey(
+        const std::string& shaderCode,
         const std::string& entryPoint,
-        SlangStage stage,
-        std::vector<uint32_t>& outSpirv,
+        SlangStage stage
+    ) const;
+
+    // Load, compose and link the module with all entry points, then fetch code
+    bool compileModule(
+        const std::string& shaderPath,
+        const std::vector<EntryPointDesc>& entryPoints,
+        std::vector<CompiledShader>& outShaders,
         std::string& outErrorMsg
     );
+
+    // Module from the session if its files are unchanged, loading it otherwise
+    LoadedModule* findOrLoadModule(const std::string& shaderPath, std::string& outErrorMsg);
+
+    // Linked program of the entry point set, composing and linking it on first use
+    slang::IComponentType* findOrLinkProgram(
+        LoadedModule& loaded,
+        const std::string& shaderPath,
+        const std::vector<EntryPointDesc>& entryPoints,
+        std::string& outErrorMsg
+    );
+
+    static FileTime queryFileTime(const std::string& path);
+
+    bool createSession();
+    void appendDiagnostics(slang::IBlob* diagnostics);
 };
 
 } // namespace shader
 } // namespace render
 } // namespace kholst
-
@@ -0,0 +1,196 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+// Editors often save in several writes, give them a moment before compiling
+static constexpr std::chrono::milliseconds SETTLE_DELAY{ 50 };
+
+ShaderWatcher::ShaderWatcher() = default;
+
+ShaderWatcher::~ShaderWatcher()
+{
+    stop();
+}
+
+void ShaderWatcher::start(const SlangCompiler& prototype, std::chrono::milliseconds interval)
+{
+    if (running)
+        return;
+
+    target = prototype.getTarget();
+    defines = prototype.getDefines();
+    cache = prototype.getCache();
+    pollInterval = interval;
+
+    running = true;
+    thread = std::thread(&ShaderWatcher::threadMain, this);
+}
+
+void ShaderWatcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running = false;
+    }
+    wake.notify_all();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+uint32_t ShaderWatcher::watch(const ShaderCompileJob& job, const std::vector<std::string>& dependencies)
+{
+    std::lock_guard<std::mutex> lock(programsMutex);
+
+    const uint32_t id = nextProgramId++;
+    Program& program = programs[id];
+    program.job = job;
+    program.dependencies = dependencies;
+    if (std::find(program.dependencies.begin(), program.dependencies.end(), job.shaderPath) == program.dependencies.end())
+        program.dependencies.push_back(job.shaderPath);
+
+    for (const std::string& path : program.dependencies)
+        fileTimes.try_emplace(path, queryFileTime(path));
+
+    return id;
+}
+
+std::vector<ShaderReload> ShaderWatcher::consumeReloads()
+{
+    std::lock_guard<std::mutex> lock(reloadsMutex);
+    return std::exchange(reloads, {});
+}
+
+ShaderWatcher::FileTime ShaderWatcher::queryFileTime(const std::string& path)
+{
+    std::error_code ec;
+    const FileTime time = std::filesystem::last_write_time(path, ec);
+    return ec ? FileTime::min() : time;
+}
+
+std::vector<uint32_t> ShaderWatcher::collectChangedPrograms()
+{
+    std::lock_guard<std::mutex> lock(programsMutex);
+
+    std::vector<std::string> changedFiles;
+    for (auto& [path, time] : fileTimes)
+    {
+        const FileTime current = queryFileTime(path);
+
+        // A missing file is usually an editor replacing it, wait for it to return
+        if (current == FileTime::min() || current == time)
+            continue;
+
+        time = current;
+        changedFiles.push_back(path);
+    }
+
+    std::vector<uint32_t> changedPrograms;
+    if (changedFiles.empty())
+        return changedPrograms;
+
+    for (const auto& [id, program] : programs)
+    {
+        const bool affected = std::any_of(program.dependencies.begin(), program.dependencies.end(),
+            [&changedFiles](const std::string& dependency)
+            {
+                return std::find(changedFiles.begin(), changedFiles.end(), dependency) != changedFiles.end();
+            });
+
+        if (affected)
+            changedPrograms.push_back(id);
+    }
+
+    return changedPrograms;
+}
+
+void ShaderWatcher::recompile(uint32_t programId, const ShaderCompileJob& job)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    ShaderReload reload = { .programId = programId };
+    reload.result.success = compiler->compileEntryPoints(job.shaderPath, job.entryPoints, reload.result.shaders, reload.result.errorMsg);
+    reload.result.diagnostics = compiler->getLastDiagnostics();
+
+    // An edit may have added or removed imports
+    if (reload.result.success)
+    {
+        std::lock_guard<std::mutex> lock(programsMutex);
+        programs[programId].dependencies = compiler->getLastDependencies();
+        for (const std::string& path : compiler->getLastDependencies())
+            fileTimes.try_emplace(path, queryFileTime(path));
+    }
+
+    std::lock_guard<std::mutex> lock(reloadsMutex);
+    reloads.push_back(std::move(reload));
+}
+
+void ShaderWatcher::threadMain()
+{
+    KHOLST_PROFILER_THREAD("Shader watcher");
+
+    compiler = std::make_unique<SlangCompiler>();
+    if (!compiler->initialize(target, defines))
+    {
+        ShaderReload reload;
+        reload.result.errorMsg = "Shader watcher failed to initialize: " + compiler->getLastDiagnostics();
+
+        std::lock_guard<std::mutex> lock(reloadsMutex);
+        reloads.push_back(std::move(reload));
+        return;
+    }
+
+    if (cache)
+        compiler->enableCache(cache);
+
+    while (running)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, pollInterval, [this]() { return !running; });
+        }
+
+        if (!running)
+            break;
+
+        std::vector<uint32_t> changedPrograms = collectChangedPrograms();
+        if (changedPrograms.empty())
+            continue;
+
+        // Rescan after the settle delay so writes that landed meanwhile do not
+        // trigger a second reload on the next poll
+        std::this_thread::sleep_for(SETTLE_DELAY);
+        for (uint32_t id : collectChangedPrograms())
+        {
+            if (std::find(changedPrograms.begin(), changedPrograms.end(), id) == changedPrograms.end())
+                changedPrograms.push_back(id);
+        }
+
+        // The compiler notices edited files itself and recreates its session
+        // before recompiling them
+        for (uint32_t id : changedPrograms)
+        {
+            ShaderCompileJob job;
+            {
+                std::lock_guard<std::mutex> lock(programsMutex);
+                job = programs[id].job;
+            }
+            recompile(id, job);
+        }
+    }
+}
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
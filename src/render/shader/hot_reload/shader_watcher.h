@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "render/shader/compiler/compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+// Outcome of recompiling a watched program after one of its files changed
+struct ShaderReload
+{
+    uint32_t programId = 0;
+    ShaderCompileResult result;
+};
+
+/**
+ * @brief Watches Slang modules on disk and recompiles them in the background
+ *
+ * Programs are registered with the files they were built from (see
+ * SlangCompiler::getLastDependencies). A background thread polls their
+ * modification times; when any file of a program changes only that program's
+ * entry points are recompiled. Results are queued until the render thread
+ * picks them up between frames with consumeReloads(), so swapping shader
+ * modules and pipelines never races with command recording.
+ *
+ * The watcher owns a separate compiler with its own global session, created
+ * lazily on the watcher thread, so it never shares Slang state with the
+ * compilers used on the render thread.
+ *
+ * Thread-safety: all public functions may be called from any thread.
+ */
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    /**
+     * @brief Start the watcher thread
+     *
+     * @param prototype Compiler to copy the target, defines and cache from
+     * @param pollInterval Delay between two scans of the watched files
+     */
+    void start(const SlangCompiler& prototype, std::chrono::milliseconds pollInterval = std::chrono::milliseconds(250));
+
+    // Stop and join the watcher thread, pending reloads are kept
+    void stop();
+
+    /**
+     * @brief Register a program for hot reload
+     *
+     * @param job Module and entry points to recompile
+     * @param dependencies Files the program currently depends on
+     * @return Id reported back in ShaderReload::programId
+     */
+    uint32_t watch(const ShaderCompileJob& job, const std::vector<std::string>& dependencies);
+
+    // Take every reload finished since the previous call
+    std::vector<ShaderReload> consumeReloads();
+
+private:
+    using FileTime = std::filesystem::file_time_type;
+
+    struct Program
+    {
+        ShaderCompileJob job;
+        std::vector<std::string> dependencies;
+    };
+
+    std::unique_ptr<SlangCompiler> compiler;
+    SlangCompileTarget target = SLANG_SPIRV;
+    std::vector<ShaderDefine> defines;
+    std::shared_ptr<SpirvCache> cache;
+    std::chrono::milliseconds pollInterval{ 250 };
+
+    std::thread thread;
+    std::atomic<bool> running = false;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    std::mutex programsMutex;
+    std::unordered_map<uint32_t, Program> programs;
+    std::unordered_map<std::string, FileTime> fileTimes;
+    uint32_t nextProgramId = 1;
+
+    std::mutex reloadsMutex;
+    std::vector<ShaderReload> reloads;
+
+    void threadMain();
+    std::vector<uint32_t> collectChangedPrograms();
+    void recompile(uint32_t programId, const ShaderCompileJob& job);
+    static FileTime queryFileTime(const std::string& path);
+};
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,376 @@
+#include "shader_reflection.h"
+
+#include <sstream>
+
+#include "core/binary_stream.h"
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+// Bump when the serialized layout changes
+static constexpr uint32_t REFLECTION_VERSION = 2;
+
+static const char* typeNameOf(slang::VariableLayoutReflection* param)
+{
+    slang::TypeReflection* type = param->getType();
+    const char* name = type ? type->getName() : nullptr;
+    return name ? name : "unknown";
+}
+
+// Structs behind the pointer fields of a push constant block. Only plain
+// data is kept, so the CPU can fill the same layout the shader reads.
+static void reflectPointedStructs(slang::TypeLayoutReflection* blockLayout, ShaderReflection& outReflection)
+{
+    if (!blockLayout || blockLayout->getKind() != slang::TypeReflection::Kind::Struct)
+        return;
+
+    for (unsigned int i = 0; i < blockLayout->getFieldCount(); i++)
+    {
+        slang::TypeLayoutReflection* fieldLayout = blockLayout->getFieldByIndex(i)->getTypeLayout();
+        if (!fieldLayout || fieldLayout->getKind() != slang::TypeReflection::Kind::Pointer)
+            continue;
+
+        slang::TypeLayoutReflection* pointee = fieldLayout->getElementTypeLayout();
+        if (!pointee || pointee->getKind() != slang::TypeReflection::Kind::Struct)
+            continue;
+
+        const char* name = pointee->getName() ? pointee->getName() : "";
+        if (findBufferStruct(outReflection, name))
+            continue;
+
+        ReflectedStruct reflected = {
+            .name = name,
+            .size = (uint32_t)pointee->getSize(),
+            .stride = (uint32_t)pointee->getStride(),
+        };
+        for (unsigned int f = 0; f < pointee->getFieldCount(); f++)
+        {
+            slang::VariableLayoutReflection* field = pointee->getFieldByIndex(f);
+            slang::TypeLayoutReflection* typeLayout = field->getTypeLayout();
+            reflected.fields.push_back({
+                .name = field->getName() ? field->getName() : "",
+                .typeName = typeNameOf(field),
+                .offset = (uint32_t)field->getOffset(),
+                .size = typeLayout ? (uint32_t)typeLayout->getSize() : 0,
+            });
+        }
+        outReflection.bufferStructs.push_back(std::move(reflected));
+    }
+}
+
+static void reflectParameter(slang::VariableLayoutReflection* param, ShaderReflection& outReflection)
+{
+    const char* paramName = param->getName() ? param->getName() : "";
+    outReflection.parameters.push_back({ .name = paramName, .typeName = typeNameOf(param) });
+
+    slang::TypeLayoutReflection* typeLayout = param->getTypeLayout();
+
+    // A parameter can consume several kinds of resources at once
+    for (unsigned int i = 0; i < param->getCategoryCount(); i++)
+    {
+        const slang::ParameterCategory category = param->getCategoryByIndex(i);
+        const SlangParameterCategory slangCategory = (SlangParameterCategory)category;
+
+        switch (category)
+        {
+            case slang::ParameterCategory::PushConstantBuffer:
+            {
+                // ConstantBuffer<T> reports the size of T on its element layout
+                slang::TypeLayoutReflection* dataLayout = typeLayout;
+                if (typeLayout && typeLayout->getKind() == slang::TypeReflection::Kind::ConstantBuffer)
+                    dataLayout = typeLayout->getElementTypeLayout();
+
+                outReflection.pushConstants.push_back({
+                    .name = paramName,
+                    .offset = (uint32_t)param->getOffset(slangCategory),
+                    .size = dataLayout ? (uint32_t)dataLayout->getSize() : 0,
+                });
+                reflectPointedStructs(dataLayout, outReflection);
+                break;
+            }
+            case slang::ParameterCategory::DescriptorTableSlot:
+            {
+                uint32_t count = 1;
+                if (typeLayout && typeLayout->getKind() == slang::TypeReflection::Kind::Array)
+                    count = (uint32_t)typeLayout->getElementCount();
+
+                outReflection.descriptorBindings.push_back({
+                    .name = paramName,
+                    .typeName = typeNameOf(param),
+                    .set = (uint32_t)param->getBindingSpace(slangCategory),
+                    .binding = (uint32_t)param->getOffset(slangCategory),
+                    .count = count,
+                });
+                break;
+            }
+            case slang::ParameterCategory::SpecializationConstant:
+                outReflection.specializationConstants.push_back({
+                    .name = paramName,
+                    .typeName = typeNameOf(param),
+                    .constantId = (uint32_t)param->getOffset(slangCategory),
+                });
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void buildReflection(slang::ProgramLayout* layout, int entryPointIndex, ShaderReflection& outReflection)
+{
+    outReflection = {};
+    if (!layout)
+        return;
+
+    const unsigned int entryPointCount = (unsigned int)layout->getEntryPointCount();
+    for (unsigned int i = 0; i < entryPointCount; i++)
+    {
+        if (entryPointIndex >= 0 && (unsigned int)entryPointIndex != i)
+            continue;
+
+        slang::EntryPointLayout* ep = layout->getEntryPointByIndex(i);
+
+        ReflectedEntryPoint entryPoint = {
+            .name = ep->getName() ? ep->getName() : "",
+            .stage = ep->getStage(),
+        };
+
+        if (entryPoint.stage == SLANG_STAGE_COMPUTE || entryPoint.stage == SLANG_STAGE_MESH ||
+            entryPoint.stage == SLANG_STAGE_AMPLIFICATION)
+        {
+            SlangUInt sizes[3] = {};
+            ep->getComputeThreadGroupSize(3, sizes);
+            for (int axis = 0; axis < 3; axis++)
+                entryPoint.threadGroupSize[axis] = (uint32_t)sizes[axis];
+        }
+
+        outReflection.entryPoints.push_back(std::move(entryPoint));
+    }
+
+    const unsigned int globalParamCount = layout->getParameterCount();
+    for (unsigned int i = 0; i < globalParamCount; i++)
+        reflectParameter(layout->getParameterByIndex(i), outReflection);
+}
+
+const ReflectedStruct* findBufferStruct(const ShaderReflection& reflection, const std::string& name)
+{
+    for (const ReflectedStruct& bufferStruct : reflection.bufferStructs)
+    {
+        if (bufferStruct.name == name)
+            return &bufferStruct;
+    }
+    return nullptr;
+}
+
+std::vector<uint8_t> serializeReflection(const ShaderReflection& reflection)
+{
+    core::BinaryWriter writer;
+    writer.write(REFLECTION_VERSION);
+
+    writer.write((uint32_t)reflection.entryPoints.size());
+    for (const ReflectedEntryPoint& entryPoint : reflection.entryPoints)
+    {
+        writer.writeString(entryPoint.name);
+        writer.write((uint32_t)entryPoint.stage);
+        writer.write(entryPoint.threadGroupSize);
+    }
+
+    writer.write((uint32_t)reflection.parameters.size());
+    for (const ReflectedParameter& parameter : reflection.parameters)
+    {
+        writer.writeString(parameter.name);
+        writer.writeString(parameter.typeName);
+    }
+
+    writer.write((uint32_t)reflection.pushConstants.size());
+    for (const PushConstantRange& range : reflection.pushConstants)
+    {
+        writer.writeString(range.name);
+        writer.write(range.offset);
+        writer.write(range.size);
+    }
+
+    writer.write((uint32_t)reflection.descriptorBindings.size());
+    for (const DescriptorBinding& binding : reflection.descriptorBindings)
+    {
+        writer.writeString(binding.name);
+        writer.writeString(binding.typeName);
+        writer.write(binding.set);
+        writer.write(binding.binding);
+        writer.write(binding.count);
+    }
+
+    writer.write((uint32_t)reflection.specializationConstants.size());
+    for (const SpecializationConstant& constant : reflection.specializationConstants)
+    {
+        writer.writeString(constant.name);
+        writer.writeString(constant.typeName);
+        writer.write(constant.constantId);
+    }
+
+    writer.write((uint32_t)reflection.bufferStructs.size());
+    for (const ReflectedStruct& bufferStruct : reflection.bufferStructs)
+    {
+        writer.writeString(bufferStruct.name);
+        writer.write(bufferStruct.size);
+        writer.write(bufferStruct.stride);
+        writer.write((uint32_t)bufferStruct.fields.size());
+        for (const ReflectedField& field : bufferStruct.fields)
+        {
+            writer.writeString(field.name);
+            writer.writeString(field.typeName);
+            writer.write(field.offset);
+            writer.write(field.size);
+        }
+    }
+
+    return writer.takeBuffer();
+}
+
+bool deserializeReflection(const uint8_t* data, size_t size, ShaderReflection& outReflection)
+{
+    outReflection = {};
+    core::BinaryReader reader(data, size);
+
+    uint32_t version = 0;
+    if (!reader.read(version) || version != REFLECTION_VERSION)
+        return false;
+
+    // Counts are bounded by the remaining size so a corrupt blob cannot
+    // trigger a huge allocation
+    uint32_t count = 0;
+    if (!reader.read(count) || count > reader.remaining())
+        return false;
+    outReflection.entryPoints.resize(count);
+    for (ReflectedEntryPoint& entryPoint : outReflection.entryPoints)
+    {
+        uint32_t stage = 0;
+        reader.readString(entryPoint.name);
+        reader.read(stage);
+        reader.read(entryPoint.threadGroupSize);
+        entryPoint.stage = (SlangStage)stage;
+    }
+
+    if (!reader.read(count) || count > reader.remaining())
+        return false;
+    outReflection.parameters.resize(count);
+    for (ReflectedParameter& parameter : outReflection.parameters)
+    {
+        reader.readString(parameter.name);
+        reader.readString(parameter.typeName);
+    }
+
+    if (!reader.read(count) || count > reader.remaining())
+        return false;
+    outReflection.pushConstants.resize(count);
+    for (PushConstantRange& range : outReflection.pushConstants)
+    {
+        reader.readString(range.name);
+        reader.read(range.offset);
+        reader.read(range.size);
+    }
+
+    if (!reader.read(count) || count > reader.remaining())
+        return false;
+    outReflection.descriptorBindings.resize(count);
+    for (DescriptorBinding& binding : outReflection.descriptorBindings)
+    {
+        reader.readString(binding.name);
+        reader.readString(binding.typeName);
+        reader.read(binding.set);
+        reader.read(binding.binding);
+        reader.read(binding.count);
+    }
+
+    if (!reader.read(count) || count > reader.remaining())
+        return false;
+    outReflection.specializationConstants.resize(count);
+    for (SpecializationConstant& constant : outReflection.specializationConstants)
+    {
+        reader.readString(constant.name);
+        reader.readString(constant.typeName);
+        reader.read(constant.constantId);
+    }
+
+    if (!reader.read(count) || count > reader.remaining())
+        return false;
+    outReflection.bufferStructs.resize(count);
+    for (ReflectedStruct& bufferStruct : outReflection.bufferStructs)
+    {
+        uint32_t fieldCount = 0;
+        reader.readString(bufferStruct.name);
+        reader.read(bufferStruct.size);
+        reader.read(bufferStruct.stride);
+        if (!reader.read(fieldCount) || fieldCount > reader.remaining())
+            return false;
+        bufferStruct.fields.resize(fieldCount);
+        for (ReflectedField& field : bufferStruct.fields)
+        {
+            reader.readString(field.name);
+            reader.readString(field.typeName);
+            reader.read(field.offset);
+            reader.read(field.size);
+        }
+    }
+
+    return reader.ok();
+}
+
+const char* stageToString(SlangStage stage)
+{
+    switch (stage)
+    {
+        case SLANG_STAGE_VERTEX: return "vertex";
+        case SLANG_STAGE_FRAGMENT: return "fragment";
+        case SLANG_STAGE_COMPUTE: return "compute";
+        case SLANG_STAGE_GEOMETRY: return "geometry";
+        case SLANG_STAGE_HULL: return "hull";
+        case SLANG_STAGE_DOMAIN: return "domain";
+        case SLANG_STAGE_AMPLIFICATION: return "task";
+        case SLANG_STAGE_MESH: return "mesh";
+        default: return "unknown";
+    }
+}
+
+std::string reflectionToString(const ShaderReflection& reflection)
+{
+    std::ostringstream out;
+
+    out << "Entry Points: " << reflection.entryPoints.size() << '\n';
+    for (size_t i = 0; i < reflection.entryPoints.size(); i++)
+        out << "  [" << i << "] " << reflection.entryPoints[i].name << " (" << stageToString(reflection.entryPoints[i].stage) << ")\n";
+
+    if (!reflection.parameters.empty())
+    {
+        out << "Global Parameters: " << reflection.parameters.size() << '\n';
+        for (size_t i = 0; i < reflection.parameters.size(); i++)
+            out << "  [" << i << "] " << reflection.parameters[i].name << " : " << reflection.parameters[i].typeName << '\n';
+    }
+
+    for (const PushConstantRange& range : reflection.pushConstants)
+        out << "Push Constants: " << range.name << " offset " << range.offset << " size " << range.size << '\n';
+
+    for (const DescriptorBinding& binding : reflection.descriptorBindings)
+        out << "Binding: " << binding.name << " : " << binding.typeName << " set " << binding.set
+            << " binding " << binding.binding << " count " << binding.count << '\n';
+
+    for (const SpecializationConstant& constant : reflection.specializationConstants)
+        out << "Specialization Constant: " << constant.name << " : " << constant.typeName << " id " << constant.constantId << '\n';
+
+    for (const ReflectedStruct& bufferStruct : reflection.bufferStructs)
+    {
+        out << "Buffer Struct: " << bufferStruct.name << " size " << bufferStruct.size << " stride " << bufferStruct.stride << '\n';
+        for (const ReflectedField& field : bufferStruct.fields)
+            out << "  " << field.name << " : " << field.typeName << " offset " << field.offset << " size " << field.size << '\n';
+    }
+
+    return out.str();
+}
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <slang.h>
+
+
+namespace kholst
+{
+namespace render
+{
+namespace shader
+{
+
+struct ReflectedEntryPoint
+{
+    std::string name;
+    SlangStage stage = SLANG_STAGE_NONE;
+    uint32_t threadGroupSize[3] = { 0, 0, 0 }; // Compute, mesh and task stages only
+};
+
+// A global shader parameter as declared in the source
+struct ReflectedParameter
+{
+    std::string name;
+    std::string typeName;
+};
+
+struct PushConstantRange
+{
+    std::string name;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+struct DescriptorBinding
+{
+    std::string name;
+    std::string typeName;
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    uint32_t count = 1; // 0 for unbounded arrays
+};
+
+struct SpecializationConstant
+{
+    std::string name;
+    std::string typeName;
+    uint32_t constantId = 0;
+};
+
+// A field of a buffer struct, offsets in bytes from the start of the struct
+struct ReflectedField
+{
+    std::string name;
+    std::string typeName;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+// Layout of a struct the shader reads through a buffer pointer
+struct ReflectedStruct
+{
+    std::string name;
+    uint32_t size = 0;
+    uint32_t stride = 0; // Between consecutive array elements
+    std::vector<ReflectedField> fields;
+};
+
+/**
+ * @brief Layout information of a linked program, extracted from Slang
+ *
+ * Built once per compile and cached next to the SPIR-V, so pipeline layouts
+ * can be derived without keeping Slang objects around or querying them again.
+ */
+struct ShaderReflection
+{
+    std::vector<ReflectedEntryPoint> entryPoints;
+    std::vector<ReflectedParameter> parameters;
+    std::vector<PushConstantRange> pushConstants;
+    std::vector<DescriptorBinding> descriptorBindings;
+    std::vector<SpecializationConstant> specializationConstants;
+    std::vector<ReflectedStruct> bufferStructs; // Pointed to by push constant fields, e.g. materials
+};
+
+// Buffer struct by type name, null if the program does not use it
+const ReflectedStruct* findBufferStruct(const ShaderReflection& reflection, const std::string& name);
+
+/**
+ * @brief Extract reflection data from a program layout
+ *
+ * @param layout Layout of the linked program
+ * @param entryPointIndex Entry point to keep, or -1 to keep all of them
+ * @param outReflection Receives the reflection data
+ */
+void buildReflection(slang::ProgramLayout* layout, int entryPointIndex, ShaderReflection& outReflection);
+
+std::vector<uint8_t> serializeReflection(const ShaderReflection& reflection);
+bool deserializeReflection(const uint8_t* data, size_t size, ShaderReflection& outReflection);
+
+// Human readable dump, one line per item
+std::string reflectionToString(const ShaderReflection& reflection);
+
+const char* stageToString(SlangStage stage);
+
+} // namespace shader
+} // namespace render
+} // namespace kholst
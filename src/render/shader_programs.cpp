@@ -0,0 +1,60 @@
+#include "shader_programs.h"
+
+namespace kholst
+{
+namespace render
+{
+
+static const char* SLANG_CUBE_PATH = "src/shaders/cube.slang";
+static const char* CULL_SHADER_PATH = "src/shaders/cull.slang";
+
+shader::ShaderCompileJob getCubeProgram()
+{
+    return {
+        .shaderPath = SLANG_CUBE_PATH,
+        .entryPoints = {
+            { .name = "cubeVertex", .stage = SLANG_STAGE_VERTEX },
+            { .name = "cubeFragment", .stage = SLANG_STAGE_FRAGMENT },
+        },
+    };
+}
+
+shader::ShaderCompileJob getCubeMeshletProgram()
+{
+    return {
+        .shaderPath = SLANG_CUBE_PATH,
+        .entryPoints = {
+            { .name = "cubeTask", .stage = SLANG_STAGE_AMPLIFICATION },
+            { .name = "cubeMesh", .stage = SLANG_STAGE_MESH },
+            { .name = "cubeFragment", .stage = SLANG_STAGE_FRAGMENT },
+        },
+    };
+}
+
+shader::ShaderCompileJob getCullProgram()
+{
+    return {
+        .shaderPath = CULL_SHADER_PATH,
+        .entryPoints = {
+            { .name = "cullInstances", .stage = SLANG_STAGE_COMPUTE },
+            { .name = "buildHiZ", .stage = SLANG_STAGE_COMPUTE },
+        },
+    };
+}
+
+std::vector<shader::ShaderDefine> getBarycentricWireframeDefines()
+{
+    return { { .name = "BARYCENTRIC_WIREFRAME", .value = "1" } };
+}
+
+std::vector<ShaderProgramDesc> getShaderPrograms()
+{
+    return {
+        { .job = getCubeProgram(), .defineSets = { {}, getBarycentricWireframeDefines() } },
+        { .job = getCubeMeshletProgram(), .defineSets = { {}, getBarycentricWireframeDefines() } },
+        { .job = getCullProgram(), .defineSets = { {} } },
+    };
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "render/shader/compiler/compiler.h"
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief A shader program and every define set it is compiled with
+ *
+ * Only defines change the SPIR-V; specialization constants and pipeline
+ * state are applied when pipelines are created and need no entry here.
+ */
+struct ShaderProgramDesc
+{
+    shader::ShaderCompileJob job;
+    std::vector<std::vector<shader::ShaderDefine>> defineSets; // {} is the variant without defines
+};
+
+// Cube program of the vertex path, see SceneRenderer
+shader::ShaderCompileJob getCubeProgram();
+
+// Cube program of the task and mesh shader path, see SceneRenderer
+shader::ShaderCompileJob getCubeMeshletProgram();
+
+// Instance culling and Hi-Z build, see GpuCuller
+shader::ShaderCompileJob getCullProgram();
+
+// Defines of the single-pass wireframe variant of both cube programs
+std::vector<shader::ShaderDefine> getBarycentricWireframeDefines();
+
+/**
+ * @brief Every program the renderer can build, with the variants it uses
+ *
+ * kholst-shaderc bakes exactly these into the shader archive, so a program
+ * or a define set the renderer starts to use has to be added here as well.
+ */
+std::vector<ShaderProgramDesc> getShaderPrograms();
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,379 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <ktx.h>
+#include <lvk/vulkan/VulkanClasses.h>
+#include <lvk/vulkan/VulkanUtils.h>
+
+#include "core/async_log.h"
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace render
+{
+
+// Basis Universal targets in order of preference, each with its linear and sRGB format
+struct TranscodeTarget
+{
+    ktx_transcode_fmt_e ktxFormat;
+    VkFormat format;
+    VkFormat formatSrgb;
+};
+
+static const TranscodeTarget TRANSCODE_TARGETS[] = {
+    { KTX_TTF_BC7_RGBA, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK },
+    { KTX_TTF_ASTC_4x4_RGBA, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK },
+    { KTX_TTF_ETC2_RGBA, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK },
+    { KTX_TTF_RGBA32, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB },
+};
+
+static bool isSampledFormat(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+    if (lvk::vkFormatToFormat(format) == lvk::Format_Invalid)
+        return false;
+
+    VkFormatProperties properties = {};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+static uint32_t levelExtent(uint32_t baseExtent, uint32_t level)
+{
+    return std::max(baseExtent >> level, 1u);
+}
+
+void TextureStreamer::KtxDeleter::operator()(ktxTexture2* texture) const
+{
+    ktxTexture_Destroy(ktxTexture(texture));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    clear();
+}
+
+bool TextureStreamer::initialize(lvk::IContext* context, const Config& streamerConfig, std::string& outErrorMsg)
+{
+    clear();
+
+    if (!streamerConfig.workerThreads)
+    {
+        outErrorMsg = "Texture streamer needs at least one worker thread";
+        return false;
+    }
+
+    const VkPhysicalDevice physicalDevice = static_cast<lvk::VulkanContext*>(context)->getVkPhysicalDevice();
+    const TranscodeTarget* target = nullptr;
+    for (const TranscodeTarget& candidate : TRANSCODE_TARGETS)
+    {
+        if (isSampledFormat(physicalDevice, candidate.format))
+        {
+            target = &candidate;
+            break;
+        }
+    }
+
+    if (!target)
+    {
+        outErrorMsg = "No transcode target format can be sampled on this device";
+        return false;
+    }
+
+    ctx = context;
+    config = streamerConfig;
+    transcodeFormat = target->ktxFormat;
+    transcodedFormat = lvk::vkFormatToFormat(target->format);
+    transcodedFormatSrgb = isSampledFormat(physicalDevice, target->formatSrgb) ?
+        lvk::vkFormatToFormat(target->formatSrgb) :
+        transcodedFormat;
+    return true;
+}
+
+uint32_t TextureStreamer::request(const std::string& path)
+{
+    if (!ctx)
+        return 0;
+
+    auto it = idsByPath.find(path);
+    if (it != idsByPath.end())
+        return it->second;
+
+    const uint32_t id = nextId++;
+    textures[id].path = path;
+    idsByPath.emplace(path, id);
+
+    // Started by the first request, a streamer nothing is loaded with costs no threads
+    if (workers.empty())
+    {
+        for (uint32_t i = 0; i < config.workerThreads; i++)
+            workers.emplace_back(&TextureStreamer::workerMain, this);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.emplace_back(id, path);
+    }
+    jobsReady.notify_one();
+    return id;
+}
+
+void TextureStreamer::workerMain()
+{
+    KHOLST_PROFILER_THREAD("Texture streamer");
+
+    for (;;)
+    {
+        std::pair<uint32_t, std::string> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Decoded result = decode(job.first, job.second);
+
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoded.push_back(std::move(result));
+    }
+}
+
+// Runs on a worker, reads only state that is fixed after initialize()
+TextureStreamer::Decoded TextureStreamer::decode(uint32_t id, const std::string& path) const
+{
+    KHOLST_PROFILER_ZONE("Decode texture");
+    KHOLST_PROFILER_ZONE_TEXT(path.c_str(), path.size());
+
+    Decoded result = { .id = id };
+
+    ktxTexture2* texture = nullptr;
+    KTX_error_code error = ktxTexture2_CreateFromNamedFile(path.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture);
+    if (error != KTX_SUCCESS)
+    {
+        result.errorMsg = "Failed to load '" + path + "': " + ktxErrorString(error);
+        return result;
+    }
+    result.source.reset(texture);
+
+    if (texture->numDimensions != 2 || texture->isArray || texture->isCubemap || texture->numFaces != 1)
+    {
+        result.errorMsg = "Only 2D textures are streamed: '" + path + "'";
+        return result;
+    }
+
+    if (ktxTexture2_NeedsTranscoding(texture))
+    {
+        const bool srgb = ktxTexture2_GetOETF(texture) == KHR_DF_TRANSFER_SRGB;
+
+        KHOLST_PROFILER_ZONE("Transcode texture");
+        error = ktxTexture2_TranscodeBasis(texture, (ktx_transcode_fmt_e)transcodeFormat, 0);
+        if (error != KTX_SUCCESS)
+        {
+            result.errorMsg = "Failed to transcode '" + path + "': " + ktxErrorString(error);
+            return result;
+        }
+        result.format = srgb ? transcodedFormatSrgb : transcodedFormat;
+    }
+    else
+    {
+        result.format = lvk::vkFormatToFormat((VkFormat)texture->vkFormat);
+        if (result.format == lvk::Format_Invalid)
+            result.errorMsg = "Unsupported texture format in '" + path + "'";
+    }
+
+    return result;
+}
+
+void TextureStreamer::update()
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    uploadedBytes = 0;
+
+    std::vector<Decoded> finished;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        finished.swap(decoded);
+    }
+    for (Decoded& result : finished)
+        createTexture(result);
+
+    // One level per texture and pass, so every texture sharpens at the same pace;
+    // the first level of a frame always goes through, even above the budget
+    bool uploaded = true;
+    while (uploaded && uploadedBytes < config.uploadBudget)
+    {
+        uploaded = false;
+        for (uint32_t id : streamingIds)
+        {
+            Texture& texture = textures[id];
+            if (texture.state != State::Streaming)
+                continue;
+
+            const uint32_t level = texture.residentMip - 1;
+            const size_t size = ktxTexture_GetImageSize(ktxTexture(texture.source.get()), level);
+            if (uploadedBytes && uploadedBytes + size > config.uploadBudget)
+                continue;
+
+            uploadLevel(texture, level);
+            uploaded = true;
+        }
+    }
+
+    std::erase_if(streamingIds, [this](uint32_t id) { return textures[id].state != State::Streaming; });
+
+    KHOLST_PROFILER_PLOT("Texture upload bytes", (int64_t)uploadedBytes);
+}
+
+void TextureStreamer::createTexture(Decoded& result)
+{
+    auto it = textures.find(result.id);
+    if (it == textures.end())
+        return;
+    Texture& texture = it->second;
+
+    if (!result.errorMsg.empty())
+    {
+        KHOLST_LOGW("%s\n", result.errorMsg.c_str());
+        texture.state = State::Failed;
+        return;
+    }
+
+    const ktxTexture2* source = result.source.get();
+
+    lvk::Result res;
+    texture.texture = ctx->createTexture({
+        .type = lvk::TextureType_2D,
+        .format = result.format,
+        .dimensions = { source->baseWidth, source->baseHeight, 1 },
+        .usage = lvk::TextureUsageBits_Sampled,
+        .numMipLevels = source->numLevels,
+        .debugName = texture.path.c_str(),
+    }, texture.path.c_str(), &res);
+
+    if (!res.isOk())
+    {
+        KHOLST_LOGW("Failed to create texture '%s': %s\n", texture.path.c_str(), res.message ? res.message : "");
+        texture.texture = {};
+        texture.state = State::Failed;
+        return;
+    }
+
+    texture.source = std::move(result.source);
+    texture.numLevels = source->numLevels;
+    texture.residentMip = source->numLevels;
+    texture.state = State::Streaming;
+
+    // The coarsest level always, then the rest of the mip tail
+    do
+    {
+        uploadLevel(texture, texture.residentMip - 1);
+    } while (texture.state == State::Streaming &&
+             std::max(levelExtent(source->baseWidth, texture.residentMip - 1), levelExtent(source->baseHeight, texture.residentMip - 1)) <= config.mipTailExtent);
+
+    if (texture.state == State::Streaming)
+        streamingIds.push_back(result.id);
+}
+
+size_t TextureStreamer::uploadLevel(Texture& texture, uint32_t level)
+{
+    ktxTexture* source = ktxTexture(texture.source.get());
+
+    ktx_size_t offset = 0;
+    if (ktxTexture_GetImageOffset(source, level, 0, 0, &offset) != KTX_SUCCESS)
+    {
+        KHOLST_LOGW("Missing level %u in texture '%s'\n", level, texture.path.c_str());
+        texture.state = State::Failed;
+        return 0;
+    }
+
+    const lvk::Result res = ctx->upload(texture.texture, {
+        .dimensions = { levelExtent(source->baseWidth, level), levelExtent(source->baseHeight, level), 1 },
+        .mipLevel = level,
+    }, ktxTexture_GetData(source) + offset);
+
+    if (!res.isOk())
+    {
+        KHOLST_LOGW("Failed to upload level %u of texture '%s': %s\n", level, texture.path.c_str(), res.message ? res.message : "");
+        texture.state = State::Failed;
+        return 0;
+    }
+
+    const size_t size = ktxTexture_GetImageSize(source, level);
+    uploadedBytes += size;
+
+    texture.residentMip = level;
+    if (level == 0)
+    {
+        texture.state = State::Resident;
+        texture.source.reset();
+    }
+    return size;
+}
+
+lvk::TextureHandle TextureStreamer::getTexture(uint32_t id) const
+{
+    auto it = textures.find(id);
+    if (it == textures.end() || (it->second.state != State::Streaming && it->second.state != State::Resident))
+        return {};
+    return it->second.texture;
+}
+
+uint32_t TextureStreamer::getResidentMip(uint32_t id) const
+{
+    auto it = textures.find(id);
+    return it != textures.end() ? it->second.residentMip : 0;
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const
+{
+    Stats stats = { .uploadedBytes = uploadedBytes };
+    for (const auto& [id, texture] : textures)
+    {
+        switch (texture.state)
+        {
+        case State::Decoding:
+            stats.decoding++;
+            break;
+        case State::Streaming:
+            stats.streaming++;
+            break;
+        case State::Resident:
+            stats.resident++;
+            break;
+        case State::Failed:
+            stats.failed++;
+            break;
+        }
+    }
+    return stats;
+}
+
+void TextureStreamer::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobsReady.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+    stopping = false;
+
+    decoded.clear();
+    streamingIds.clear();
+    idsByPath.clear();
+    textures.clear();
+    uploadedBytes = 0;
+    ctx = nullptr;
+}
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <lvk/LVK.h>
+
+struct ktxTexture2;
+
+
+namespace kholst
+{
+namespace render
+{
+
+/**
+ * @brief Loads KTX2 textures in the background and streams their mips in
+ *
+ * request() only queues the file; the first request starts the worker
+ * threads. Workers read it, transcode Basis Universal (ETC1S or UASTC)
+ * payloads to the best block format the device samples (BC7, then ASTC
+ * 4x4, then ETC2, then plain RGBA8) and hand the result back to the render
+ * thread.
+ *
+ * update() runs once per frame on the render thread. A freshly decoded
+ * texture is created with its full mip chain and its mip tail (every level
+ * up to Config::mipTailExtent) is uploaded at once, so it can be sampled
+ * the same frame. Finer levels follow over later frames, coarsest first,
+ * within Config::uploadBudget bytes per frame, so neither file I/O,
+ * transcoding nor large uploads ever block the frame.
+ *
+ * Levels finer than getResidentMip() hold undefined data until they are
+ * uploaded; shaders clamp their LOD to it (e.g. as a minimum LOD passed in
+ * push constants).
+ *
+ * Thread-safety: not thread-safe, use from the render thread. Only the
+ * workers run concurrently, on their own queues.
+ */
+class TextureStreamer
+{
+public:
+    struct Config
+    {
+        uint32_t workerThreads = 2;
+        size_t uploadBudget = 8 * 1024 * 1024; // Bytes uploaded per update(), keep below LVK's staging buffer size
+        uint32_t mipTailExtent = 128; // Levels this size and smaller are uploaded together on creation
+    };
+
+    struct Stats
+    {
+        uint32_t decoding = 0; // Queued or on a worker
+        uint32_t streaming = 0; // Created, finer mips still to upload
+        uint32_t resident = 0;
+        uint32_t failed = 0;
+        size_t uploadedBytes = 0; // During the last update()
+    };
+
+    TextureStreamer() = default;
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    /**
+     * @brief Pick the transcode target format
+     *
+     * Workers are only started by the first request().
+     *
+     * @param ctx Context to create textures in, must outlive the streamer
+     * @param config Worker count and upload budget
+     * @param outErrorMsg Error description on failure
+     * @return true on success
+     */
+    bool initialize(lvk::IContext* ctx, const Config& config, std::string& outErrorMsg);
+
+    /**
+     * @brief Queue a KTX2 file for loading
+     *
+     * @param path File to load; requesting the same path again returns the same id
+     * @return Id for getTexture() and getResidentMip(), 0 if not initialized
+     */
+    uint32_t request(const std::string& path);
+
+    // Create decoded textures and upload mips within the budget, once per frame
+    void update();
+
+    // Empty until the mip tail of the texture is resident
+    lvk::TextureHandle getTexture(uint32_t id) const;
+
+    // Finest level that holds data, meaningful once getTexture() is not empty
+    uint32_t getResidentMip(uint32_t id) const;
+
+    Stats getStats() const;
+
+    // Stop the workers and release every texture
+    void clear();
+
+private:
+    struct KtxDeleter
+    {
+        void operator()(ktxTexture2* texture) const;
+    };
+    using KtxPtr = std::unique_ptr<ktxTexture2, KtxDeleter>;
+
+    enum class State
+    {
+        Decoding,
+        Streaming,
+        Resident,
+        Failed,
+    };
+
+    struct Texture
+    {
+        std::string path;
+        State state = State::Decoding;
+        lvk::Holder<lvk::TextureHandle> texture;
+        KtxPtr source; // Kept until every level is uploaded
+        uint32_t numLevels = 0;
+        uint32_t residentMip = 0;
+    };
+
+    struct Decoded
+    {
+        uint32_t id = 0;
+        KtxPtr source;
+        lvk::Format format = lvk::Format_Invalid;
+        std::string errorMsg;
+    };
+
+    lvk::IContext* ctx = nullptr;
+    Config config;
+    uint32_t transcodeFormat = 0; // ktx_transcode_fmt_e
+    lvk::Format transcodedFormat = lvk::Format_Invalid;
+    lvk::Format transcodedFormatSrgb = lvk::Format_Invalid;
+
+    std::unordered_map<uint32_t, Texture> textures;
+    std::unordered_map<std::string, uint32_t> idsByPath;
+    std::vector<uint32_t> streamingIds; // In request order
+    uint32_t nextId = 1;
+    size_t uploadedBytes = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex jobsMutex;
+    std::condition_variable jobsReady;
+    std::deque<std::pair<uint32_t, std::string>> jobs;
+    bool stopping = false;
+
+    std::mutex decodedMutex;
+    std::vector<Decoded> decoded;
+
+    void workerMain();
+    Decoded decode(uint32_t id, const std::string& path) const;
+    void createTexture(Decoded& result);
+    size_t uploadLevel(Texture& texture, uint32_t level);
+};
+
+} // namespace render
+} // namespace kholst
@@ -0,0 +1,296 @@
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define KHOLST_TRANSFORM_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define KHOLST_TRANSFORM_NEON 1
+#endif
+
+#include "core/profiler.h"
+
+namespace kholst
+{
+namespace scene
+{
+
+// Slots per task when a level is split across workers
+static constexpr uint32_t PARALLEL_CHUNK_SIZE = TransformHierarchy::PARALLEL_LEVEL_SIZE / 4;
+
+// out = a * b for column-major matrices, out must not alias a or b
+static void multiplyMatrix(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if defined(KHOLST_TRANSFORM_SSE)
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; column++)
+    {
+        const __m128 xy = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[column][0])), _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+        const __m128 zw = _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[column][2])), _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+        _mm_storeu_ps(&out[column][0], _mm_add_ps(xy, zw));
+    }
+#elif defined(KHOLST_TRANSFORM_NEON)
+    const float32x4_t a0 = vld1q_f32(&a[0][0]);
+    const float32x4_t a1 = vld1q_f32(&a[1][0]);
+    const float32x4_t a2 = vld1q_f32(&a[2][0]);
+    const float32x4_t a3 = vld1q_f32(&a[3][0]);
+    for (int column = 0; column < 4; column++)
+    {
+        float32x4_t result = vmulq_n_f32(a0, b[column][0]);
+        result = vmlaq_n_f32(result, a1, b[column][1]);
+        result = vmlaq_n_f32(result, a2, b[column][2]);
+        result = vmlaq_n_f32(result, a3, b[column][3]);
+        vst1q_f32(&out[column][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+// Gather values into their new slots
+template<typename ValueType>
+static void permute(std::vector<ValueType>& values, const std::vector<uint32_t>& oldSlots)
+{
+    std::vector<ValueType> sorted(oldSlots.size());
+    for (size_t slot = 0; slot < oldSlots.size(); slot++)
+        sorted[slot] = values[oldSlots[slot]];
+    values.swap(sorted);
+}
+
+TransformHierarchy::NodeId TransformHierarchy::addNode(NodeId parent, const Transform& local, const Bounds& localBounds)
+{
+    if (parent != INVALID_NODE && parent >= parentOfNode.size())
+        return INVALID_NODE;
+
+    const NodeId node = (NodeId)parentOfNode.size();
+    const uint32_t depth = parent == INVALID_NODE ? 0 : depthOfNode[parent] + 1;
+
+    slotOfNode.push_back((uint32_t)nodeOfSlot.size());
+    parentOfNode.push_back(parent);
+    depthOfNode.push_back(depth);
+
+    nodeOfSlot.push_back(node);
+    parentSlots.push_back(parent == INVALID_NODE ? NO_PARENT : slotOfNode[parent]);
+    positions.push_back(local.position);
+    rotations.push_back(local.rotation);
+    scales.push_back(local.scale);
+    localCenters.push_back(localBounds.center);
+    localExtents.push_back(localBounds.extents);
+
+    worldMatrices.emplace_back(1.0f);
+    worldCenters.push_back(localBounds.center);
+    worldExtents.push_back(localBounds.extents);
+    dirty.push_back(1);
+
+    needsSort = true;
+    firstDirtyLevel = std::min(firstDirtyLevel, depth);
+    return node;
+}
+
+void TransformHierarchy::reserve(size_t nodeCount)
+{
+    slotOfNode.reserve(nodeCount);
+    parentOfNode.reserve(nodeCount);
+    depthOfNode.reserve(nodeCount);
+    nodeOfSlot.reserve(nodeCount);
+    parentSlots.reserve(nodeCount);
+    positions.reserve(nodeCount);
+    rotations.reserve(nodeCount);
+    scales.reserve(nodeCount);
+    localCenters.reserve(nodeCount);
+    localExtents.reserve(nodeCount);
+    worldMatrices.reserve(nodeCount);
+    worldCenters.reserve(nodeCount);
+    worldExtents.reserve(nodeCount);
+    dirty.reserve(nodeCount);
+}
+
+void TransformHierarchy::setLocalTransform(NodeId node, const Transform& local)
+{
+    const uint32_t slot = slotOfNode[node];
+    positions[slot] = local.position;
+    rotations[slot] = local.rotation;
+    scales[slot] = local.scale;
+    dirty[slot] = 1;
+
+    firstDirtyLevel = std::min(firstDirtyLevel, depthOfNode[node]);
+}
+
+TransformHierarchy::Transform TransformHierarchy::getLocalTransform(NodeId node) const
+{
+    const uint32_t slot = slotOfNode[node];
+    return { .position = positions[slot], .rotation = rotations[slot], .scale = scales[slot] };
+}
+
+TransformHierarchy::Bounds TransformHierarchy::getWorldBounds(NodeId node) const
+{
+    const uint32_t slot = slotOfNode[node];
+    return { .center = worldCenters[slot], .extents = worldExtents[slot] };
+}
+
+// Counting sort by depth, nodes of one level keep the order they were added in
+void TransformHierarchy::sortByDepth()
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    const uint32_t maxDepth = depthOfNode.empty() ? 0 : *std::max_element(depthOfNode.begin(), depthOfNode.end());
+
+    levelOffsets.assign(maxDepth + 2, 0);
+    for (uint32_t depth : depthOfNode)
+        levelOffsets[depth + 1]++;
+    for (size_t level = 1; level < levelOffsets.size(); level++)
+        levelOffsets[level] += levelOffsets[level - 1];
+
+    std::vector<uint32_t> cursors(levelOffsets.begin(), levelOffsets.end() - 1);
+    std::vector<uint32_t> oldSlots(nodeOfSlot.size());
+    for (NodeId node = 0; node < depthOfNode.size(); node++)
+    {
+        const uint32_t slot = cursors[depthOfNode[node]]++;
+        oldSlots[slot] = slotOfNode[node];
+        slotOfNode[node] = slot;
+    }
+
+    permute(nodeOfSlot, oldSlots);
+    permute(positions, oldSlots);
+    permute(rotations, oldSlots);
+    permute(scales, oldSlots);
+    permute(localCenters, oldSlots);
+    permute(localExtents, oldSlots);
+    permute(worldMatrices, oldSlots);
+    permute(worldCenters, oldSlots);
+    permute(worldExtents, oldSlots);
+    permute(dirty, oldSlots);
+
+    for (uint32_t slot = 0; slot < nodeOfSlot.size(); slot++)
+    {
+        const NodeId parent = parentOfNode[nodeOfSlot[slot]];
+        parentSlots[slot] = parent == INVALID_NODE ? NO_PARENT : slotOfNode[parent];
+    }
+
+    needsSort = false;
+}
+
+uint32_t TransformHierarchy::updateRange(uint32_t begin, uint32_t end)
+{
+    uint32_t updated = 0;
+    for (uint32_t slot = begin; slot < end; slot++)
+    {
+        const uint32_t parent = parentSlots[slot];
+        if (!dirty[slot] && (parent == NO_PARENT || !dirty[parent]))
+            continue;
+
+        // Children of this node check the flag on the next level
+        dirty[slot] = 1;
+
+        const glm::mat3 rotation = glm::mat3_cast(rotations[slot]);
+        const glm::vec3& scale = scales[slot];
+        const glm::mat4 local(
+            glm::vec4(rotation[0] * scale.x, 0.0f),
+            glm::vec4(rotation[1] * scale.y, 0.0f),
+            glm::vec4(rotation[2] * scale.z, 0.0f),
+            glm::vec4(positions[slot], 1.0f)
+        );
+
+        glm::mat4& world = worldMatrices[slot];
+        if (parent == NO_PARENT)
+            world = local;
+        else
+            multiplyMatrix(worldMatrices[parent], local, world);
+
+        // Box of the transformed box: extents through the absolute 3x3 part
+        const glm::vec3& extents = localExtents[slot];
+        worldCenters[slot] = glm::vec3(world * glm::vec4(localCenters[slot], 1.0f));
+        worldExtents[slot] =
+            glm::abs(glm::vec3(world[0])) * extents.x +
+            glm::abs(glm::vec3(world[1])) * extents.y +
+            glm::abs(glm::vec3(world[2])) * extents.z;
+
+        updated++;
+    }
+    return updated;
+}
+
+void TransformHierarchy::update(tf::Executor* executor)
+{
+    KHOLST_PROFILER_FUNCTION();
+
+    if (needsSort)
+        sortByDepth();
+
+    const uint32_t levelCount = levelOffsets.empty() ? 0 : (uint32_t)levelOffsets.size() - 1;
+    stats = {
+        .nodeCount = (uint32_t)nodeOfSlot.size(),
+        .levelCount = levelCount,
+        .skippedLevels = std::min(firstDirtyLevel, levelCount),
+    };
+
+    if (firstDirtyLevel >= levelCount)
+    {
+        firstDirtyLevel = NO_DIRTY_LEVEL;
+        return;
+    }
+
+    for (uint32_t level = firstDirtyLevel; level < levelCount; level++)
+    {
+        const uint32_t begin = levelOffsets[level];
+        const uint32_t end = levelOffsets[level + 1];
+
+        if (!executor || end - begin <= PARALLEL_LEVEL_SIZE)
+        {
+            stats.updatedNodes += updateRange(begin, end);
+            continue;
+        }
+
+        // A level only reads the one above it, so its chunks are independent
+        std::atomic<uint32_t> updated = 0;
+        tf::Taskflow taskflow;
+        for (uint32_t chunk = begin; chunk < end; chunk += PARALLEL_CHUNK_SIZE)
+        {
+            const uint32_t chunkEnd = std::min(chunk + PARALLEL_CHUNK_SIZE, end);
+            taskflow.emplace([this, &updated, chunk, chunkEnd]()
+            {
+                updated += updateRange(chunk, chunkEnd);
+            });
+        }
+        executor->run(taskflow).wait();
+        stats.updatedNodes += updated;
+    }
+
+    const uint32_t firstDirtySlot = levelOffsets[firstDirtyLevel];
+    std::memset(dirty.data() + firstDirtySlot, 0, dirty.size() - firstDirtySlot);
+    firstDirtyLevel = NO_DIRTY_LEVEL;
+
+    KHOLST_PROFILER_PLOT("Updated transforms", (int64_t)stats.updatedNodes);
+}
+
+void TransformHierarchy::clear()
+{
+    slotOfNode.clear();
+    parentOfNode.clear();
+    depthOfNode.clear();
+    nodeOfSlot.clear();
+    parentSlots.clear();
+    positions.clear();
+    rotations.clear();
+    scales.clear();
+    localCenters.clear();
+    localExtents.clear();
+    worldMatrices.clear();
+    worldCenters.clear();
+    worldExtents.clear();
+    dirty.clear();
+    levelOffsets.clear();
+    firstDirtyLevel = NO_DIRTY_LEVEL;
+    needsSort = false;
+    stats = {};
+}
+
+} // namespace scene
+} // namespace kholst
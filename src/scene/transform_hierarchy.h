@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <taskflow/taskflow.hpp>
+
+
+namespace kholst
+{
+namespace scene
+{
+
+/**
+ * @brief Node transforms, hierarchy and bounds in structure-of-arrays form
+ *
+ * Every attribute lives in its own array, indexed by slot. Slots are sorted
+ * by hierarchy depth, so a parent always comes before its children, and
+ * update() is a sequence of flat loops, one per depth level, each reading
+ * the already final world matrices of the level above. Levels larger than
+ * PARALLEL_LEVEL_SIZE are split across the workers of a Taskflow executor.
+ *
+ * Only dirty subtrees are recomputed: setLocalTransform() flags a node,
+ * update() recomputes flagged nodes and the children of recomputed nodes,
+ * and levels above the shallowest flagged node are skipped altogether.
+ *
+ * NodeIds stay stable; slots change when nodes are added, since the arrays
+ * are re-sorted by depth on the next update().
+ *
+ * Thread-safety: not thread-safe.
+ */
+class TransformHierarchy
+{
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId INVALID_NODE = ~0u;
+
+    // Levels with more nodes than this are updated in parallel
+    static constexpr uint32_t PARALLEL_LEVEL_SIZE = 16 * 1024;
+
+    struct Transform
+    {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+    };
+
+    // Axis-aligned box
+    struct Bounds
+    {
+        glm::vec3 center = glm::vec3(0.0f);
+        glm::vec3 extents = glm::vec3(0.0f); // Half size
+    };
+
+    struct Stats
+    {
+        uint32_t nodeCount = 0;
+        uint32_t levelCount = 0;
+        uint32_t updatedNodes = 0; // Recomputed by the last update()
+        uint32_t skippedLevels = 0; // Clean levels the last update() did not visit
+    };
+
+    /**
+     * @brief Add a node, dirty until the next update()
+     *
+     * @param parent Existing node, or INVALID_NODE for a root
+     * @param local Transform relative to the parent
+     * @param localBounds Bounds in the node's own space
+     * @return Id of the new node, INVALID_NODE if parent does not exist
+     */
+    NodeId addNode(NodeId parent, const Transform& local, const Bounds& localBounds);
+    NodeId addNode(NodeId parent, const Transform& local) { return addNode(parent, local, Bounds()); }
+
+    void reserve(size_t nodeCount);
+
+    // Replace the local transform and flag the node's subtree for the next update()
+    void setLocalTransform(NodeId node, const Transform& local);
+
+    Transform getLocalTransform(NodeId node) const;
+
+    /**
+     * @brief Recompute world matrices and bounds of every dirty subtree
+     *
+     * @param executor Workers for large levels, or nullptr to update on the calling thread
+     */
+    void update(tf::Executor* executor = nullptr);
+
+    // World state as of the last update()
+    const glm::mat4& getWorldMatrix(NodeId node) const { return worldMatrices[slotOfNode[node]]; }
+    Bounds getWorldBounds(NodeId node) const;
+
+    // Every world matrix in slot order, e.g. for a GPU upload
+    std::span<const glm::mat4> getWorldMatrices() const { return worldMatrices; }
+
+    NodeId getNode(uint32_t slot) const { return nodeOfSlot[slot]; }
+    uint32_t getSlot(NodeId node) const { return slotOfNode[node]; }
+    NodeId getParent(NodeId node) const { return parentOfNode[node]; }
+
+    size_t size() const { return nodeOfSlot.size(); }
+
+    Stats getStats() const { return stats; }
+
+    void clear();
+
+private:
+    static constexpr uint32_t NO_PARENT = ~0u;
+    static constexpr uint32_t NO_DIRTY_LEVEL = ~0u;
+
+    // By NodeId, the order nodes were added in
+    std::vector<uint32_t> slotOfNode;
+    std::vector<NodeId> parentOfNode;
+    std::vector<uint32_t> depthOfNode;
+
+    // By slot: local state
+    std::vector<NodeId> nodeOfSlot;
+    std::vector<uint32_t> parentSlots; // NO_PARENT for roots
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::vec3> localCenters;
+    std::vector<glm::vec3> localExtents;
+
+    // By slot: world state
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<glm::vec3> worldCenters;
+    std::vector<glm::vec3> worldExtents;
+    std::vector<uint8_t> dirty; // Recompute on the next update(), set for children while updating
+
+    std::vector<uint32_t> levelOffsets; // Slot range of each depth level, plus one past the end
+    uint32_t firstDirtyLevel = NO_DIRTY_LEVEL; // Shallowest level with a dirty node
+    bool needsSort = false;
+    Stats stats;
+
+    void sortByDepth();
+    uint32_t updateRange(uint32_t begin, uint32_t end);
+};
+
+} // namespace scene
+} // namespace kholst
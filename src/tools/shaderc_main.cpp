@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "render/shader/archive/shader_archive.h"
+#include "render/shader/compiler/compiler.h"
+#include "render/shader/reflection/shader_reflection.h"
+#include "render/shader_programs.h"
+
+// Offline shader baking: compiles every program of getShaderPrograms(), in
+// every define set, and packs the SPIR-V and reflection into one archive
+// that release builds map instead of initializing Slang.
+//
+//   kholst-shaderc --output path
+//
+// Run from the repository root, module paths are baked as the renderer
+// spells them (src/shaders/...). The build runs it through the Shaders target.
+
+using kholst::render::ShaderProgramDesc;
+using kholst::render::shader::CompiledShader;
+using kholst::render::shader::ShaderArchive;
+using kholst::render::shader::ShaderArchiveWriter;
+using kholst::render::shader::ShaderDefine;
+using kholst::render::shader::SlangCompiler;
+using kholst::render::shader::serializeReflection;
+
+static std::string describeDefines(const std::vector<ShaderDefine>& defines)
+{
+    std::string text;
+    for (const ShaderDefine& define : defines)
+        text += (text.empty() ? "" : " ") + define.name + "=" + define.value;
+    return text.empty() ? "no defines" : text;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* outputPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else
+        {
+            outputPath = nullptr;
+            break;
+        }
+    }
+
+    if (!outputPath)
+    {
+        std::fprintf(stderr, "Usage: kholst-shaderc --output path\n");
+        return EXIT_FAILURE;
+    }
+
+    SlangCompiler prototype;
+    if (!prototype.initialize(SLANG_SPIRV))
+    {
+        std::fprintf(stderr, "Failed to initialize Slang: %s\n", prototype.getLastDiagnostics().c_str());
+        return EXIT_FAILURE;
+    }
+
+    ShaderArchiveWriter writer;
+    size_t compiledCount = 0;
+    for (const ShaderProgramDesc& program : kholst::render::getShaderPrograms())
+    {
+        for (const std::vector<ShaderDefine>& defines : program.defineSets)
+        {
+            // One session per define set, like PipelineVariantManager builds them at runtime
+            SlangCompiler compiler;
+            if (!compiler.initialize(prototype.getGlobalSession(), prototype.getTarget(), defines))
+            {
+                std::fprintf(stderr, "Failed to create a Slang session for %s (%s)\n",
+                    program.job.shaderPath.c_str(), describeDefines(defines).c_str());
+                return EXIT_FAILURE;
+            }
+
+            std::vector<CompiledShader> shaders;
+            std::string errorMsg;
+            if (!compiler.compileEntryPoints(program.job.shaderPath, program.job.entryPoints, shaders, errorMsg))
+            {
+                std::fprintf(stderr, "%s (%s): %s\n",
+                    program.job.shaderPath.c_str(), describeDefines(defines).c_str(), errorMsg.c_str());
+                return EXIT_FAILURE;
+            }
+
+            for (size_t i = 0; i < shaders.size(); i++)
+            {
+                if (!shaders[i].getReflection())
+                {
+                    std::fprintf(stderr, "%s: %s has no reflection\n",
+                        program.job.shaderPath.c_str(), program.job.entryPoints[i].name.c_str());
+                    return EXIT_FAILURE;
+                }
+
+                const uint64_t key = ShaderArchive::computeKey(
+                    program.job.shaderPath, program.job.entryPoints[i],
+                    compiler.getTarget(), compiler.getProfile(), compiler.getDefines());
+
+                // Programs share entry points (cubeFragment), the first copy wins
+                if (writer.add(key, shaders[i].getSpirv(), serializeReflection(*shaders[i].getReflection())))
+                    compiledCount++;
+            }
+        }
+    }
+
+    std::string errorMsg;
+    if (!writer.write(outputPath, errorMsg))
+    {
+        std::fprintf(stderr, "%s\n", errorMsg.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::fprintf(stderr, "Baked %zu entry points into %s\n", compiledCount, outputPath);
+    return EXIT_SUCCESS;
+}
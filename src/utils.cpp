@@ -1,12 +1,26 @@
 // https://github.com/PacktPublishing/3D-Graphics-Rendering-Cookbook-Second-Edition/blob/main/shared/Utils.cpp
 
+#include <ctype.h>
+#include <stdio.h>
 #include <string.h>
+#include <memory>
 #include <string>
-#if !defined(__APPLE__)
-#include <malloc.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "utils.h"
+#include "core/async_log.h"
 
 #include <stb/stb_image.h>
 #include <ktx.h>
@@ -19,47 +33,293 @@ bool ends_with(const char* s, const char* part)
   return sLength < partLength ? false : strcmp(s + sLength - partLength, part) == 0;
 }
 
-std::string read_shader_file(const char* fileName)
-{
-  FILE* file = fopen(fileName, "r");
+// Sources at least this big are memory-mapped instead of copied to the heap
+static constexpr size_t SHADER_MMAP_THRESHOLD = 256 * 1024;
 
-  if (!file) {
-    LLOGW("I/O error. Cannot open shader file '%s'\n", fileName);
-    return std::string();
+// Includes nested deeper than this are reported as a cycle
+static constexpr size_t SHADER_MAX_INCLUDE_DEPTH = 64;
+
+// One shader source file, read once per read_shader_file() call however
+// often it is included
+struct ShaderSource {
+  std::string storage;
+  const char* data = nullptr;
+  size_t size      = 0;
+  bool includeOnce = false; // #pragma once or an include guard around the whole file
+
+  // The view as mapped, data and size skip a BOM and must not be unmapped
+  const void* view = nullptr;
+  size_t viewSize  = 0;
+#if defined(_WIN32)
+  HANDLE mapping = nullptr;
+#endif
+
+  ShaderSource() = default;
+  ShaderSource(const ShaderSource&)            = delete;
+  ShaderSource& operator=(const ShaderSource&) = delete;
+
+  ~ShaderSource() {
+#if defined(_WIN32)
+    if (view)
+      UnmapViewOfFile(view);
+    if (mapping)
+      CloseHandle(mapping);
+#else
+    if (view)
+      munmap(const_cast<void*>(view), viewSize);
+#endif
   }
+};
+
+static bool map_shader_file(const char* fileName, ShaderSource& source) {
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  SCOPE_EXIT {
+    CloseHandle(file);
+  };
+
+  LARGE_INTEGER fileSize = {};
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)SHADER_MMAP_THRESHOLD)
+    return false;
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping)
+    return false;
+
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  source.mapping  = mapping;
+  source.view     = view;
+  source.viewSize = (size_t)fileSize.QuadPart;
+  source.data     = (const char*)view;
+  source.size     = source.viewSize;
+  return true;
+#else
+  const int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return false;
+  SCOPE_EXIT {
+    close(fd);
+  };
+
+  struct stat st = {};
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)SHADER_MMAP_THRESHOLD)
+    return false;
+
+  void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (view == MAP_FAILED)
+    return false;
 
-  fseek(file, 0L, SEEK_END);
-  const size_t bytesinfile = ftell(file);
-  fseek(file, 0L, SEEK_SET);
+  source.view     = view;
+  source.viewSize = (size_t)st.st_size;
+  source.data     = (const char*)view;
+  source.size     = source.viewSize;
+  return true;
+#endif
+}
+
+static bool read_shader_source(const char* fileName, ShaderSource& source) {
+  if (!map_shader_file(fileName, source)) {
+    FILE* file = fopen(fileName, "rb");
 
-  char* buffer           = (char*)alloca(bytesinfile + 1);
-  const size_t bytesread = fread(buffer, 1, bytesinfile, file);
-  fclose(file);
+    if (!file)
+      return false;
 
-  buffer[bytesread] = 0;
+    fseek(file, 0L, SEEK_END);
+    const long bytesinfile = ftell(file);
+    fseek(file, 0L, SEEK_SET);
+
+    source.storage.resize(bytesinfile > 0 ? (size_t)bytesinfile : 0);
+    source.storage.resize(fread(source.storage.data(), 1, source.storage.size(), file));
+    fclose(file);
+
+    source.data = source.storage.data();
+    source.size = source.storage.size();
+  }
 
   static constexpr unsigned char BOM[] = { 0xEF, 0xBB, 0xBF };
 
-  if (bytesread > 3) {
-    if (!memcmp(buffer, BOM, 3))
-      memset(buffer, ' ', 3);
+  if (source.size >= 3 && !memcmp(source.data, BOM, 3)) {
+    source.data += 3;
+    source.size -= 3;
+  }
+
+  return true;
+}
+
+static const char* skip_blanks(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  return p;
+}
+
+// Matches "# directive" at p, returns the end of the keyword or nullptr
+static const char* match_directive(const char* p, const char* end, const char* directive) {
+  p = skip_blanks(p, end);
+  if (p == end || *p != '#')
+    return nullptr;
+  p = skip_blanks(p + 1, end);
+
+  const size_t length = strlen(directive);
+  if ((size_t)(end - p) < length || memcmp(p, directive, length) != 0)
+    return nullptr;
+  p += length;
+
+  // "#included" is not "#include"
+  if (p < end && !isspace((unsigned char)*p) && *p != '/' && *p != '<' && *p != '"')
+    return nullptr;
+  return p;
+}
+
+static std::string read_identifier(const char* p, const char* end) {
+  p = skip_blanks(p, end);
+  const char* start = p;
+  while (p < end && (isalnum((unsigned char)*p) || *p == '_'))
+    p++;
+  return std::string(start, p);
+}
+
+// A file whose first directive is #ifndef X, followed by #define X, and whose
+// last one is #endif expands to nothing when included a second time
+static bool has_include_guard(const ShaderSource& source) {
+  const char* p   = source.data;
+  const char* end = source.data + source.size;
+
+  std::string guard;
+  int directive = 0;
+  const char* lastDirective = nullptr;
+
+  while (p < end) {
+    const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+    if (!lineEnd)
+      lineEnd = end;
+
+    const char* text = skip_blanks(p, lineEnd);
+    const bool isBlank = text == lineEnd || *text == '\r' || (lineEnd - text >= 2 && text[0] == '/' && text[1] == '/');
+
+    if (!isBlank) {
+      if (directive == 0) {
+        const char* name = match_directive(text, lineEnd, "ifndef");
+        if (!name)
+          return false;
+        guard = read_identifier(name, lineEnd);
+        directive = 1;
+      } else if (directive == 1) {
+        const char* name = match_directive(text, lineEnd, "define");
+        if (!name || guard.empty() || read_identifier(name, lineEnd) != guard)
+          return false;
+        directive = 2;
+      }
+      lastDirective = text;
+    }
+
+    p = lineEnd + 1;
   }
 
-  std::string code(buffer);
+  return directive == 2 && lastDirective && match_directive(lastDirective, end, "endif");
+}
+
+// Expands #include <file> and #include "file" in a single pass into one
+// output buffer. Every file is read once, files with #pragma once or an
+// include guard are expanded only the first time they are included.
+class ShaderPreprocessor {
+ public:
+  bool expand(const char* fileName, std::string& out) {
+    ShaderSource* source = load(fileName);
+
+    if (!source) {
+      KHOLST_LOGW("I/O error. Cannot open shader file '%s'\n", fileName);
+      return false;
+    }
+
+    if (source->includeOnce && expanded.count(fileName))
+      return true;
+
+    if (stack.size() >= SHADER_MAX_INCLUDE_DEPTH) {
+      KHOLST_LOGW("Error while loading shader program: include depth exceeded in '%s', recursive include?\n", fileName);
+      return false;
+    }
+
+    expanded.insert(fileName);
+    stack.push_back(fileName);
+    SCOPE_EXIT {
+      stack.pop_back();
+    };
+
+    const char* p          = source->data;
+    const char* end        = source->data + source->size;
+    const char* chunkStart = p;
+
+    out.reserve(out.size() + source->size);
 
-  while (code.find("#include ") != code.npos) {
-    const auto pos = code.find("#include ");
-    const auto p1  = code.find('<', pos);
-    const auto p2  = code.find('>', pos);
-    if (p1 == code.npos || p2 == code.npos || p2 <= p1) {
-      LLOGW("Error while loading shader program: %s\n", code.c_str());
-      return std::string();
+    while (p < end) {
+      const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+      if (!lineEnd)
+        lineEnd = end;
+
+      if (const char* args = match_directive(p, lineEnd, "include")) {
+        const char* open  = skip_blanks(args, lineEnd);
+        const char close  = open < lineEnd && *open == '<' ? '>' : '"';
+        const char* name  = open + 1;
+        const char* last  = open < lineEnd && (*open == '<' || *open == '"') ? (const char*)memchr(name, close, lineEnd - name) : nullptr;
+
+        if (!last) {
+          KHOLST_LOGW("Error while loading shader program: malformed #include in '%s': %.*s\n", fileName, (int)(lineEnd - p), p);
+          return false;
+        }
+
+        out.append(chunkStart, p);
+        if (!expand(std::string(name, last).c_str(), out))
+          return false;
+        chunkStart = lineEnd; // keep the newline of the directive
+      } else if (const char* args = match_directive(p, lineEnd, "pragma")) {
+        if (read_identifier(args, lineEnd) == "once") {
+          source->includeOnce = true;
+          out.append(chunkStart, p);
+          chunkStart = lineEnd;
+        }
+      }
+
+      p = lineEnd + 1;
     }
-    const std::string name    = code.substr(p1 + 1, p2 - p1 - 1);
-    const std::string include = read_shader_file(name.c_str());
-    code.replace(pos, p2 - pos + 1, include.c_str());
+
+    out.append(chunkStart, end);
+    return true;
   }
 
+ private:
+  std::unordered_map<std::string, std::unique_ptr<ShaderSource>> sources;
+  std::unordered_set<std::string> expanded;
+  std::vector<std::string> stack;
+
+  ShaderSource* load(const char* fileName) {
+    auto it = sources.find(fileName);
+    if (it != sources.end())
+      return it->second.get();
+
+    std::unique_ptr<ShaderSource> source = std::make_unique<ShaderSource>();
+    if (!read_shader_source(fileName, *source))
+      return nullptr;
+
+    source->includeOnce = has_include_guard(*source);
+    return (sources[fileName] = std::move(source)).get();
+  }
+};
+
+std::string read_shader_file(const char* fileName)
+{
+  ShaderPreprocessor preprocessor;
+  std::string code;
+
+  if (!preprocessor.expand(fileName, code))
+    return std::string();
+
   return code;
 }
 
@@ -83,6 +343,12 @@ lvk::ShaderStage lvk_shader_stage_from_file_name(const char* fileName)
   if (ends_with(fileName, ".tese"))
     return lvk::Stage_Tese;
 
+  if (ends_with(fileName, ".task"))
+    return lvk::Stage_Task;
+
+  if (ends_with(fileName, ".mesh"))
+    return lvk::Stage_Mesh;
+
   return lvk::Stage_Vert;
 }
 